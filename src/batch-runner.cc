@@ -0,0 +1,143 @@
+/*
+ * batch-runner.cc - Run many headless games at once
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/batch-runner.h"
+
+#include <chrono>
+
+#include "src/debug.h"
+#include "src/player.h"
+#include "src/serf.h"
+#include "src/thread-pool.h"
+
+BatchRunner::BatchRunner(unsigned int ticks, unsigned int threads)
+  : ticks(ticks)
+  , threads(threads)
+  , elapsed(0) {
+}
+
+void
+BatchRunner::add_game(PGameInfo game_info) {
+  games.push_back(game_info);
+}
+
+std::vector<BatchRunner::GameSummary>
+BatchRunner::run() {
+  std::vector<GameSummary> summaries(games.size());
+
+  /* The thread that waits for the batch runs games as well. */
+  ThreadPool pool((threads > 1) ? threads - 1 : 0);
+
+  auto start = std::chrono::steady_clock::now();
+  pool.parallel_for(0, games.size(), 1, [this, &summaries](size_t first,
+                                                          size_t last) {
+    for (size_t i = first; i < last; i++) {
+      summaries[i] = run_game(games[i], ticks);
+    }
+  });
+  std::chrono::duration<double> duration =
+    std::chrono::steady_clock::now() - start;
+  elapsed = duration.count();
+
+  return summaries;
+}
+
+double
+BatchRunner::get_ticks_per_second() const {
+  if (elapsed <= 0) {
+    return 0;
+  }
+  return static_cast<double>(ticks) * static_cast<double>(games.size()) /
+         elapsed;
+}
+
+BatchRunner::GameSummary
+BatchRunner::run_game(PGameInfo game_info, unsigned int ticks) {
+  /* The games already keep the threads busy, so each one runs its own
+     parallel work on the thread that runs the game. */
+  ThreadPool serial(0);
+
+  PGame game = game_info->instantiate(&serial);
+  if (!game) {
+    throw ExceptionFreeserf("Failed to create game '" +
+                            game_info->get_name() + "'");
+  }
+  game->set_random(game_info->get_random_base());
+  place_castles(game_info, game.get());
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < ticks; i++) {
+    game->update();
+  }
+  std::chrono::duration<double> duration =
+    std::chrono::steady_clock::now() - start;
+
+  GameSummary summary;
+  summary.name = game_info->get_name();
+  summary.map_size = game_info->get_map_size();
+  summary.ticks = ticks;
+  summary.seconds = duration.count();
+  summary.state_hash = game->state_hash();
+  for (size_t i = 0; i < game_info->get_player_count(); i++) {
+    Player *player = game->get_player(static_cast<unsigned int>(i));
+    PlayerSummary player_summary;
+    player_summary.land_area = player->get_land_area();
+    player_summary.building_score = player->get_building_score();
+    player_summary.military_score = player->get_military_score();
+    player_summary.serfs = 0;
+    for (int type = 0; type < Serf::TypeDead; type++) {
+      player_summary.serfs += player->get_serf_count(type);
+    }
+    summary.players.push_back(player_summary);
+  }
+
+  return summary;
+}
+
+/* There is no computer player to found a castle, so players of random
+   games get theirs at the first place that allows one, searching
+   spirally from the middle of a quarter of the map. */
+void
+BatchRunner::place_castles(PGameInfo game_info, Game *game) {
+  PMap map = game->get_map();
+  for (size_t i = 0; i < game_info->get_player_count(); i++) {
+    Player *player = game->get_player(static_cast<unsigned int>(i));
+    if (player->has_castle()) {
+      continue;
+    }
+
+    unsigned int col = map->get_cols() / 4 + (i % 2) * map->get_cols() / 2;
+    unsigned int row = map->get_rows() / 4 + ((i / 2) % 2) *
+                       map->get_rows() / 2;
+    MapPos center = map->pos(col, row);
+    bool built = false;
+    for (unsigned int offset = 0; offset < 295 && !built; offset++) {
+      MapPos pos = map->pos_add_spirally(center, offset);
+      built = game->can_build_castle(pos, player) &&
+              game->build_castle(pos, player);
+    }
+    for (MapPos pos : map->geom()) {
+      if (built) break;
+      built = game->can_build_castle(pos, player) &&
+              game->build_castle(pos, player);
+    }
+  }
+}
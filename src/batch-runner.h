@@ -0,0 +1,85 @@
+/*
+ * batch-runner.h - Run many headless games at once
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_BATCH_RUNNER_H_
+#define SRC_BATCH_RUNNER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/mission.h"
+#include "src/game.h"
+
+/* Runs a batch of games without interface, several at a time. Each game
+   has its own Game and Map and is updated by one thread at a time; games
+   share no state that changes, so the outcome of a game only depends on
+   its GameInfo and the number of ticks, not on the number of threads or
+   on the other games in the batch. */
+class BatchRunner {
+ public:
+  class PlayerSummary {
+   public:
+    int land_area;
+    int building_score;
+    int military_score;
+    unsigned int serfs;
+  };
+
+  class GameSummary {
+   public:
+    std::string name;
+    unsigned int map_size;
+    unsigned int ticks;
+    double seconds;
+    uint64_t state_hash;
+    std::vector<PlayerSummary> players;
+  };
+
+ protected:
+  std::vector<PGameInfo> games;
+  unsigned int ticks;
+  unsigned int threads;
+  double elapsed;
+
+ public:
+  /* Run every game for the given number of ticks on at most the given
+     number of threads. */
+  BatchRunner(unsigned int ticks, unsigned int threads);
+
+  void add_game(PGameInfo game_info);
+  size_t get_game_count() const { return games.size(); }
+
+  /* Run the games, in the order they were added as far as threads allow,
+     and return their summaries in that order. */
+  std::vector<GameSummary> run();
+
+  /* Wall time of the last run and the game ticks run per second of it,
+     over all games. */
+  double get_elapsed() const { return elapsed; }
+  double get_ticks_per_second() const;
+
+ protected:
+  static GameSummary run_game(PGameInfo game_info, unsigned int ticks);
+  static void place_castles(PGameInfo game_info, Game *game);
+};
+
+#endif  // SRC_BATCH_RUNNER_H_
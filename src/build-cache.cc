@@ -0,0 +1,63 @@
+/*
+ * build-cache.cc - Cached build possibilities per player
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/build-cache.h"
+
+#include <algorithm>
+
+const uint8_t BuildCache::kUnknown;
+
+BuildCache::BuildCache(PMap _map, unsigned int player_count)
+  : map(_map)
+  , players(player_count)
+  , castle(player_count, -1) {
+  for (std::vector<uint8_t> &entries : players) {
+    entries.assign(map->geom().tile_count(), kUnknown);
+  }
+  map->add_change_handler(this);
+}
+
+BuildCache::~BuildCache() {
+  map->del_change_handler(this);
+}
+
+int
+BuildCache::get(MapPos pos, unsigned int player, bool has_castle) {
+  map->dispatch_changes();
+
+  /* Castle and building checks depend on whether the player has a
+     castle, so a change there invalidates every entry of the player. */
+  if (castle[player] != has_castle) {
+    std::fill(players[player].begin(), players[player].end(), kUnknown);
+    castle[player] = has_castle;
+  }
+
+  uint8_t entry = players[player][pos];
+  return (entry == kUnknown) ? -1 : entry;
+}
+
+void
+BuildCache::on_tile_changed(MapPos pos) {
+  for (int i = 0; i < 1+6+12+18; i++) {
+    MapPos p = map->pos_add_spirally(pos, i);
+    for (std::vector<uint8_t> &entries : players) entries[p] = kUnknown;
+  }
+}
@@ -0,0 +1,69 @@
+/*
+ * build-cache.h - Cached build possibilities per player
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_BUILD_CACHE_H_
+#define SRC_BUILD_CACHE_H_
+
+#include <vector>
+
+#include "src/map.h"
+
+/* What each player could build on each map position, as shown in build
+   mode. Entries are filled on demand by the game and dropped when the
+   map changes within three shells of the position, which covers every
+   tile the build checks look at. */
+class BuildCache : public Map::Handler {
+ public:
+  typedef enum Build {
+    BuildNone = 0,
+    BuildSmall,
+    BuildMine,
+    BuildLarge,
+    BuildCastle,
+  } Build;
+
+ protected:
+  static const uint8_t kUnknown = 0xff;
+
+  PMap map;
+  std::vector<std::vector<uint8_t>> players;
+  /* Castle state of each player when its entries were computed. */
+  std::vector<int> castle;
+
+ public:
+  BuildCache(PMap map, unsigned int player_count);
+  virtual ~BuildCache();
+
+  const PMap &get_map() const { return map; }
+
+  /* Return the cached entry of player at pos, or -1 if it has to be
+     computed. Pending map changes are applied first. */
+  int get(MapPos pos, unsigned int player, bool has_castle);
+  void set(MapPos pos, unsigned int player, Build build) {
+    players[player][pos] = build;
+  }
+
+  virtual void on_height_changed(MapPos pos) {}
+  virtual void on_object_changed(MapPos pos) {}
+  virtual void on_tile_changed(MapPos pos);
+};
+
+#endif  // SRC_BUILD_CACHE_H_
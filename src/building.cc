@@ -55,6 +55,32 @@ Building::Building(Game *game, unsigned int index)
 
   first_knight = 0;
   burning_counter = 0;
+
+  game->wake_building(index);
+}
+
+uint64_t
+Building::get_state_hash() const {
+  uint64_t hash = hash_combine(0, get_index());
+  hash = hash_combine(hash, type);
+  hash = hash_combine(hash, owner);
+  hash = hash_combine(hash, pos);
+  hash = hash_combine(hash, flag);
+  hash = hash_combine(hash, constructing);
+  hash = hash_combine(hash, (serf_requested << 1) | serf_request_failed);
+  hash = hash_combine(hash, (burning << 2) | (active << 1) | holder);
+  hash = hash_combine(hash, first_knight);
+  hash = hash_combine(hash, burning_counter);
+  hash = hash_combine(hash, progress);
+  hash = hash_combine(hash, u.tick);
+  for (const Stock &s : stock) {
+    hash = hash_combine(hash, s.type);
+    hash = hash_combine(hash, s.prio);
+    hash = hash_combine(hash, s.available);
+    hash = hash_combine(hash, s.requested);
+    hash = hash_combine(hash, s.maximum);
+  }
+  return hash;
 }
 
 typedef struct ConstructionInfo {
@@ -95,6 +121,7 @@ const ConstructionInfo const_info[] = {
 
 Map::Object
 Building::start_building(Building::Type _type) {
+  wake();
   type = _type;
   Map::Object map_obj = const_info[type].map_obj;
   progress = (map_obj == Map::ObjectLargeBuilding) ? 0 : 1;
@@ -121,9 +148,13 @@ Building::start_building(Building::Type _type) {
 
 void
 Building::done_leveling() {
+  wake();
   progress = 1;
   holder = false;
   first_knight = 0;
+
+  /* The level of a leveling site affects what can be built around it. */
+  game->get_map()->mark_object_changed(pos);
 }
 
 bool
@@ -137,6 +168,7 @@ Building::build_progress() {
     return false;
   }
 
+  wake();
   progress = 0;
   constructing = false; /* Building finished */
   first_knight = 0;
@@ -292,6 +324,7 @@ Building::cancel_transported_resource(Resource::Type res) {
   }
 
   if (in_stock >= 0) {
+    wake();
     stock[in_stock].requested -= 1;
     if (stock[in_stock].requested < 0) {
       throw ExceptionFreeserf("Failed to cancel unrequested "
@@ -304,6 +337,7 @@ bool
 Building::add_requested_resource(Resource::Type res, bool fix_priority) {
   for (int j = 0; j < kMaxStock; j++) {
     if (stock[j].type == res) {
+      wake();
       if (fix_priority) {
         int prio = stock[j].prio;
         if ((prio & 1) == 0) prio = 0;
@@ -322,6 +356,7 @@ Building::add_requested_resource(Resource::Type res, bool fix_priority) {
 void
 Building::stock_init(unsigned int stock_num, Resource::Type res_type,
                      unsigned int maximum) {
+  wake();
   stock[stock_num].type = res_type;
   stock[stock_num].prio = 0;
   stock[stock_num].maximum = maximum;
@@ -332,6 +367,7 @@ Building::requested_resource_delivered(Resource::Type resource) {
   if (burning) {
     return;
   }
+  wake();
   if (has_inventory()) {
     inventory->push_resource(resource);
   } else {
@@ -359,6 +395,7 @@ Building::requested_resource_delivered(Resource::Type resource) {
 
 void
 Building::requested_knight_arrived() {
+  wake();
   stock[0].available += 1;
   stock[0].requested -= 1;
 }
@@ -380,6 +417,7 @@ Building::is_enough_place_for_knight() const {
 bool
 Building::knight_come_back_from_fight(Serf *knight) {
   if (is_enough_place_for_knight()) {
+    wake();
     stock[0].available += 1;
     Serf *serf = game->get_serf(first_knight);
     knight->insert_before(serf);
@@ -392,6 +430,7 @@ Building::knight_come_back_from_fight(Serf *knight) {
 
 void
 Building::knight_occupy() {
+  wake();
   if (!has_knight()) {
     stock[0].available = 0;
     stock[0].requested = 1;
@@ -406,6 +445,7 @@ Building::burnup() {
     return true;
   }
 
+  wake();
   burning = true;
 
   /* Remove lost gold stock from total count. */
@@ -540,8 +580,34 @@ Building::update(unsigned int tick) {
   }
 }
 
+/* Finished workplaces only recompute the priorities of their stock
+   from the stock itself and the settings of the owner, so once their
+   serf is there or on the way another update changes nothing. */
+bool
+Building::is_idle() const {
+  if (burning || constructing || serf_request_failed) return false;
+  if (!holder && !serf_requested) return false;
+
+  switch (type) {
+    case TypeStock:
+    case TypeHut:
+    case TypeTower:
+    case TypeFortress:
+    case TypeCastle:
+      return false;
+    default:
+      return true;
+  }
+}
+
+void
+Building::wake() {
+  game->wake_building(index);
+}
+
 void
 Building::requested_serf_lost() {
+  wake();
   if (serf_requested) {
     serf_requested = false;
   } else if (!has_inventory()) {
@@ -551,6 +617,7 @@ Building::requested_serf_lost() {
 
 void
 Building::requested_serf_reached(Serf *serf) {
+  wake();
   holder = true;
   if (serf_requested) {
     first_knight = serf->get_index();
@@ -560,12 +627,14 @@ Building::requested_serf_reached(Serf *serf) {
 
 void
 Building::knight_request_granted() {
+  wake();
   stock[0].requested += 1;
   serf_requested = false;
 }
 
 void
 Building::remove_stock() {
+  wake();
   stock[0].available = 0;
   stock[0].requested = 0;
   stock[1].available = 0;
@@ -591,6 +660,7 @@ Building::get_max_priority_for_resource(
 bool
 Building::use_resource_in_stock(int stock_num) {
   if (stock[stock_num].available > 0) {
+    wake();
     stock[stock_num].available -= 1;
     return true;
   }
@@ -600,6 +670,7 @@ Building::use_resource_in_stock(int stock_num) {
 bool
 Building::use_resources_in_stocks() {
   if (stock[0].available > 0 && stock[1].available > 0) {
+    wake();
     stock[0].available -= 1;
     stock[1].available -= 1;
     return true;
@@ -110,6 +110,9 @@ class Building : public GameObject {
  public:
   Building(Game *game, unsigned int index);
 
+  /* Hash of the state, for checking that two games run in lockstep. */
+  uint64_t get_state_hash() const;
+
   MapPos get_position() const { return pos; }
   void set_position(MapPos position) { pos = position; }
 
@@ -133,7 +136,7 @@ class Building : public GameObject {
                                     (type == TypeCastle); }
   /* Owning player of the building. */
   unsigned int get_owner() const { return owner; }
-  void set_owner(unsigned int new_owner) { owner = new_owner; }
+  void set_owner(unsigned int new_owner) { owner = new_owner; wake(); }
   /* Whether construction of the building is finished. */
   bool is_done() const { return !constructing; }
   bool is_leveling() const { return (!is_done() && progress == 0); }
@@ -162,7 +165,7 @@ class Building : public GameObject {
   /* Building has an associated serf. */
   bool has_serf() const { return holder; }
   /* Building has succesfully requested a serf. */
-  void serf_request_granted() { serf_requested = true; }
+  void serf_request_granted() { serf_requested = true; wake(); }
   void requested_serf_lost();
   void requested_serf_reached(Serf *serf);
   /* Building has requested a serf but none was available. */
@@ -210,30 +213,31 @@ class Building : public GameObject {
   int get_requested_in_stock(int stock_num) const {
     return stock[stock_num].requested; }
   void set_priority_in_stock(int stock_num, int priority) {
-    stock[stock_num].prio = priority; }
+    stock[stock_num].prio = priority; wake(); }
   void set_initial_res_in_stock(int stock_num, int count) {
-    stock[stock_num].available = count; }
+    stock[stock_num].available = count; wake(); }
   void requested_resource_delivered(Resource::Type resource);
   void plank_used_for_build() {
-    stock[0].available -= 1; stock[0].maximum -= 1; }
+    stock[0].available -= 1; stock[0].maximum -= 1; wake(); }
   void stone_used_for_build() {
-    stock[1].available -= 1; stock[1].maximum -= 1; }
+    stock[1].available -= 1; stock[1].maximum -= 1; wake(); }
   bool use_resource_in_stock(int stock_num);
   bool use_resources_in_stocks();
   void decrease_requested_for_stock(int stock_num) {
-    stock[stock_num].requested -= 1; }
+    stock[stock_num].requested -= 1; wake(); }
 
   int pigs_count() const { return stock[1].available; }
-  void send_pig_to_butcher() { stock[1].available -= 1; }
-  void place_new_pig() { stock[1].available += 1; }
+  void send_pig_to_butcher() { stock[1].available -= 1; wake(); }
+  void place_new_pig() { stock[1].available += 1; wake(); }
 
-  void boat_clear() { stock[1].available = 0; }
-  void boat_do() { stock[1].available++; }
+  void boat_clear() { stock[1].available = 0; wake(); }
+  void boat_do() { stock[1].available++; wake(); }
 
   void requested_knight_arrived();
-  void requested_knight_attacking_on_walk() { stock[0].requested -= 1; }
+  void requested_knight_attacking_on_walk() {
+    stock[0].requested -= 1; wake(); }
   void requested_knight_defeat_on_walk() {
-    if (!has_inventory()) stock[0].requested -= 1; }
+    if (!has_inventory()) { stock[0].requested -= 1; wake(); } }
   bool is_enough_place_for_knight() const;
   bool knight_come_back_from_fight(Serf *knight);
   void knight_occupy();
@@ -241,6 +245,8 @@ class Building : public GameObject {
   void update_military_flag_state();
 
   void update(unsigned int tick);
+  /* Whether the next update would repeat the last one. */
+  bool is_idle() const;
 
   friend SaveReaderBinary&
     operator >> (SaveReaderBinary &reader, Building &building);
@@ -250,6 +256,7 @@ class Building : public GameObject {
     operator << (SaveWriterText &writer, Building &building);
 
  private:
+  void wake();
   void update();
   void update_unfinished();
   void update_unfinished_adv();
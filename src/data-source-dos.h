@@ -106,6 +106,7 @@ class DataSourceDOS : public DataSourceLegacy {
   virtual std::string get_name() const { return "DOS"; }
   virtual unsigned int get_scale() const { return 1; }
   virtual unsigned int get_bpp() const { return 8; }
+  virtual bool is_reentrant() const { return true; }
 
   virtual bool check();
   virtual bool load();
@@ -102,6 +102,8 @@ class DataSourceBase : public Data::Source {
   virtual Data::MaskImage get_sprite_parts(Data::Resource res,
                                            size_t index) = 0;
 
+  virtual bool is_reentrant() const { return false; }
+
   virtual size_t get_animation_phase_count(size_t animation);
   virtual Data::Animation get_animation(size_t animation, size_t phase);
 
@@ -144,6 +144,9 @@ class Data {
 
     virtual MaskImage get_sprite_parts(Resource res, size_t index) = 0;
 
+    /* Whether sprites can be decoded on several threads at once. */
+    virtual bool is_reentrant() const = 0;
+
     virtual size_t get_animation_phase_count(size_t animation) = 0;
     virtual Animation get_animation(size_t animation, size_t phase) = 0;
 
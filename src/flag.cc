@@ -27,6 +27,7 @@
 #include "src/savegame.h"
 #include "src/log.h"
 #include "src/inventory.h"
+#include "src/misc.h"
 
 #define SEARCH_MAX_DEPTH  0x10000
 
@@ -80,6 +81,206 @@ FlagSearch::single(Flag *src, flag_search_func *callback, bool land,
   return search.execute(callback, land, transporter, data);
 }
 
+ScheduleBatch::ScheduleBatch(Game *game_) {
+  game = game_;
+}
+
+void
+ScheduleBatch::add_known_dest(Flag *flag, int slot, const Direction dirs[],
+                              int count) {
+  Request request;
+  request.flag = flag;
+  request.slot = slot;
+  request.dest = flag->slot[slot].dest;
+  request.source_count = count;
+  std::copy(dirs, dirs + count, request.source_dir);
+  request.result = DirectionNone;
+  requests.push_back(request);
+}
+
+void
+ScheduleBatch::add_unknown_dest(Flag *flag, int slot) {
+  Request request;
+  request.flag = flag;
+  request.slot = slot;
+  request.dest = 0;
+  request.source_count = -1;
+  request.result = DirectionNone;
+  requests.push_back(request);
+}
+
+int
+ScheduleBatch::get_demand(unsigned int player, Resource::Type res) {
+  unsigned int key = (player << 8) | res;
+  auto it = demand.find(key);
+  if (it != demand.end()) {
+    return it->second;
+  }
+
+  int count = 0;
+  for (Building *building :
+         game->get_player_buildings(game->get_player(player))) {
+    if (building->get_max_priority_for_resource(res) > 0) count += 1;
+  }
+  demand[key] = count;
+  return count;
+}
+
+/* Called after building was assigned a resource, which may have
+   satisfied its request. */
+void
+ScheduleBatch::update_demand(Building *building, Resource::Type res) {
+  if (building->get_max_priority_for_resource(res) <= 0) {
+    unsigned int key = (building->get_owner() << 8) | res;
+    demand[key] -= 1;
+  }
+}
+
+int &
+ScheduleBatch::distance_of(const Flag *flag) {
+  if (flag->get_index() >= distance.size()) {
+    distance.resize(flag->get_index() + 1, -1);
+  }
+  return distance[flag->get_index()];
+}
+
+/* Resolve a group of requests sharing the same source flag and
+   destination. The search runs backwards from the destination along roads
+   served by transporters and stops once every candidate first step has
+   been reached. The source flag is blocked, as a forward search from it
+   would never pass through it again. Each request then takes the first of
+   its directions with the shortest distance, which is the flag a forward
+   search from the request would have reached first. */
+void
+ScheduleBatch::resolve_known_dest(const std::vector<size_t> &group) {
+  Flag *dest = game->get_flag(requests[group[0]].dest);
+  if (dest == nullptr) return;
+  Flag *source = requests[group[0]].flag;
+
+  /* Mark the candidate first steps, -2 meaning wanted but not reached
+     and -3 the blocked source flag. */
+  distance_of(source) = -3;
+  std::vector<Flag*> targets;
+  int remaining = 0;
+  for (size_t i : group) {
+    Request &request = requests[i];
+    for (int k = 0; k < request.source_count; k++) {
+      Flag *other = request.flag->other_endpoint.f[request.source_dir[k]];
+      int &dist = distance_of(other);
+      if (dist == -1) {
+        dist = -2;
+        targets.push_back(other);
+        remaining += 1;
+      }
+    }
+  }
+
+  std::vector<Flag*> queue;
+  if (dest != source) {
+    int &dest_dist = distance_of(dest);
+    if (dest_dist == -2) remaining -= 1;
+    dest_dist = 0;
+    queue.push_back(dest);
+  }
+
+  for (size_t i = 0; i < queue.size() && remaining > 0; i++) {
+    Flag *flag = queue[i];
+    int next = distance_of(flag) + 1;
+    for (Direction d : cycle_directions_ccw()) {
+      if (!flag->has_path(d)) continue;
+      Flag *other = flag->other_endpoint.f[d];
+      if (!other->has_transporter(flag->get_other_end_dir(d))) continue;
+
+      int &dist = distance_of(other);
+      if (dist >= 0 || dist == -3) continue;
+      if (dist == -2) remaining -= 1;
+      dist = next;
+      queue.push_back(other);
+    }
+  }
+
+  for (size_t i : group) {
+    Request &request = requests[i];
+    int sources = 0;
+    int best = -1;
+    for (int k = 0; k < request.source_count; k++) {
+      Direction dir = request.source_dir[k];
+      Flag *other = request.flag->other_endpoint.f[dir];
+
+      /* Each neighbour only counts once, from its first direction. */
+      bool seen = (other == request.flag);
+      for (int j = 0; j < k && !seen; j++) {
+        seen = (request.flag->other_endpoint.f[request.source_dir[j]] ==
+                other);
+      }
+      if (seen) continue;
+
+      sources += 1;
+      int dist = distance_of(other);
+      if (dist >= 0 && (best < 0 || dist < best)) {
+        best = dist;
+        request.result = dir;
+      }
+    }
+    if (sources == 0) request.source_count = 0;
+  }
+
+  for (Flag *flag : queue) distance_of(flag) = -1;
+  for (Flag *flag : targets) distance_of(flag) = -1;
+  distance_of(source) = -1;
+}
+
+void
+ScheduleBatch::resolve_known_dests() {
+  /* Group slots with a known destination by source flag and
+     destination. */
+  std::vector<size_t> known;
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (requests[i].source_count > 0) known.push_back(i);
+  }
+  auto same_group = [this](size_t a, size_t b) {
+    return (requests[a].dest == requests[b].dest &&
+            requests[a].flag == requests[b].flag);
+  };
+  std::stable_sort(known.begin(), known.end(), [this](size_t a, size_t b) {
+    if (requests[a].dest != requests[b].dest) {
+      return requests[a].dest < requests[b].dest;
+    }
+    return requests[a].flag->get_index() < requests[b].flag->get_index();
+  });
+
+  for (size_t i = 0; i < known.size(); ) {
+    size_t j = i;
+    while (j < known.size() && same_group(known[j], known[i])) j++;
+    resolve_known_dest(std::vector<size_t>(known.begin() + i,
+                                           known.begin() + j));
+    i = j;
+  }
+}
+
+void
+ScheduleBatch::execute() {
+  resolve_known_dests();
+
+  /* Apply the results in the order the slots were collected. */
+  for (Request &request : requests) {
+    Flag *flag = request.flag;
+    if (request.source_count < 0) {
+      flag->schedule_slot_to_unknown_dest(request.slot, this);
+    } else if (request.source_count == 0) {
+      flag->endpoint |= BIT(7);
+    } else if (request.result == DirectionNone ||
+               request.dest == flag->get_index()) {
+      /* Unable to deliver */
+      flag->cancel_slot_dest(request.slot);
+    } else {
+      flag->schedule_slot_to_dir(request.slot, request.result);
+    }
+  }
+
+  requests.clear();
+}
+
 Flag::Flag(Game *game, unsigned int index)
   : GameObject(game, index)
   , owner(-1)
@@ -94,7 +295,10 @@ Flag::Flag(Game *game, unsigned int index)
   , other_endpoint{}
   , other_end_dir{}
   , bld_flags(0)
-  , bld2_flags(0) {
+  , bld2_flags(0)
+  , inventory_for_resource(-1)
+  , inventory_for_serf(-1)
+  , inventory_field_gen(0) {
   for (int j = 0; j < FLAG_MAX_RES_COUNT; j++) {
     slot[j].type = Resource::TypeNone;
     slot[j].dest = 0;
@@ -102,6 +306,27 @@ Flag::Flag(Game *game, unsigned int index)
   }
 }
 
+uint64_t
+Flag::get_state_hash() const {
+  uint64_t hash = hash_combine(0, get_index());
+  hash = hash_combine(hash, owner);
+  hash = hash_combine(hash, pos);
+  hash = hash_combine(hash, path_con);
+  hash = hash_combine(hash, endpoint);
+  hash = hash_combine(hash, transporter);
+  hash = hash_combine(hash, (bld2_flags << 8) | bld_flags);
+  for (const ResourceSlot &s : slot) {
+    hash = hash_combine(hash, s.type);
+    hash = hash_combine(hash, s.dir);
+    hash = hash_combine(hash, s.dest);
+  }
+  for (int i = 0; i < 6; i++) {
+    hash = hash_combine(hash, length[i]);
+    hash = hash_combine(hash, other_end_dir[i]);
+  }
+  return hash;
+}
+
 void
 Flag::add_path(Direction dir, bool water) {
   path_con |= BIT(dir);
@@ -111,6 +336,8 @@ Flag::add_path(Direction dir, bool water) {
     endpoint |= BIT(dir);
   }
   transporter &= ~BIT(dir);
+
+  invalidate_inventory_field();
 }
 
 void
@@ -133,6 +360,59 @@ Flag::del_path(Direction dir) {
   /* Mark resource path for recalculation if they would
    have followed the removed path. */
   invalidate_resource_path(dir);
+
+  invalidate_inventory_field();
+}
+
+void
+Flag::set_owner(unsigned int _owner) {
+  if (owner != _owner) {
+    invalidate_inventory_field();
+    owner = _owner;
+    invalidate_inventory_field();
+  }
+}
+
+void
+Flag::set_accepts_resources(bool accepts) {
+  if (accepts) {
+    bld2_flags |= BIT(7);
+  } else {
+    bld2_flags &= ~BIT(7);
+  }
+  invalidate_inventory_field();
+}
+
+void
+Flag::set_accepts_serfs(bool accepts) {
+  if (accepts) {
+    bld_flags |= BIT(7);
+  } else {
+    bld_flags &= ~BIT(7);
+  }
+  invalidate_inventory_field();
+}
+
+void
+Flag::clear_flags() {
+  bld_flags = 0;
+  bld2_flags = 0;
+  invalidate_inventory_field();
+}
+
+/* Mark the nearest inventory field of the owner as outdated. Must be
+   called whenever roads, transporters or accepting inventories change. */
+void
+Flag::invalidate_inventory_field() {
+  game->invalidate_inventory_field(owner);
+}
+
+/* Recompute the nearest inventory field of the owner if it is outdated. */
+void
+Flag::validate_inventory_field() {
+  if (inventory_field_gen != game->get_inventory_field_gen(owner)) {
+    game->update_inventory_field(owner);
+  }
 }
 
 bool
@@ -222,6 +502,8 @@ Flag::fix_scheduled() {
 
 typedef struct ScheduleUnknownDestData {
   Resource::Type resource;
+  unsigned int owner;
+  int remaining;
   int max_prio;
   Flag *flag;
 } ScheduleUnknownDestData;
@@ -240,13 +522,20 @@ schedule_unknown_dest_cb(Flag *flag, void *data) {
     }
 
     if (dest_data->max_prio > 204) return true;
+
+    /* No need to look further once every building that wants
+       the resource has been seen. */
+    if (bld_prio > 0 && building->get_owner() == dest_data->owner) {
+      dest_data->remaining -= 1;
+      if (dest_data->remaining == 0) return true;
+    }
   }
 
   return false;
 }
 
 void
-Flag::schedule_slot_to_unknown_dest(int slot_num) {
+Flag::schedule_slot_to_unknown_dest(int slot_num, ScheduleBatch *batch) {
   /* Resources which should be routed directly to
    buildings requesting them. Resources not listed
    here will simply be moved to an inventory. */
@@ -282,9 +571,6 @@ Flag::schedule_slot_to_unknown_dest(int slot_num) {
 
   Resource::Type res = slot[slot_num].type;
   if (routable[res]) {
-    FlagSearch search(game);
-    search.add_source(this);
-
     /* Handle food as one resource group */
     if (res == Resource::TypeMeat ||
         res == Resource::TypeFish ||
@@ -294,10 +580,17 @@ Flag::schedule_slot_to_unknown_dest(int slot_num) {
 
     ScheduleUnknownDestData data;
     data.resource = res;
+    data.owner = owner;
+    data.remaining = batch->get_demand(owner, res);
     data.flag = NULL;
     data.max_prio = 0;
 
-    search.execute(schedule_unknown_dest_cb, false, true, &data);
+    if (data.remaining > 0) {
+      FlagSearch search(game);
+      search.add_source(this);
+      search.execute(schedule_unknown_dest_cb, false, true, &data);
+    }
+
     if (data.flag != nullptr) {
       Log::Verbose["game"] << "dest for flag " << index << " res " << slot
                            << " found: flag " << data.flag->get_index();
@@ -306,6 +599,7 @@ Flag::schedule_slot_to_unknown_dest(int slot_num) {
       if (!dest_bld->add_requested_resource(res, true)) {
         throw ExceptionFreeserf("Failed to request resource.");
       }
+      batch->update_demand(dest_bld, res);
 
       slot[slot_num].dest = dest_bld->get_flag_index();
       endpoint |= BIT(7);
@@ -349,100 +643,30 @@ Flag::schedule_slot_to_unknown_dest(int slot_num) {
   }
 }
 
-static bool
-find_nearest_inventory_search_cb(Flag *flag, void *data) {
-  Flag **dest = reinterpret_cast<Flag**>(data);
-  if (flag->accepts_resources()) {
-    *dest = flag;
-    return true;
-  }
-  return false;
-}
-
-/* Return the flag index of the inventory nearest to flag. */
+/* Return the flag index of the inventory nearest to flag that accepts
+   resources, following roads served by transporters. */
 int
 Flag::find_nearest_inventory_for_resource() {
-  Flag *dest = NULL;
-  FlagSearch::single(this, find_nearest_inventory_search_cb, false, true,
-                     &dest);
-  if (dest != NULL) return dest->get_index();
-
-  return -1;
-}
-
-static bool
-flag_search_inventory_search_cb(Flag *flag, void *data) {
-  int *dest_index = static_cast<int*>(data);
-  if (flag->accepts_serfs()) {
-    Building *building = flag->get_building();
-    *dest_index = building->get_flag_index();
-    return true;
-  }
-
-  return false;
+  validate_inventory_field();
+  return inventory_for_resource;
 }
 
+/* Return the flag index of the inventory nearest to flag that accepts
+   serfs, following land roads. */
 int
 Flag::find_nearest_inventory_for_serf() {
-  int dest_index = -1;
-  FlagSearch::single(this, flag_search_inventory_search_cb, true, false,
-                     &dest_index);
-
-  return dest_index;
-}
-
-typedef struct ScheduleKnownDestData {
-  Flag *src;
-  Flag *dest;
-  int slot;
-} ScheduleKnownDestData;
-
-static bool
-schedule_known_dest_cb(Flag *flag, void *data) {
-  ScheduleKnownDestData *dest_data =
-    static_cast<ScheduleKnownDestData*>(data);
-  return (flag->schedule_known_dest_cb_(dest_data->src,
-                                        dest_data->dest,
-                                        dest_data->slot) != 0);
-}
-
-bool
-Flag::schedule_known_dest_cb_(Flag *src, Flag *dest, int _slot) {
-  if (this == dest) {
-    /* Destination found */
-    if (this->search_dir != 6) {
-      if (!src->is_scheduled(this->search_dir)) {
-        /* Item is requesting to be fetched */
-        src->other_end_dir[this->search_dir] =
-          BIT(7) | (src->other_end_dir[this->search_dir] & 0x78) | _slot;
-      } else {
-        Player *player = game->get_player(this->get_owner());
-        int other_dir = src->other_end_dir[this->search_dir];
-        int prio_old = player->get_flag_prio(src->slot[other_dir & 7].type);
-        int prio_new = player->get_flag_prio(src->slot[_slot].type);
-        if (prio_new > prio_old) {
-          /* This item has the highest priority now */
-          src->other_end_dir[this->search_dir] =
-            (src->other_end_dir[this->search_dir] & 0xf8) | _slot;
-        }
-        src->slot[_slot].dir = this->search_dir;
-      }
-    }
-    return true;
-  }
-
-  return false;
+  validate_inventory_field();
+  return inventory_for_serf;
 }
 
 void
-Flag::schedule_slot_to_known_dest(int slot_, unsigned int res_waiting[4]) {
-  FlagSearch search(game);
-
-  search_num = search.get_id();
-  search_dir = DirectionNone;
-  int tr = transporters();
-
+Flag::schedule_slot_to_known_dest(int slot_, unsigned int res_waiting[4],
+                                  ScheduleBatch *batch) {
+  /* Collect the directions the resource could leave by, in the order
+     they should be tried. The search itself is left to the batch. */
+  Direction dirs[6];
   int sources = 0;
+  int tr = transporters();
 
   /* Directions where transporters are idle (zero slots waiting) */
   int flags = (res_waiting[0] ^ 0x3f) & transporter;
@@ -451,12 +675,7 @@ Flag::schedule_slot_to_known_dest(int slot_, unsigned int res_waiting[4]) {
     for (Direction k : cycle_directions_ccw()) {
       if (BIT_TEST(flags, k)) {
         tr &= ~BIT(k);
-        Flag *other_flag = other_endpoint.f[k];
-        if (other_flag->search_num != search.get_id()) {
-          other_flag->search_dir = k;
-          search.add_source(other_flag);
-          sources += 1;
-        }
+        dirs[sources++] = k;
       }
     }
   }
@@ -467,12 +686,7 @@ Flag::schedule_slot_to_known_dest(int slot_, unsigned int res_waiting[4]) {
       for (Direction k : cycle_directions_ccw()) {
         if (BIT_TEST(flags, k)) {
           tr &= ~BIT(k);
-          Flag *other_flag = other_endpoint.f[k];
-          if (other_flag->search_num != search.get_id()) {
-            other_flag->search_dir = k;
-            search.add_source(other_flag);
-            sources += 1;
-          }
+          dirs[sources++] = k;
         }
       }
     }
@@ -482,12 +696,7 @@ Flag::schedule_slot_to_known_dest(int slot_, unsigned int res_waiting[4]) {
       for (Direction k : cycle_directions_ccw()) {
         if (BIT_TEST(flags, k)) {
           tr &= ~BIT(k);
-          Flag *other_flag = other_endpoint.f[k];
-          if (other_flag->search_num != search.get_id()) {
-            other_flag->search_dir = k;
-            search.add_source(other_flag);
-            sources += 1;
-          }
+          dirs[sources++] = k;
         }
       }
       if (flags == 0) return;
@@ -495,23 +704,39 @@ Flag::schedule_slot_to_known_dest(int slot_, unsigned int res_waiting[4]) {
   }
 
   if (sources > 0) {
-    ScheduleKnownDestData data;
-    data.src = this;
-    data.dest = game->get_flag(this->slot[slot_].dest);
-    data.slot = slot_;
-    bool r = search.execute(schedule_known_dest_cb, false, true, &data);
-    if (!r || data.dest == this) {
-      /* Unable to deliver */
-      game->cancel_transported_resource(this->slot[slot_].type,
-                                        this->slot[slot_].dest);
-      this->slot[slot_].dest = 0;
-      endpoint |= BIT(7);
-    }
+    batch->add_known_dest(this, slot_, dirs, sources);
   } else {
     endpoint |= BIT(7);
   }
 }
 
+/* Request fetch of the resource in slot by the transporter in dir. */
+void
+Flag::schedule_slot_to_dir(int slot_, Direction dir) {
+  if (!is_scheduled(dir)) {
+    /* Item is requesting to be fetched */
+    other_end_dir[dir] = BIT(7) | (other_end_dir[dir] & 0x78) | slot_;
+  } else {
+    Player *player = game->get_player(get_owner());
+    int other_dir = other_end_dir[dir];
+    int prio_old = player->get_flag_prio(slot[other_dir & 7].type);
+    int prio_new = player->get_flag_prio(slot[slot_].type);
+    if (prio_new > prio_old) {
+      /* This item has the highest priority now */
+      other_end_dir[dir] = (other_end_dir[dir] & 0xf8) | slot_;
+    }
+    slot[slot_].dir = dir;
+  }
+}
+
+/* Give up on delivering the resource in slot to its destination. */
+void
+Flag::cancel_slot_dest(int slot_) {
+  game->cancel_transported_resource(slot[slot_].type, slot[slot_].dest);
+  slot[slot_].dest = 0;
+  endpoint |= BIT(7);
+}
+
 void
 Flag::prioritize_pickup(Direction dir, Player *player) {
   int res_next = -1;
@@ -604,6 +829,8 @@ Flag::restore_path_serf_info(Direction dir, SerfPathInfo *data) {
   other_endpoint.f[dir] = other_flag;
   other_flag->other_endpoint.f[other_dir] = this;
 
+  other_flag->invalidate_inventory_field();
+
   int max_serfs = max_path_serfs[len];
   if (serf_requested(dir)) max_serfs -= 1;
 
@@ -823,6 +1050,8 @@ Flag::merge_paths(MapPos pos_) {
     flag_2->length[dir_2] += serf_count;
   }
 
+  invalidate_inventory_field();
+
   /* Update serfs with reference to this flag. */
   Game::ListSerfs serfs = game->get_serfs_related_to(flag_1->get_index(),
                                                      dir_1);
@@ -836,8 +1065,9 @@ Flag::merge_paths(MapPos pos_) {
 }
 
 void
-Flag::update() {
+Flag::update(ScheduleBatch *batch) {
   const int max_transporters[] = { 1, 2, 3, 4, 6, 8, 11, 15 };
+  int old_transporters = transporters();
 
   /* Count and store in bitfield which directions
    have strictly more than 0,1,2,3 slots waiting. */
@@ -869,10 +1099,10 @@ Flag::update() {
         if (res_dir < 0) {
           if (slot[slot_].dest != 0) {
             /* Destination is known */
-            schedule_slot_to_known_dest(slot_, res_waiting);
+            schedule_slot_to_known_dest(slot_, res_waiting, batch);
           } else {
             /* Destination is not known */
-            schedule_slot_to_unknown_dest(slot_);
+            batch->add_unknown_dest(this, slot_);
           }
         }
       }
@@ -906,6 +1136,10 @@ Flag::update() {
       }
     }
   }
+
+  if (transporters() != old_transporters) {
+    invalidate_inventory_field();
+  }
 }
 
 typedef struct SendSerfToRoadData {
@@ -1024,6 +1258,21 @@ Flag::unlink_building() {
   clear_flags();
 }
 
+void
+Flag::relink_endpoints() {
+  for (Direction d : cycle_directions_cw()) {
+    if (d == DirectionUpLeft && has_building()) {
+      unsigned int index = other_endpoint.b[d]->get_index();
+      other_endpoint.b[d] = game->get_building(index);
+    } else if (has_path(d)) {
+      unsigned int index = other_endpoint.f[d]->get_index();
+      other_endpoint.f[d] = game->get_flag(index);
+    } else {
+      other_endpoint.f[d] = nullptr;
+    }
+  }
+}
+
 SaveReaderBinary&
 operator >> (SaveReaderBinary &reader, Flag &flag) {
   flag.pos = 0; /* Set correctly later. */
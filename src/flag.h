@@ -23,6 +23,7 @@
 #define SRC_FLAG_H_
 
 #include <vector>
+#include <map>
 
 #include "src/building.h"
 #include "src/objects.h"
@@ -43,6 +44,7 @@ class Player;
 class SaveReaderBinary;
 class SaveReaderText;
 class SaveWriterText;
+class ScheduleBatch;
 
 class Flag : public GameObject {
  protected:
@@ -74,9 +76,18 @@ class Flag : public GameObject {
   int bld_flags;
   int bld2_flags;
 
+  /* Cached nearest inventories, valid while inventory_field_gen matches
+     the generation of the owner in Game. */
+  int inventory_for_resource;
+  int inventory_for_serf;
+  unsigned int inventory_field_gen;
+
  public:
   Flag(Game *game, unsigned int index);
 
+  /* Hash of the state, for checking that two games run in lockstep. */
+  uint64_t get_state_hash() const;
+
   MapPos get_position() const { return pos; }
   void set_position(MapPos pos) { this->pos = pos; }
 
@@ -92,7 +103,7 @@ class Flag : public GameObject {
 
   /* Owner of this flag. */
   unsigned int get_owner() const { return owner; }
-  void set_owner(unsigned int _owner) { owner = _owner; }
+  void set_owner(unsigned int _owner);
 
   /* Bitmap showing whether the outgoing paths are land paths. */
   int land_paths() const { return endpoint & 0x3f; }
@@ -159,11 +170,9 @@ class Flag : public GameObject {
   bool accepts_serfs() const { return ((bld_flags >> 7) & 1); }
 
   void set_has_inventory() { bld_flags |= BIT(6); }
-  void set_accepts_resources(bool accepts) { accepts ? bld2_flags |= BIT(7) :
-                                                       bld2_flags &= ~BIT(7); }
-  void set_accepts_serfs(bool accepts) { accepts ? bld_flags |= BIT(7) :
-                                                   bld_flags &= ~BIT(7); }
-  void clear_flags() { bld_flags = 0; bld2_flags = 0; }
+  void set_accepts_resources(bool accepts);
+  void set_accepts_serfs(bool accepts);
+  void clear_flags();
 
   friend SaveReaderBinary&
     operator >> (SaveReaderBinary &reader, Flag &flag);
@@ -172,8 +181,6 @@ class Flag : public GameObject {
   friend SaveWriterText&
     operator << (SaveWriterText &writer, Flag &flag);
 
-  bool schedule_known_dest_cb_(Flag *src, Flag *dest, int slot);
-
   void reset_transport(Flag *other);
 
   void reset_destination_of_stolen_resources();
@@ -181,16 +188,31 @@ class Flag : public GameObject {
   void link_building(Building *building);
   void unlink_building();
   Building *get_building() { return other_endpoint.b[DirectionUpLeft]; }
+  /* Point the endpoints, copied from a flag of another game, at the flags
+     and the building with the same indexes in this game. */
+  void relink_endpoints();
 
   void invalidate_resource_path(Direction dir);
 
   int find_nearest_inventory_for_resource();
   int find_nearest_inventory_for_serf();
 
+  /* Raw access to the nearest inventory field, see
+     Game::update_inventory_field(). */
+  int get_inventory_for_resource() const { return inventory_for_resource; }
+  void set_inventory_for_resource(int flag) { inventory_for_resource = flag; }
+  int get_inventory_for_serf() const { return inventory_for_serf; }
+  void set_inventory_for_serf(int flag) { inventory_for_serf = flag; }
+  void reset_inventory_field(unsigned int gen) {
+    inventory_for_resource = -1;
+    inventory_for_serf = -1;
+    inventory_field_gen = gen;
+  }
+
   void link_with_flag(Flag *dest_flag, bool water_path, size_t length,
                       Direction in_dir, Direction out_dir);
 
-  void update();
+  void update(ScheduleBatch *batch);
 
   /* Get road length category value for real length.
    Determines number of serfs servicing the path segment.(?) */
@@ -211,12 +233,18 @@ class Flag : public GameObject {
 
  protected:
   void fix_scheduled();
-
-  void schedule_slot_to_unknown_dest(int slot);
-  void schedule_slot_to_known_dest(int slot, unsigned int res_waiting[4]);
+  void invalidate_inventory_field();
+  void validate_inventory_field();
+
+  void schedule_slot_to_unknown_dest(int slot, ScheduleBatch *batch);
+  void schedule_slot_to_known_dest(int slot, unsigned int res_waiting[4],
+                                   ScheduleBatch *batch);
+  void schedule_slot_to_dir(int slot, Direction dir);
+  void cancel_slot_dest(int slot);
   bool call_transporter(Direction dir, bool water);
 
   friend class FlagSearch;
+  friend class ScheduleBatch;
 };
 
 typedef bool flag_search_func(Flag *flag, void *data);
@@ -239,4 +267,43 @@ class FlagSearch {
                      bool land, bool transporter, void *data);
 };
 
+/* Resource slots waiting to be scheduled during one round of flag updates.
+   Flag::update() only records the slots; execute() then resolves them
+   together so that all slots of a flag heading for the same destination
+   share one search, and searches for resources no building asks for are
+   skipped. */
+class ScheduleBatch {
+ protected:
+  typedef struct Request {
+    Flag *flag;
+    int slot;
+    unsigned int dest;
+    int source_count;  /* -1 when the destination is not known */
+    Direction source_dir[6];
+    Direction result;
+  } Request;
+
+  Game *game;
+  std::vector<Request> requests;
+  std::map<unsigned int, int> demand;
+  std::vector<int> distance;
+
+  int &distance_of(const Flag *flag);
+  void resolve_known_dest(const std::vector<size_t> &group);
+  void resolve_known_dests();
+
+ public:
+  explicit ScheduleBatch(Game *game);
+
+  void add_known_dest(Flag *flag, int slot, const Direction dirs[],
+                      int count);
+  void add_unknown_dest(Flag *flag, int slot);
+
+  /* Number of buildings of player that still want resource (> 0 prio). */
+  int get_demand(unsigned int player, Resource::Type res);
+  void update_demand(Building *building, Resource::Type res);
+
+  void execute();
+};
+
 #endif  // SRC_FLAG_H_
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include "src/log.h"
 #include "src/version.h"
@@ -31,6 +32,7 @@
 #include "src/gfx.h"
 #include "src/interface.h"
 #include "src/game-manager.h"
+#include "src/savegame.h"
 #include "src/command_line.h"
 #include "src/video-sdl.h"
 
@@ -46,8 +48,15 @@ main(int argc, char *argv[]) {
   unsigned int screen_width = 0;
   unsigned int screen_height = 0;
   bool fullscreen = false;
+  unsigned int autosave = 0;
+  bool mapped_tiles = false;
 
   CommandLine command_line;
+  command_line.add_option('a', "Save the game every MINUTES minutes")
+                .add_parameter("MINUTES", [&autosave](std::istream& s) {
+                  s >> autosave;
+                  return true;
+                });
   command_line.add_option('d', "Set Debug output level")
                 .add_parameter("NUM", [](std::istream& s) {
                   int d;
@@ -73,6 +82,8 @@ main(int argc, char *argv[]) {
                   std::getline(s, save_file);
                   return true;
                 });
+  command_line.add_option('m', "Keep map tiles in files next to the saves",
+                          [&mapped_tiles](){ mapped_tiles = true; });
   command_line.add_option('r', "Set display resolution (e.g. 800x600)")
                 .add_parameter("RES",
                               [&screen_width, &screen_height](std::istream& s) {
@@ -107,6 +118,8 @@ main(int argc, char *argv[]) {
   }
 
   GameManager &game_manager = GameManager::get_instance();
+  game_manager.set_autosave_interval(autosave);
+  GameStore::get_instance().set_mapped_tiles(mapped_tiles);
 
   /* Either load a save game if specified or
      start a new game. */
@@ -120,6 +133,20 @@ main(int argc, char *argv[]) {
     }
   }
 
+  /* Decode the sprites of the game while the menu is shown. */
+  {
+    PGame game = game_manager.get_view();
+    std::vector<Color> colors;
+    for (unsigned int i = 0; i < GAME_MAX_PLAYER_COUNT; i++) {
+      Player *player = game->get_player(i);
+      if (player != nullptr) {
+        Player::Color color = player->get_color();
+        colors.push_back(Color(color.red, color.green, color.blue));
+      }
+    }
+    gfx.predecode_sprites(colors);
+  }
+
   /* Initialize interface */
   Interface interface;
   if ((screen_width == 0) || (screen_height == 0)) {
@@ -139,8 +166,12 @@ main(int argc, char *argv[]) {
   /* Start game loop */
   event_loop.run();
 
+  game_manager.stop_simulation();
   event_loop.del_handler(&interface);
 
+  /* Finish the saves still being written. */
+  GameStore::get_instance().wait_for_saves();
+
   Log::Info["main"] << "Cleaning up...";
 
   return EXIT_SUCCESS;
@@ -91,7 +91,12 @@ class RandomInput : public TextInput {
 GameInitBox::GameInitBox(Interface *interface)
   : random_input(new RandomInput())
   , minimap(new Minimap(nullptr))
-  , file_list(new ListSavedFiles()) {
+  , file_list(new ListSavedFiles())
+  , preview_stopping(false)
+  , preview_requested(0)
+  , preview_wanted(0)
+  , preview_size(0)
+  , preview_mission(false) {
   this->interface = interface;
 
   game_type = GameCustom;
@@ -109,6 +114,7 @@ GameInitBox::GameInitBox(Interface *interface)
   minimap->set_size(150, 160);
   add_float(minimap.get(), 190, 55);
 
+  preview_thread = std::thread(&GameInitBox::run_map_previews, this);
   generate_map_preview();
 
   random_input->set_random(custom_mission->get_random_base());
@@ -119,6 +125,7 @@ GameInitBox::GameInitBox(Interface *interface)
   file_list->set_displayed(false);
   file_list->set_selection_handler([this](const std::string &item) {
     Game game;
+    this->cancel_map_preview();
     if (GameStore::get_instance().load(item, &game)) {
       this->map = game.get_map();
       this->minimap->set_map(map);
@@ -128,6 +135,13 @@ GameInitBox::GameInitBox(Interface *interface)
 }
 
 GameInitBox::~GameInitBox() {
+  {
+    std::lock_guard<std::mutex> lock(preview_mutex);
+    preview_stopping = true;
+    preview_wanted = 0;
+  }
+  preview_wakeup.notify_all();
+  preview_thread.join();
 }
 
 void
@@ -546,22 +560,117 @@ GameInitBox::handle_player_click(unsigned int player_index, int cx, int cy) {
   return true;
 }
 
+/* Ask the preview thread for a map of the current mission. The minimap
+   keeps showing the previous map until a new one is ready. */
 void
 GameInitBox::generate_map_preview() {
-  map.reset(new Map(MapGeometry(mission->get_map_size())));
-  if (game_type == GameMission) {
-    ClassicMissionMapGenerator generator(*map, mission->get_random_base());
-    generator.init();
-    generator.generate();
-    map->init_tiles(generator);
+  {
+    std::lock_guard<std::mutex> lock(preview_mutex);
+    preview_size = mission->get_map_size();
+    preview_random = mission->get_random_base();
+    preview_mission = (game_type == GameMission);
+    preview_map.reset();
+    preview_wanted = ++preview_requested;
+  }
+  preview_wakeup.notify_all();
+}
+
+/* Abandon the preview being generated, if any. */
+void
+GameInitBox::cancel_map_preview() {
+  std::lock_guard<std::mutex> lock(preview_mutex);
+  preview_map.reset();
+  preview_wanted = 0;
+}
+
+void
+GameInitBox::update_map_preview() {
+  PMap ready;
+  {
+    std::lock_guard<std::mutex> lock(preview_mutex);
+    ready.swap(preview_map);
+  }
+
+  if (ready) {
+    map = ready;
+    minimap->set_map(map);
+    set_redraw();
+  }
+}
+
+void
+GameInitBox::run_map_previews() {
+  unsigned int done = 0;
+  while (true) {
+    unsigned int request;
+    unsigned int size;
+    Random random;
+    bool mission_map;
+    {
+      std::unique_lock<std::mutex> lock(preview_mutex);
+      preview_wakeup.wait(lock, [this, done]() {
+        return preview_stopping ||
+               (preview_wanted != 0 && preview_wanted != done);
+      });
+      if (preview_stopping) {
+        return;
+      }
+      request = preview_wanted;
+      size = preview_size;
+      random = preview_random;
+      mission_map = preview_mission;
+    }
+
+    make_map_preview(request, size, random, mission_map);
+    done = request;
+  }
+}
+
+/* Generate the map for a preview request. The terrain alone is published
+   first, then the map with its objects. The generator gives up within a
+   map row once a newer request has been made, or the box is closed. */
+void
+GameInitBox::make_map_preview(unsigned int request, unsigned int size,
+                              const Random &random, bool mission_map) {
+  MapGeometry geometry(size);
+  Map full(geometry);
+  std::unique_ptr<ClassicMapGenerator> generator;
+  if (mission_map) {
+    ClassicMissionMapGenerator *mission_generator =
+      new ClassicMissionMapGenerator(full, random);
+    generator.reset(mission_generator);
+    mission_generator->init();
   } else {
-    ClassicMapGenerator generator(*map, mission->get_random_base());
-    generator.init(MapGenerator::HeightGeneratorMidpoints, true);
-    generator.generate();
-    map->init_tiles(generator);
+    generator.reset(new ClassicMapGenerator(full, random));
+    generator->init(MapGenerator::HeightGeneratorMidpoints, true);
   }
 
-  minimap->set_map(map);
+  ClassicMapGenerator *source = generator.get();
+  generator->set_progress_handler(
+    [this, request, source, geometry](ClassicMapGenerator::Stage stage) {
+      if (preview_wanted != request) {
+        return false;
+      }
+      if (stage == ClassicMapGenerator::StageTerrain) {
+        PMap terrain(new Map(geometry));
+        terrain->init_tiles(*source);
+        publish_map_preview(request, terrain);
+      }
+      return true;
+    });
+  generator->generate();
 
-  set_redraw();
+  if (preview_wanted == request) {
+    PMap preview(new Map(geometry));
+    preview->init_tiles(*generator);
+    publish_map_preview(request, preview);
+  }
+}
+
+void
+GameInitBox::publish_map_preview(unsigned int request, PMap preview) {
+  std::lock_guard<std::mutex> lock(preview_mutex);
+  if (preview_wanted == request) {
+    preview_map = preview;
+  }
 }
@@ -22,8 +22,12 @@
 #ifndef SRC_GAME_INIT_H_
 #define SRC_GAME_INIT_H_
 
-#include <string>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 #include "src/gui.h"
 #include "src/game.h"
@@ -67,10 +71,28 @@ class GameInitBox : public GuiObject {
   std::unique_ptr<Minimap> minimap;
   std::unique_ptr<ListSavedFiles> file_list;
 
+  /* Map previews are generated on a thread of their own. A request
+     supersedes the ones before it, which the generator abandons within a
+     map row. The terrain is shown as soon as it is ready, and the complete
+     map once the objects have been placed. */
+  std::thread preview_thread;
+  std::mutex preview_mutex;
+  std::condition_variable preview_wakeup;
+  bool preview_stopping;
+  unsigned int preview_requested;
+  std::atomic<unsigned int> preview_wanted;
+  unsigned int preview_size;
+  Random preview_random;
+  bool preview_mission;
+  PMap preview_map;
+
  public:
   explicit GameInitBox(Interface *interface);
   virtual ~GameInitBox();
 
+  /* Show the latest preview finished on the preview thread. */
+  void update_map_preview();
+
  protected:
   void draw_box_icon(int x, int y, int sprite);
   void draw_box_string(int x, int y, const std::string &str);
@@ -82,6 +104,11 @@ class GameInitBox : public GuiObject {
   unsigned int get_next_character(unsigned int player);
   void apply_random(Random rnd);
   void generate_map_preview();
+  void cancel_map_preview();
+  void run_map_previews();
+  void make_map_preview(unsigned int request, unsigned int size,
+                        const Random &random, bool mission_map);
+  void publish_map_preview(unsigned int request, PMap preview);
 
   virtual void internal_draw();
   virtual bool handle_click_left(int x, int y);
@@ -21,9 +21,13 @@
 
 #include "src/game-manager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <utility>
 
+#include "src/freeserf.h"
+#include "src/log.h"
 #include "src/savegame.h"
 
 GameManager &
@@ -32,7 +36,12 @@ GameManager::get_instance() {
   return game_manager;
 }
 
-GameManager::GameManager() {
+GameManager::GameManager()
+  : simulating(false)
+  , simulation_stats()
+  , autosave_interval(0)
+  , published_version(0)
+  , view_version(0) {
 }
 
 GameManager::~GameManager() {
@@ -51,19 +60,305 @@ GameManager::del_handler(Handler *handler) {
 
 void
 GameManager::set_current_game(PGame new_game) {
+  stop_simulation();
+
   if (current_game) {
     for (Handler *handler : handlers) {
-      handler->on_end_game(current_game);
+      handler->on_end_game(view_game);
     }
   }
 
   current_game = std::move(new_game);
+  published_game.reset();
+  view_game.reset();
   if (!current_game) {
     return;
   }
 
+  published_game = std::make_shared<Game>();
+  published_game->copy_state(*current_game);
+  published_version = 0;
+  view_game = std::make_shared<Game>();
+  view_game->copy_state(*published_game);
+  view_version = 0;
+
   for (Handler *handler : handlers) {
-    handler->on_new_game(current_game);
+    handler->on_new_game(view_game);
+  }
+
+  start_simulation();
+}
+
+void
+GameManager::start_simulation() {
+  if (!current_game || simulating) {
+    return;
+  }
+
+  simulation_stats = SimulationStats();
+  simulating = true;
+  simulation = std::thread(&GameManager::run_simulation, this, current_game);
+}
+
+void
+GameManager::stop_simulation() {
+  if (!simulating) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    simulating = false;
+  }
+  command_posted.notify_one();
+  simulation.join();
+
+  /* Commands posted too late for the thread are run here. */
+  std::vector<FinishedCommand> finished;
+  run_commands(current_game.get(), &finished);
+  if (!finished.empty()) {
+    publish(current_game.get(), true);
+  }
+  finish_commands(finished);
+
+  Log::Debug["game"] << "Simulation stopped after "
+                     << simulation_stats.elapsed << " ticks: "
+                     << simulation_stats.updates << " updates ("
+                     << simulation_stats.catch_up << " late), "
+                     << simulation_stats.dropped << " dropped.";
+}
+
+GameManager::SimulationStats
+GameManager::get_simulation_stats() {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  return simulation_stats;
+}
+
+void
+GameManager::post_command(Command command) {
+  if (!current_game) {
+    return;
+  }
+
+  if (!simulating) {
+    command(current_game.get());
+    publish(current_game.get(), true);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    commands.push_back(PendingCommand{std::move(command), nullptr});
+  }
+  command_posted.notify_one();
+}
+
+void
+GameManager::run_command(Command command) {
+  if (!current_game) {
+    return;
+  }
+
+  if (!simulating) {
+    command(current_game.get());
+    publish(current_game.get(), true);
+    update_view(true);
+    return;
+  }
+
+  std::promise<void> done;
+  std::future<void> result = done.get_future();
+  {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    commands.push_back(PendingCommand{std::move(command), &done});
+  }
+  command_posted.notify_one();
+
+  /* The view is updated even if the command failed, as it may have
+     changed the game all the same. */
+  try {
+    result.get();
+  } catch (...) {
+    update_view(true);
+    throw;
+  }
+  update_view(true);
+}
+
+/* Run the queued commands. Those that someone waits for are returned in
+   finished, to be finished once their effect is published. */
+void
+GameManager::run_commands(Game *game,
+                          std::vector<FinishedCommand> *finished) {
+  std::deque<PendingCommand> pending;
+  {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    pending.swap(commands);
+  }
+
+  for (PendingCommand &command : pending) {
+    std::exception_ptr error;
+    try {
+      command.command(game);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    if (command.done != nullptr) {
+      finished->push_back(FinishedCommand{command.done, error});
+    } else if (error) {
+      try {
+        std::rethrow_exception(error);
+      } catch (const std::exception &e) {
+        Log::Error["game"] << "Command failed: " << e.what();
+      }
+    }
+  }
+}
+
+/* Copy the state of game for the view to pick up. Unless wait is set,
+   nothing is published while the view is being updated. */
+bool
+GameManager::publish(Game *game, bool wait) {
+  std::unique_lock<std::mutex> lock(publish_mutex, std::defer_lock);
+  if (wait) {
+    lock.lock();
+  } else if (!lock.try_lock()) {
+    return false;
+  }
+
+  published_game->copy_state(*game);
+  published_version += 1;
+  return true;
+}
+
+void
+GameManager::finish_commands(const std::vector<FinishedCommand> &finished) {
+  for (const FinishedCommand &command : finished) {
+    if (command.error) {
+      command.done->set_exception(command.error);
+    } else {
+      command.done->set_value();
+    }
+  }
+}
+
+bool
+GameManager::update_view(bool wait) {
+  std::unique_lock<std::mutex> lock(publish_mutex, std::defer_lock);
+  if (wait) {
+    lock.lock();
+  } else if (!lock.try_lock()) {
+    return false;
+  }
+
+  if (!view_game || view_version == published_version) {
+    return false;
+  }
+
+  view_game->copy_state(*published_game);
+  view_version = published_version;
+  return true;
+}
+
+void
+GameManager::set_autosave_interval(unsigned int minutes) {
+  autosave_interval = minutes * 60 * TICKS_PER_SEC;
+}
+
+void
+GameManager::autosave(PGame game) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+
+  GameStore &store = GameStore::get_instance();
+  GameStore::PSnapshot snapshot = store.snapshot(game.get());
+  if (!snapshot) {
+    return;
+  }
+  store.save_in_background(store.get_folder_path() + "/autosave.save",
+                           snapshot);
+
+  std::chrono::milliseconds pause =
+    std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                          start);
+  Log::Debug["game"] << "Autosave took a snapshot in " << pause.count()
+                     << " ms.";
+}
+
+/* Keep game time in step with wall time. Each wakeup runs every tick that
+   has fallen due since the last one, so a slow tick is made up for by
+   running late updates back to back. At most SIMULATION_MAX_CATCH_UP
+   updates are run at once; time beyond that is dropped so that a stall
+   cannot turn into a burst of fast-forward.
+   Commands wake the thread and run right away, between two ticks. The
+   state of the game is published after the commands and the updates of
+   each wakeup. */
+#define SIMULATION_MAX_CATCH_UP  10
+
+void
+GameManager::run_simulation(PGame game) {
+  typedef std::chrono::steady_clock Clock;
+  const std::chrono::milliseconds tick_length(TICK_LENGTH);
+  const Clock::time_point start = Clock::now();
+  Clock::time_point next_tick = start + tick_length;
+  unsigned int since_autosave = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(command_mutex);
+      command_posted.wait_until(lock, next_tick, [this] {
+        return !simulating || !commands.empty();
+      });
+      if (!simulating) {
+        break;
+      }
+    }
+
+    std::vector<FinishedCommand> finished;
+    run_commands(game.get(), &finished);
+
+    Clock::time_point now = Clock::now();
+    if (now < next_tick) {
+      if (!finished.empty()) {
+        publish(game.get(), true);
+        finish_commands(finished);
+      }
+      continue;
+    }
+
+    unsigned int due = 1;
+    if (now > next_tick) {
+      due += static_cast<unsigned int>((now - next_tick) / tick_length);
+    }
+    unsigned int run = std::min(due, (unsigned int)SIMULATION_MAX_CATCH_UP);
+
+    for (unsigned int i = 0; i < run; i++) {
+      game->update();
+    }
+    next_tick += due * tick_length;
+
+    since_autosave += run;
+    if (autosave_interval != 0 && since_autosave >= autosave_interval) {
+      autosave(game);
+      since_autosave = 0;
+    }
+
+    /* Someone waits for the commands to show, so the view is not skipped
+       even if it is being updated. */
+    publish(game.get(), !finished.empty());
+    finish_commands(finished);
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    simulation_stats.elapsed =
+      static_cast<unsigned int>((now - start) / tick_length);
+    simulation_stats.updates += run;
+    simulation_stats.catch_up += run - 1;
+    if (due > run) {
+      simulation_stats.dropped += due - run;
+      Log::Debug["game"] << "Simulation fell behind, dropped "
+                         << (due - run) << " ticks.";
+    }
   }
 }
 
@@ -80,6 +375,8 @@ GameManager::start_game(PGameInfo game_info) {
     return false;
   }
 
+  /* A game whose tiles cannot be mapped is still playable from the heap. */
+  GameStore::get_instance().map_tiles(new_game.get());
   set_current_game(new_game);
 
   return true;
@@ -92,8 +389,9 @@ GameManager::load_game(const std::string &path) {
     return false;
   }
 
-  set_current_game(new_game);
   new_game->pause();
+  GameStore::get_instance().map_tiles(new_game.get());
+  set_current_game(new_game);
 
   return true;
 }
@@ -22,15 +22,38 @@
 #ifndef SRC_GAME_MANAGER_H_
 #define SRC_GAME_MANAGER_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
 #include <list>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "src/mission.h"
 #include "src/game.h"
 
 class GameManager {
  public:
+  /* A change to the current game, made with the game holding still. */
+  typedef std::function<void(Game *game)> Command;
+
+  /* Progress of the simulation thread, counted in ticks of TICK_LENGTH.
+     Wall time that could not be made up within the catch-up limit is
+     counted as dropped, so elapsed = updates + dropped (+ one pending). */
+  struct SimulationStats {
+    unsigned int elapsed;   /* Wall time since the simulation started */
+    unsigned int updates;   /* Game updates run */
+    unsigned int catch_up;  /* Updates run late to make up for lost time */
+    unsigned int dropped;   /* Ticks skipped to keep up with wall time */
+  };
+
+  /* Handlers are given the view of a game, see get_view(). */
   class Handler {
    public:
     virtual void on_new_game(PGame game) = 0;
@@ -38,9 +61,38 @@ class GameManager {
   };
 
  protected:
+  typedef struct PendingCommand {
+    Command command;
+    std::promise<void> *done;  /* Kept once the effect is published */
+  } PendingCommand;
+
+  typedef struct FinishedCommand {
+    std::promise<void> *done;
+    std::exception_ptr error;
+  } FinishedCommand;
+
   PGame current_game;
   typedef std::list<Handler*> Handlers;
   Handlers handlers;
+  std::thread simulation;
+  std::atomic<bool> simulating;
+  std::mutex stats_mutex;
+  SimulationStats simulation_stats;
+  std::atomic<unsigned int> autosave_interval;
+
+  /* Commands wait here until the simulation thread runs them. */
+  std::mutex command_mutex;
+  std::condition_variable command_posted;
+  std::deque<PendingCommand> commands;
+
+  /* The current game as of the last tick or command, and the copy of it
+     that the interface reads. Each is versioned, and the view is only
+     copied again once a newer state has been published. */
+  std::mutex publish_mutex;
+  PGame published_game;
+  unsigned int published_version;
+  PGame view_game;
+  unsigned int view_version;
 
   GameManager();
 
@@ -52,14 +104,51 @@ class GameManager {
   void add_handler(Handler *handler);
   void del_handler(Handler *handler);
 
+  /* The game that is simulated. Only touch it with the simulation
+     stopped, or through commands. */
   PGame get_current_game() { return current_game; }
+  /* A copy of the current game for the interface to read. Changes made
+     to it are lost when it is brought up to date. */
+  PGame get_view() { return view_game; }
 
   bool start_random_game();
   bool start_game(PGameInfo game_info);
   bool load_game(const std::string &path);
 
+  /* The current game is updated every tick on a thread of its own, which
+     publishes the state of the game after each update. */
+  void start_simulation();
+  void stop_simulation();
+  SimulationStats get_simulation_stats();
+
+  /* Run command on the current game between two ticks and return at
+     once. Commands run in the order they are posted, and right away when
+     the game is not simulated. */
+  void post_command(Command command);
+  /* Run command like post_command() and wait until it has run. The view
+     is brought up to date before returning, so it shows the effect of the
+     command, and objects of the view may be gone. Exceptions thrown by
+     command are thrown here. */
+  void run_command(Command command);
+
+  /* Copy the last published state of the game to the view, if it is
+     newer. Unless wait is set, the view is left as it is while a state
+     is being published. Returns whether the view changed. Commands and
+     view updates are for the thread that reads the view. */
+  bool update_view(bool wait = false);
+
+  /* Save the game every so many minutes of simulation, 0 for never. The
+     simulation only pauses to take a snapshot of the game; the file is
+     written in the background. */
+  void set_autosave_interval(unsigned int minutes);
+
  protected:
   void set_current_game(PGame new_game);
+  void run_simulation(PGame game);
+  void run_commands(Game *game, std::vector<FinishedCommand> *finished);
+  bool publish(Game *game, bool wait);
+  void finish_commands(const std::vector<FinishedCommand> &finished);
+  void autosave(PGame game);
 };
 
 #endif  // SRC_GAME_MANAGER_H_
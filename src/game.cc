@@ -29,7 +29,9 @@
 #include <algorithm>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <utility>
 
 #include "src/savegame.h"
 #include "src/debug.h"
@@ -39,8 +41,15 @@
 #include "src/map.h"
 #include "src/map-generator.h"
 #include "src/map-geometry.h"
+#include "src/thread-pool.h"
 
 #define GROUND_ANALYSIS_RADIUS  25
+/* Miners dig at the first 32 positions of the spiral: every position
+   within two steps, and the third shell except for the five corners
+   that come last in the spiral. */
+#define MINE_SPIRAL_LENGTH  32
+#define MINE_SPIRAL_SHELLS  3
+#define MINE_SPIRAL_END     37
 
 Game::Game()
   : map_gold_morale_factor(0)
@@ -52,7 +61,16 @@ Game::Game()
   , tutorial_level(0)
   , mission_level(0)
   , map_preserve_bugs(0)
-  , player_score_leader(0) {
+  , player_score_leader(0)
+  , serf_wheel_tick(0)
+  , serfs_tick(0)
+  , serfs_last_tick(0)
+  , serf_cursor(0)
+  , updating_serfs(false)
+  , serfs_sleep(true)
+  , serf_parallel_min(SERF_PARALLEL_MIN)
+  , committed_serf_plans(0)
+  , thread_pool(&ThreadPool::get_instance()) {
   players = Players(this);
   flags = Flags(this);
   inventories = Inventories(this);
@@ -96,6 +114,9 @@ Game::Game()
   knight_morale_counter = 0;
   inventory_schedule_counter = 0;
 
+  std::fill(std::begin(inventory_field_gen),
+            std::end(inventory_field_gen), 1);
+
   gold_total = 0;
 }
 
@@ -123,29 +144,42 @@ Game::clear_serf_request_failure() {
 
 void
 Game::update_knight_morale() {
-  for (Player *player : players) {
+  for_each_player_parallel([](Player *player) {
     player->update_knight_morale();
+  });
+}
+
+/* Run work for each player on the thread pool. The work for a player
+   must only change that player, which makes the outcome independent of
+   the order the players are done in. */
+void
+Game::for_each_player_parallel(std::function<void(Player*)> work) {
+  std::vector<Player*> list;
+  for (Player *player : players) {
+    list.push_back(player);
   }
+
+  thread_pool->parallel_for(0, list.size(), 1,
+                            [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      work(list[i]);
+    }
+  });
 }
 
-typedef struct UpdateInventoriesData {
-  Resource::Type resource;
-  int *max_prio;
-  Flag **flags;
-} UpdateInventoriesData;
+/* Flags with buildings reached by a search from a set of inventories,
+   in search order, along with the index of the inventory they were
+   reached from. */
+typedef struct InventoryReach {
+  std::vector<Inventory*> sources;
+  std::vector<std::pair<Flag*, int>> reached;
+} InventoryReach;
 
 bool
 Game::update_inventories_cb(Flag *flag, void *d) {
-  UpdateInventoriesData *data = reinterpret_cast<UpdateInventoriesData*>(d);
-  int inv = flag->get_search_dir();
-  if (data->max_prio[inv] < 255 && flag->has_building()) {
-    Building *building = flag->get_building();
-
-    int bld_prio = building->get_max_priority_for_resource(data->resource, 16);
-    if (bld_prio > data->max_prio[inv]) {
-      data->max_prio[inv] = bld_prio;
-      data->flags[inv] = flag;
-    }
+  InventoryReach *reach = reinterpret_cast<InventoryReach*>(d);
+  if (flag->has_building()) {
+    reach->reached.push_back(std::make_pair(flag, flag->get_search_dir()));
   }
 
   return false;
@@ -212,6 +246,12 @@ Game::update_inventories() {
     default: arr = arr_1; break;
   }
 
+  /* The road network does not change while inventories are updated, so
+     a search from a given set of inventories can be shared by all the
+     resource types that are available from the same set. Usually that
+     is a single search per player. */
+  std::list<InventoryReach> reaches[GAME_MAX_PLAYER_COUNT];
+
   while (arr[0] != Resource::TypeNone) {
     for (Player *player : players) {
       Inventory *invs[256];
@@ -250,7 +290,30 @@ Game::update_inventories() {
 
       if (n == 0) continue;
 
-      FlagSearch search(this);
+      std::vector<Inventory*> sources(invs, invs + n);
+      std::list<InventoryReach> &player_reaches =
+        reaches[player->get_index()];
+      InventoryReach *reach = nullptr;
+      for (InventoryReach &r : player_reaches) {
+        if (r.sources == sources) {
+          reach = &r;
+          break;
+        }
+      }
+
+      if (reach == nullptr) {
+        player_reaches.push_back(InventoryReach());
+        reach = &player_reaches.back();
+        reach->sources = sources;
+
+        FlagSearch search(this);
+        for (int i = 0; i < n; i++) {
+          Flag *flag = flags[invs[i]->get_flag_index()];
+          flag->set_search_dir((Direction)i);
+          search.add_source(flag);
+        }
+        search.execute(update_inventories_cb, false, true, reach);
+      }
 
       int max_prio[256];
       Flag *flags_[256];
@@ -258,16 +321,19 @@ Game::update_inventories() {
       for (int i = 0; i < n; i++) {
         max_prio[i] = 0;
         flags_[i] = NULL;
-        Flag *flag = flags[invs[i]->get_flag_index()];
-        flag->set_search_dir((Direction)i);
-        search.add_source(flag);
       }
 
-      UpdateInventoriesData data;
-      data.resource = arr[0];
-      data.max_prio = max_prio;
-      data.flags = flags_;
-      search.execute(update_inventories_cb, false, true, &data);
+      for (const std::pair<Flag*, int> &r : reach->reached) {
+        int inv = r.second;
+        if (max_prio[inv] < 255) {
+          Building *building = r.first->get_building();
+          int bld_prio = building->get_max_priority_for_resource(arr[0], 16);
+          if (bld_prio > max_prio[inv]) {
+            max_prio[inv] = bld_prio;
+            flags_[inv] = r.first;
+          }
+        }
+      }
 
       for (int i = 0; i < n; i++) {
         if (max_prio[i] > 0) {
@@ -292,9 +358,11 @@ Game::update_inventories() {
 /* Update flags as part of the game progression. */
 void
 Game::update_flags() {
+  ScheduleBatch batch(this);
   for (Flag *flag : flags) {
-    flag->update();
+    flag->update(&batch);
   }
+  batch.execute();
 }
 
 typedef struct SendSerfToFlagData {
@@ -462,29 +530,189 @@ Game::send_geologist(Flag *dest) {
                            Resource::TypeNone);
 }
 
-/* Update buildings as part of the game progression. */
+/* Update buildings as part of the game progression. Only the awake
+   buildings are visited, in index order. The bits are read anew after
+   each update since an update may wake buildings further on, which then
+   run in this same pass as they would have when visiting all. */
 void
 Game::update_buildings() {
-  Buildings blds(buildings);
-  Buildings::Iterator i = blds.begin();
-  while (i != blds.end()) {
-    Building *building = *i;
-    ++i;
-    building->update(tick);
+  unsigned int index = 0;
+  while (index < awake_buildings.size() * 64) {
+    uint64_t word = awake_buildings[index >> 6] >> (index & 63);
+    if (word == 0) {
+      index = (index | 63) + 1;
+      continue;
+    }
+
+    index += __builtin_ctzll(word);
+    Building *building = buildings[index];
+    if (building != nullptr) {
+      building->update(tick);
+    }
+
+    /* The update may have deleted the building. */
+    if (!buildings.exists(index) || buildings[index]->is_idle()) {
+      awake_buildings[index >> 6] &= ~(uint64_t(1) << (index & 63));
+    }
+
+    index += 1;
   }
 }
 
-/* Update serfs as part of the game progression. */
+/* Update serfs as part of the game progression. Like the buildings,
+   only the awake serfs are visited in index order, and a serf that
+   has nothing to do but count down for a while is put to sleep in the
+   wheel until it is due. */
 void
 Game::update_serfs() {
-  Serfs::Iterator i = serfs.begin();
-  while (i != serfs.end()) {
-    Serf *serf = *i;
-    ++i;
-    if (serf->get_index() != 0) {
-      serf->update();
+  wake_due_serfs();
+  plan_serf_updates();
+
+  serfs_last_tick = serfs_tick;
+  serfs_tick = tick;
+  updating_serfs = true;
+
+  unsigned int index = 0;
+  while (index < awake_serfs.size() * 64) {
+    uint64_t word = awake_serfs[index >> 6] >> (index & 63);
+    if (word == 0) {
+      index = (index | 63) + 1;
+      continue;
+    }
+
+    index += __builtin_ctzll(word);
+    serf_cursor = index;
+    Serf *serf = serfs[index];
+    if (serf != nullptr && index != 0) {
+      if ((index >> 6) < planned_serfs.size() &&
+          ((planned_serfs[index >> 6] >> (index & 63)) & 1)) {
+        if (serf->commit_update(serf_intents[index])) {
+          committed_serf_plans += 1;
+        }
+      } else {
+        serf->update();
+      }
     }
+
+    /* The update may have deleted the serf. */
+    int idle_ticks = -1;
+    if (serfs.exists(index)) {
+      idle_ticks = serfs_sleep ? serfs[index]->get_idle_ticks() : 0;
+    }
+    if (idle_ticks != 0) {
+      awake_serfs[index >> 6] &= ~(uint64_t(1) << (index & 63));
+      if (idle_ticks > 0) {
+        unsigned int due = tick + idle_ticks;
+        serf_wheel[due % SERF_WHEEL_SIZE].push_back({due, index});
+      }
+    }
+
+    index += 1;
   }
+
+  updating_serfs = false;
+  planned_serfs.clear();
+}
+
+/* Work out the coming updates of the awake serfs in parallel, each from
+   the serf and the map as they are before the serf update. The serf
+   update then commits them in index order. A plan is only committed if
+   what it was worked out from is unchanged when the serf's turn comes,
+   and otherwise the handler runs, so the outcome is the same as updating
+   the serfs one by one. Plans never draw random numbers; the draws all
+   happen in the serf update, in index order as before. */
+void
+Game::plan_serf_updates() {
+  planned_serfs.clear();
+  if (thread_pool->get_thread_count() == 0) return;
+
+  size_t awake = 0;
+  for (uint64_t word : awake_serfs) {
+    awake += __builtin_popcountll(word);
+  }
+  if (awake == 0 || awake < serf_parallel_min) return;
+
+  planned_serfs.resize(awake_serfs.size(), 0);
+  if (serf_intents.size() < awake_serfs.size() * 64) {
+    serf_intents.resize(awake_serfs.size() * 64);
+  }
+
+  const Map &plan_map = *map;
+  thread_pool->parallel_for(0, awake_serfs.size(), 16,
+                            [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      uint64_t word = awake_serfs[i];
+      uint64_t planned = 0;
+      while (word != 0) {
+        unsigned int bit = __builtin_ctzll(word);
+        unsigned int index = static_cast<unsigned int>(i * 64 + bit);
+        const Serf *serf = serfs[index];
+        if (serf != nullptr && index != 0) {
+          serf->plan_update(plan_map, &serf_intents[index]);
+          if (serf_intents[index].type != Serf::IntentNone) {
+            planned |= uint64_t(1) << bit;
+          }
+        }
+        word &= word - 1;
+      }
+      planned_serfs[i] = planned;
+    }
+  });
+}
+
+/* Wake the serfs whose wakeup tick has come since the last update. */
+void
+Game::wake_due_serfs() {
+  unsigned int slots = std::min(tick - serf_wheel_tick,
+                                static_cast<unsigned int>(SERF_WHEEL_SIZE));
+  for (unsigned int i = 1; i <= slots; i++) {
+    std::vector<SerfWakeup> &slot =
+      serf_wheel[(serf_wheel_tick + i) % SERF_WHEEL_SIZE];
+    size_t kept = 0;
+    for (const SerfWakeup &wakeup : slot) {
+      if (static_cast<int>(wakeup.tick - tick) <= 0) {
+        wake_serf(wakeup.serf);
+      } else {
+        slot[kept++] = wakeup;
+      }
+    }
+    slot.resize(kept);
+  }
+  serf_wheel_tick = tick;
+}
+
+/* Tick of the latest update of the serf when it had been visited, which
+   is the current tick for serfs already passed in an ongoing update. */
+unsigned int
+Game::get_serf_update_tick(unsigned int index) const {
+  if (updating_serfs && index > serf_cursor) {
+    return serfs_last_tick;
+  }
+  return serfs_tick;
+}
+
+bool
+Game::is_serf_asleep(unsigned int index) const {
+  if ((index >> 6) >= awake_serfs.size()) return true;
+  return ((awake_serfs[index >> 6] >> (index & 63)) & 1) == 0;
+}
+
+/* Put the serf back into the serf update. Stale wheel entries of a serf
+   that was woken early are harmless, as waking an awake serf does
+   nothing and an early update only counts down. */
+void
+Game::wake_serf(unsigned int index) {
+  if (!is_serf_asleep(index)) return;
+
+  Serf *serf = serfs[index];
+  if (serf != nullptr) {
+    serf->catch_up(get_serf_update_tick(index));
+  }
+
+  if ((index >> 6) >= awake_serfs.size()) {
+    awake_serfs.resize((index >> 6) + 1, 0);
+  }
+  awake_serfs[index >> 6] |= uint64_t(1) << (index & 63);
 }
 
 /* Update historical player statistics for one measure. */
@@ -493,18 +721,18 @@ Game::record_player_history(int max_level, int aspect,
                             const int history_index[],
                             const Values &values) {
   unsigned int total = 0;
-  for (auto value : values) {
-    total += value.second;
+  for (unsigned int value : values) {
+    total += value;
   }
   total = std::max(1u, total);
 
   for (int i = 0; i < max_level+1; i++) {
     int mode = (aspect << 2) | i;
     int index = history_index[i];
-    for (auto value : values) {
-      uint64_t val = value.second;
-      players[value.first]->set_player_stat_history(mode, index,
-                                           static_cast<int>((100*val)/total));
+    for (Player *player : players) {
+      uint64_t val = values[player->get_index()];
+      player->set_player_stat_history(mode, index,
+                                      static_cast<int>((100*val)/total));
     }
   }
 }
@@ -515,14 +743,14 @@ Game::record_player_history(int max_level, int aspect,
 int
 Game::calculate_clear_winner(const Values &values) {
   int total = 0;
-  for (auto value : values) {
-    total += value.second;
+  for (unsigned int value : values) {
+    total += value;
   }
   total = std::max(1, total);
 
-  for (auto value : values) {
-    uint64_t val = value.second;
-    if ((100*val)/total >= 75) return value.first;
+  for (size_t i = 0; i < values.size(); i++) {
+    uint64_t val = values[i];
+    if ((100*val)/total >= 75) return static_cast<int>(i);
   }
 
   return -1;
@@ -575,7 +803,7 @@ Game::update_game_stats() {
       }
     }
 
-    std::map<unsigned int, unsigned int> values;
+    Values values = {};
 
     /* Store land area stats in history. */
     for (Player *player : players) {
@@ -614,16 +842,136 @@ Game::update_game_stats() {
 
     int index = resource_history_index;
 
-    for (int res = 0; res < 26; res++) {
-      for (Player *player : players) {
+    for_each_player_parallel([](Player *player) {
+      for (int res = 0; res < 26; res++) {
         player->update_stats(res);
       }
-    }
+    });
 
     resource_history_index = index+1 < 120 ? index+1 : 0;
   }
 }
 
+uint64_t
+Game::state_hash() const {
+  uint64_t hash = map->get_state_hash();
+  hash = hash_combine(hash, tick);
+  hash = hash_combine(hash, rnd.get_state());
+  hash = hash_combine(hash, init_map_rnd.get_state());
+
+  for (const Serf *serf : serfs) {
+    hash = hash_combine(hash, serf->get_state_hash());
+  }
+  for (const Flag *flag : flags) {
+    hash = hash_combine(hash, flag->get_state_hash());
+  }
+  for (const Building *building : buildings) {
+    hash = hash_combine(hash, building->get_state_hash());
+  }
+  for (const Inventory *inventory : inventories) {
+    hash = hash_combine(hash, inventory->get_state_hash());
+  }
+
+  return hash;
+}
+
+void
+Game::copy_state(const Game &source) {
+  if (!map || map->geom() != source.map->geom()) {
+    map = std::make_shared<Map>(source.map->geom());
+    build_cache.reset();
+  }
+
+  /* A leveling site that is done changes what can be built around it
+     without changing any tile. */
+  for (const Building *building : source.buildings) {
+    const Building *old = buildings[building->get_index()];
+    if (old != nullptr && old->is_leveling() && !building->is_leveling()) {
+      map->mark_object_changed(building->get_position());
+    }
+  }
+  map->copy_state(*source.map);
+
+  map_gold_morale_factor = source.map_gold_morale_factor;
+  gold_total = source.gold_total;
+
+  players.copy_from(source.players);
+  flags.copy_from(source.flags);
+  inventories.copy_from(source.inventories);
+  buildings.copy_from(source.buildings);
+  serfs.copy_from(source.serfs);
+
+  /* The objects still point into source. */
+  for (Flag *flag : flags) {
+    flag->relink_endpoints();
+  }
+  for (Building *building : buildings) {
+    if (building->has_inventory()) {
+      unsigned int index = building->get_inventory()->get_index();
+      building->set_inventory(inventories[index]);
+    }
+  }
+  field_344 = (source.field_344 != nullptr) ?
+              inventories[source.field_344->get_index()] : nullptr;
+  military_index.copy_from(source.military_index, this);
+
+  init_map_rnd = source.init_map_rnd;
+  game_speed_save = source.game_speed_save;
+  game_speed = source.game_speed;
+  tick = source.tick;
+  last_tick = source.last_tick;
+  const_tick = source.const_tick;
+  game_stats_counter = source.game_stats_counter;
+  history_counter = source.history_counter;
+  rnd = source.rnd;
+  next_index = source.next_index;
+  flag_search_counter = source.flag_search_counter;
+  update_map_last_tick = source.update_map_last_tick;
+  update_map_counter = source.update_map_counter;
+  update_map_initial_pos = source.update_map_initial_pos;
+  tick_diff = source.tick_diff;
+  max_next_index = source.max_next_index;
+  update_map_16_loop = source.update_map_16_loop;
+  std::copy(std::begin(source.player_history_index),
+            std::end(source.player_history_index),
+            std::begin(player_history_index));
+  std::copy(std::begin(source.player_history_counter),
+            std::end(source.player_history_counter),
+            std::begin(player_history_counter));
+  resource_history_index = source.resource_history_index;
+  field_340 = source.field_340;
+  field_342 = source.field_342;
+  game_type = source.game_type;
+  tutorial_level = source.tutorial_level;
+  mission_level = source.mission_level;
+  map_preserve_bugs = source.map_preserve_bugs;
+  player_score_leader = source.player_score_leader;
+  knight_morale_counter = source.knight_morale_counter;
+  inventory_schedule_counter = source.inventory_schedule_counter;
+  std::copy(std::begin(source.inventory_field_gen),
+            std::end(source.inventory_field_gen),
+            std::begin(inventory_field_gen));
+
+  awake_buildings = source.awake_buildings;
+  awake_serfs = source.awake_serfs;
+  for (int i = 0; i < SERF_WHEEL_SIZE; i++) {
+    serf_wheel[i] = source.serf_wheel[i];
+  }
+  serf_wheel_tick = source.serf_wheel_tick;
+  serfs_tick = source.serfs_tick;
+  serfs_last_tick = source.serfs_last_tick;
+  serf_cursor = source.serf_cursor;
+  updating_serfs = source.updating_serfs;
+  planned_serfs = source.planned_serfs;
+  serf_intents = source.serf_intents;
+
+  for (int i = 0; i < GAME_MAX_PLAYER_COUNT; i++) {
+    influence_sum[i] = source.influence_sum[i];
+    influence_claims[i] = source.influence_claims[i];
+  }
+  influence_sources = source.influence_sources;
+}
+
 /* Update game state after tick increment. */
 void
 Game::update() {
@@ -721,37 +1069,15 @@ Game::speed_reset() {
   Log::Info["game"] << "Game speed: " << game_speed;
 }
 
-/* Generate an estimate of the amount of resources in the ground at map pos.*/
-void
-Game::get_resource_estimate(MapPos pos, int weight, int estimates[5]) {
-  if ((map->get_obj(pos) == Map::ObjectNone ||
-       map->get_obj(pos) >= Map::ObjectTree0) &&
-       map->get_res_type(pos) != Map::MineralsNone) {
-    int value = weight * map->get_res_amount(pos);
-    estimates[map->get_res_type(pos)] += value;
-  }
-}
-
-/* Prepare a ground analysis at position. */
+/* Prepare a ground analysis at position. The samples are weighted
+   linearly down with the distance from the position. */
 void
 Game::prepare_ground_analysis(MapPos pos, int estimates[5]) {
-  for (int i = 0; i < 5; i++) estimates[i] = 0;
-
-  /* Sample the cursor position with maximum weighting. */
-  get_resource_estimate(pos, GROUND_ANALYSIS_RADIUS, estimates);
-
-  /* Move outward in a spiral around the initial pos.
-     The weighting of the samples attenuates linearly
-     with the distance to the center. */
-  for (int i = 0; i < GROUND_ANALYSIS_RADIUS-1; i++) {
-    pos = map->move_right(pos);
-
-    for (Direction d : cycle_directions_cw(DirectionDown)) {
-      for (int j = 0; j < i+1; j++) {
-        get_resource_estimate(pos, GROUND_ANALYSIS_RADIUS-i, estimates);
-        pos = map->move(pos, d);
-      }
-    }
+  estimates[Map::MineralsNone] = 0;
+  for (int i = Map::MineralsGold; i <= Map::MineralsStone; i++) {
+    Map::Minerals mineral = static_cast<Map::Minerals>(i);
+    estimates[i] = map->get_mineral_estimate(pos, GROUND_ANALYSIS_RADIUS,
+                                             mineral);
   }
 
   /* Process the samples. */
@@ -761,6 +1087,32 @@ Game::prepare_ground_analysis(MapPos pos, int estimates[5]) {
   }
 }
 
+/* Return up to count positions where a mine can be placed, ordered by the
+   amount of mineral a miner there could reach, best first. Ties are
+   ordered by position. */
+std::vector<MapPos>
+Game::find_mine_sites(Map::Minerals mineral, unsigned int count) const {
+  typedef std::pair<Map::MineralSum, MapPos> Site;
+  std::vector<Site> sites;
+  for (MapPos pos : map->geom()) {
+    if (!can_build_mine(pos)) continue;
+    Map::MineralSum amount = map->get_mineral_amount(pos, MINE_SPIRAL_SHELLS,
+                                                     mineral);
+    for (int i = MINE_SPIRAL_LENGTH; i < MINE_SPIRAL_END; i++) {
+      amount -= map->get_counted_mineral(map->pos_add_spirally(pos, i),
+                                         mineral);
+    }
+    if (amount > 0) sites.push_back(Site(-amount, pos));
+  }
+
+  count = std::min(count, static_cast<unsigned int>(sites.size()));
+  std::partial_sort(sites.begin(), sites.begin() + count, sites.end());
+
+  std::vector<MapPos> result;
+  for (unsigned int i = 0; i < count; i++) result.push_back(sites[i].second);
+  return result;
+}
+
 bool
 Game::road_segment_in_water(MapPos pos, Direction dir) const {
   if (dir > DirectionDown) {
@@ -1339,6 +1691,36 @@ Game::can_player_build(MapPos pos, const Player *player) const {
   return true;
 }
 
+BuildCache::Build
+Game::get_build_possibility(MapPos pos, const Player *player) {
+  if (!build_cache || build_cache->get_map() != map) {
+    build_cache.reset(new BuildCache(map, GAME_MAX_PLAYER_COUNT));
+  }
+
+  int cached = build_cache->get(pos, player->get_index(),
+                                player->has_castle());
+  if (cached >= 0) return static_cast<BuildCache::Build>(cached);
+
+  BuildCache::Build build = BuildCache::BuildNone;
+  if (can_build_castle(pos, player)) {
+    build = BuildCache::BuildCastle;
+  } else if (can_player_build(pos, player) &&
+             Map::map_space_from_obj[map->get_obj(pos)] == Map::SpaceOpen &&
+             (can_build_flag(map->move_down_right(pos), player) ||
+              map->has_flag(map->move_down_right(pos)))) {
+    if (can_build_mine(pos)) {
+      build = BuildCache::BuildMine;
+    } else if (can_build_large(pos)) {
+      build = BuildCache::BuildLarge;
+    } else if (can_build_small(pos)) {
+      build = BuildCache::BuildSmall;
+    }
+  }
+
+  build_cache->set(pos, player->get_index(), build);
+  return build;
+}
+
 /* Checks whether a building of the specified type is possible at
    position. */
 bool
@@ -1435,6 +1817,7 @@ Game::build_building(MapPos pos, Building::Type type, Player *player) {
   bld->set_position(pos);
   Map::Object map_obj = bld->start_building(type);
   player->building_founded(bld);
+  if (bld->is_military()) military_index.add(bld);
 
   bool split_path = false;
   if (map->get_obj(map->move_down_right(pos)) != Map::ObjectFlag) {
@@ -1508,6 +1891,7 @@ Game::build_castle(MapPos pos, Player *player) {
   flag->set_position(map->move_down_right(pos));
   castle->set_owner(player->get_index());
   castle->start_building(Building::TypeCastle);
+  military_index.add(castle);
 
   flag->set_owner(player->get_index());
   flag->set_accepts_serfs(true);
@@ -1698,6 +2082,17 @@ Game::surrender_land(MapPos pos) {
 /* Initialize land ownership for whole map. */
 void
 Game::init_land_ownership() {
+  for (int i = 0; i < GAME_MAX_PLAYER_COUNT; i++) {
+    influence_sum[i].clear();
+    influence_claims[i].clear();
+  }
+  influence_sources.clear();
+
+  military_index.init(map->geom());
+  for (Building *building : buildings) {
+    if (building->is_military()) military_index.add(building);
+  }
+
   for (Building *building : buildings) {
     if (building->is_military()) {
       update_land_ownership(building->get_position());
@@ -1705,118 +2100,210 @@ Game::init_land_ownership() {
   }
 }
 
+/* Influence of military buildings on the positions around them.
+   Each building influences the 17*17 square centered on it: the
+   closeness of a position picks an entry from the influence table of
+   the building type, where -1 means the position is claimed outright. */
+static const int military_influence[] = {
+  0, 1, 2, 4, 7, 12, 18, 29, -1, -1,  /* hut */
+  0, 3, 5, 8, 11, 15, 22, 30, -1, -1,  /* tower */
+  0, 6, 10, 14, 19, 23, 27, 31, -1, -1  /* fortress */
+};
+
+static const int map_closeness[] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 0, 0, 0, 0, 0, 0, 0,
+  1, 2, 3, 3, 3, 3, 3, 3, 3, 2, 1, 0, 0, 0, 0, 0, 0,
+  1, 2, 3, 4, 4, 4, 4, 4, 4, 3, 2, 1, 0, 0, 0, 0, 0,
+  1, 2, 3, 4, 5, 5, 5, 5, 5, 4, 3, 2, 1, 0, 0, 0, 0,
+  1, 2, 3, 4, 5, 6, 6, 6, 6, 5, 4, 3, 2, 1, 0, 0, 0,
+  1, 2, 3, 4, 5, 6, 7, 7, 7, 6, 5, 4, 3, 2, 1, 0, 0,
+  1, 2, 3, 4, 5, 6, 7, 8, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+  1, 2, 3, 4, 5, 6, 7, 8, 9, 8, 7, 6, 5, 4, 3, 2, 1,
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 7, 6, 5, 4, 3, 2, 1,
+  0, 0, 1, 2, 3, 4, 5, 6, 7, 7, 7, 6, 5, 4, 3, 2, 1,
+  0, 0, 0, 1, 2, 3, 4, 5, 6, 6, 6, 6, 5, 4, 3, 2, 1,
+  0, 0, 0, 0, 1, 2, 3, 4, 5, 5, 5, 5, 5, 4, 3, 2, 1,
+  0, 0, 0, 0, 0, 1, 2, 3, 4, 4, 4, 4, 4, 4, 3, 2, 1,
+  0, 0, 0, 0, 0, 0, 1, 2, 3, 3, 3, 3, 3, 3, 3, 2, 1,
+  0, 0, 0, 0, 0, 0, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+#define INFLUENCE_RADIUS  8
+#define INFLUENCE_DIAMETER  (1 + 2*INFLUENCE_RADIUS)
+
+/* Influence type of a building as it stands: 0 for hut, 1 for tower,
+   2 for fortress or castle, or -1 if it has no military influence. */
+int
+Game::get_influence_type(Building *building) {
+  MapPos pos = building->get_position();
+  // TODO(_): Why wouldn't the path be set?
+  if (map->get_obj(pos) < Map::ObjectSmallBuilding ||
+      map->get_obj(pos) > Map::ObjectCastle ||
+      !map->has_path(pos, DirectionDownRight) ||
+      building->is_burning()) {
+    return -1;
+  }
+
+  if (building->get_type() == Building::TypeCastle) {
+    /* Castle has military influence even when not done. */
+    return 2;
+  } else if (building->is_done() && building->is_active()) {
+    switch (building->get_type()) {
+      case Building::TypeHut: return 0;
+      case Building::TypeTower: return 1;
+      case Building::TypeFortress: return 2;
+      default: break;
+    }
+  }
+
+  return -1;
+}
+
+/* Add (delta 1) or subtract (delta -1) the influence of a building of
+   the given influence type at pos to the field of player. */
+void
+Game::add_influence(unsigned int player, MapPos pos, int type, int delta) {
+  /* Kernels of influence values and claims per building type. */
+  static int16_t kernel_sum[3][INFLUENCE_DIAMETER*INFLUENCE_DIAMETER];
+  static uint8_t kernel_claim[3][INFLUENCE_DIAMETER*INFLUENCE_DIAMETER];
+  static std::once_flag kernels_initialized;
+  std::call_once(kernels_initialized, []() {
+    for (int t = 0; t < 3; t++) {
+      for (int k = 0; k < INFLUENCE_DIAMETER*INFLUENCE_DIAMETER; k++) {
+        int inf = military_influence[10*t + map_closeness[k]];
+        kernel_sum[t][k] = std::max(inf, 0);
+        kernel_claim[t][k] = (inf < 0) ? 1 : 0;
+      }
+    }
+  });
+
+  std::vector<int16_t> &sum = influence_sum[player];
+  std::vector<uint8_t> &claims = influence_claims[player];
+  if (sum.empty()) {
+    sum.resize(map->geom().tile_count());
+    claims.resize(map->geom().tile_count());
+  }
+
+  unsigned int cols = map->get_cols();
+  unsigned int first_col = (map->pos_col(pos) - INFLUENCE_RADIUS) &
+                           map->get_col_mask();
+  for (int k = 0; k < INFLUENCE_DIAMETER; k++) {
+    unsigned int row = (map->pos_row(pos) + k - INFLUENCE_RADIUS) &
+                       map->get_row_mask();
+    int16_t *sum_row = &sum[map->pos(0, row)];
+    uint8_t *claim_row = &claims[map->pos(0, row)];
+    const int16_t *ks = kernel_sum[type] + INFLUENCE_DIAMETER*k;
+    const uint8_t *kc = kernel_claim[type] + INFLUENCE_DIAMETER*k;
+
+    /* The row is split in two runs where it wraps around the map. */
+    unsigned int run = std::min(static_cast<unsigned int>(INFLUENCE_DIAMETER),
+                                cols - first_col);
+    for (unsigned int l = 0; l < run; l++) {
+      sum_row[first_col + l] += delta * ks[l];
+      claim_row[first_col + l] += delta * kc[l];
+    }
+    for (unsigned int l = run; l < INFLUENCE_DIAMETER; l++) {
+      sum_row[l - run] += delta * ks[l];
+      claim_row[l - run] += delta * kc[l];
+    }
+  }
+}
+
+/* Bring the influence recorded for building in line with its state. */
+void
+Game::update_building_influence(Building *building) {
+  unsigned int index = building->get_index();
+  if (index >= influence_sources.size()) {
+    influence_sources.resize(index + 1);
+  }
+  InfluenceSource &source = influence_sources[index];
+
+  int type = get_influence_type(building);
+  if (type == source.type &&
+      (type < 0 || (source.owner == building->get_owner() &&
+                    source.pos == building->get_position()))) {
+    return;
+  }
+
+  remove_building_influence(index);
+  if (type >= 0) {
+    source.type = type;
+    source.owner = building->get_owner();
+    source.pos = building->get_position();
+    add_influence(source.owner, source.pos, source.type, 1);
+  }
+}
+
+void
+Game::remove_building_influence(unsigned int index) {
+  if (index >= influence_sources.size()) return;
+
+  InfluenceSource &source = influence_sources[index];
+  if (source.type >= 0) {
+    add_influence(source.owner, source.pos, source.type, -1);
+    source.type = -1;
+  }
+}
+
+/* Military influence of player at pos, 128 if it is claimed outright. */
+int
+Game::get_influence(unsigned int player, MapPos pos) const {
+  if (influence_sum[player].empty()) return 0;
+  if (influence_claims[player][pos] > 0) return 128;
+  return std::min(static_cast<int>(influence_sum[player][pos]), 127);
+}
+
 /* Update land ownership around map position. */
 void
 Game::update_land_ownership(MapPos init_pos) {
   /* Currently the below algorithm will only work when
      both influence_radius and calculate_radius are 8. */
-  const int influence_radius = 8;
-  const int influence_diameter = 1 + 2*influence_radius;
+  const int influence_radius = INFLUENCE_RADIUS;
 
   int calculate_radius = influence_radius;
   int calculate_diameter = 1 + 2*calculate_radius;
 
-  size_t temp_arr_size = calculate_diameter * calculate_diameter *
-                         players.size();
-  std::unique_ptr<int[]> temp_arr =
-    std::unique_ptr<int[]>(new int[temp_arr_size]());
-
-  const int military_influence[] = {
-    0, 1, 2, 4, 7, 12, 18, 29, -1, -1,  /* hut */
-    0, 3, 5, 8, 11, 15, 22, 30, -1, -1,  /* tower */
-    0, 6, 10, 14, 19, 23, 27, 31, -1, -1  /* fortress */
-  };
-
-  const int map_closeness[] = {
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
-    1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 0, 0, 0, 0, 0, 0, 0,
-    1, 2, 3, 3, 3, 3, 3, 3, 3, 2, 1, 0, 0, 0, 0, 0, 0,
-    1, 2, 3, 4, 4, 4, 4, 4, 4, 3, 2, 1, 0, 0, 0, 0, 0,
-    1, 2, 3, 4, 5, 5, 5, 5, 5, 4, 3, 2, 1, 0, 0, 0, 0,
-    1, 2, 3, 4, 5, 6, 6, 6, 6, 5, 4, 3, 2, 1, 0, 0, 0,
-    1, 2, 3, 4, 5, 6, 7, 7, 7, 6, 5, 4, 3, 2, 1, 0, 0,
-    1, 2, 3, 4, 5, 6, 7, 8, 8, 7, 6, 5, 4, 3, 2, 1, 0,
-    1, 2, 3, 4, 5, 6, 7, 8, 9, 8, 7, 6, 5, 4, 3, 2, 1,
-    0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 7, 6, 5, 4, 3, 2, 1,
-    0, 0, 1, 2, 3, 4, 5, 6, 7, 7, 7, 6, 5, 4, 3, 2, 1,
-    0, 0, 0, 1, 2, 3, 4, 5, 6, 6, 6, 6, 5, 4, 3, 2, 1,
-    0, 0, 0, 0, 1, 2, 3, 4, 5, 5, 5, 5, 5, 4, 3, 2, 1,
-    0, 0, 0, 0, 0, 1, 2, 3, 4, 4, 4, 4, 4, 4, 3, 2, 1,
-    0, 0, 0, 0, 0, 0, 1, 2, 3, 3, 3, 3, 3, 3, 3, 2, 1,
-    0, 0, 0, 0, 0, 0, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1,
-    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1
-  };
-
-  /* Find influence from buildings in 33*33 square
-     around the center. */
-  for (int i = -(influence_radius+calculate_radius);
-       i <= influence_radius+calculate_radius; i++) {
-    for (int j = -(influence_radius+calculate_radius);
-         j <= influence_radius+calculate_radius; j++) {
-      MapPos pos = map->pos_add(init_pos, j, i);
-
-      if (map->get_obj(pos) >= Map::ObjectSmallBuilding &&
-          map->get_obj(pos) <= Map::ObjectCastle &&
-          map->has_path(pos,
-                   DirectionDownRight)) {  // TODO(_): Why wouldn't this be set?
-        Building *building = get_building_at_pos(pos);
-        int mil_type = -1;
-
-        if (building->get_type() == Building::TypeCastle) {
-          /* Castle has military influence even when not done. */
-          mil_type = 2;
-        } else if (building->is_done() && building->is_active()) {
-          switch (building->get_type()) {
-            case Building::TypeHut: mil_type = 0; break;
-            case Building::TypeTower: mil_type = 1; break;
-            case Building::TypeFortress: mil_type = 2; break;
-            default: break;
-          }
-        }
-
-        if (mil_type >= 0 && !building->is_burning()) {
-          const int *influence = military_influence + 10*mil_type;
-          const int *closeness = map_closeness +
-                                 influence_diameter*std::max(-i, 0) +
-                                 std::max(-j, 0);
-          int *arr = temp_arr.get() +
-            (building->get_owner() * calculate_diameter*calculate_diameter) +
-            calculate_diameter * std::max(i, 0) + std::max(j, 0);
-
-          for (int k = 0; k < influence_diameter - abs(i); k++) {
-            for (int l = 0; l < influence_diameter - abs(j); l++) {
-              int inf = influence[*closeness];
-              if (inf < 0) {
-                *arr = 128;
-              } else if (*arr < 128) {
-                *arr = std::min(*arr + inf, 127);
-              }
+  /* Bring the influence of the buildings that reach the square up to
+     date. Buildings elsewhere may be out of date, but they do not
+     influence the square. */
+  MilitaryIndex::ListBuildings nearby;
+  for (Player *player : players) {
+    military_index.find(init_pos, influence_radius+calculate_radius,
+                        player->get_index(), &nearby);
+  }
 
-              closeness += 1;
-              arr += 1;
-            }
-            closeness += abs(j);
-            arr += abs(j);
-          }
-        }
-      }
-    }
+  for (Building *building : nearby) {
+    update_building_influence(building);
   }
 
-  /* Update owner of 17*17 square. */
+  /* Find the strongest player for each position of the square before
+     anything is changed, as surrendering land can demolish buildings. */
+  std::unique_ptr<int[]> strongest =
+    std::unique_ptr<int[]>(new int[calculate_diameter*calculate_diameter]);
   for (int i = -calculate_radius; i <= calculate_radius; i++) {
     for (int j = -calculate_radius; j <= calculate_radius; j++) {
+      MapPos pos = map->pos_add(init_pos, j, i);
       int max_val = 0;
       int player_index = -1;
       for (Player *player : players) {
-        const int *arr = temp_arr.get() +
-          player->get_index()*calculate_diameter*calculate_diameter +
-          calculate_diameter*(i+calculate_radius) + (j+calculate_radius);
-        if (*arr > max_val) {
-          max_val = *arr;
+        int val = get_influence(player->get_index(), pos);
+        if (val > max_val) {
+          max_val = val;
           player_index = player->get_index();
         }
       }
+      strongest[calculate_diameter*(i+calculate_radius) +
+                (j+calculate_radius)] = player_index;
+    }
+  }
+
+  /* Update owner of 17*17 square. */
+  for (int i = -calculate_radius; i <= calculate_radius; i++) {
+    for (int j = -calculate_radius; j <= calculate_radius; j++) {
+      int player_index = strongest[calculate_diameter*(i+calculate_radius) +
+                                   (j+calculate_radius)];
 
       MapPos pos = map->pos_add(init_pos, j, i);
       int old_player = -1;
@@ -1839,18 +2326,18 @@ Game::update_land_ownership(MapPos init_pos) {
   }
 
   /* Update military building flag state. */
-  for (int i = -25; i <= 25; i++) {
-    for (int j = -25; j <= 25; j++) {
-      MapPos pos = map->pos_add(init_pos, i, j);
+  nearby.clear();
+  for (Player *player : players) {
+    military_index.find(init_pos, 25, player->get_index(), &nearby);
+  }
 
-      if (map->get_obj(pos) >= Map::ObjectSmallBuilding &&
-          map->get_obj(pos) <= Map::ObjectCastle &&
-          map->has_path(pos, DirectionDownRight)) {
-        Building *building = buildings[map->get_obj_index(pos)];
-        if (building->is_done() && building->is_military()) {
-          building->update_military_flag_state();
-        }
-      }
+  for (Building *building : nearby) {
+    MapPos pos = building->get_position();
+    if (map->get_obj(pos) >= Map::ObjectSmallBuilding &&
+        map->get_obj(pos) <= Map::ObjectCastle &&
+        map->has_path(pos, DirectionDownRight) &&
+        building->is_done()) {
+      building->update_military_flag_state();
     }
   }
 }
@@ -1882,7 +2369,9 @@ Game::occupy_enemy_building(Building *building, int player_num) {
   /* Take the building. */
   Player *player = players[player_num];
 
+  military_index.remove(building);
   player->building_captured(building);
+  military_index.add(building);
 
   if (building->get_type() == Building::TypeCastle) {
     demolish_building_(building->get_position());
@@ -2000,19 +2489,103 @@ Game::add_player(unsigned int intelligence, unsigned int supplies,
 }
 
 bool
-Game::init(unsigned int map_size, const Random &random) {
+Game::init(unsigned int map_size, const Random &random, bool parallel_map) {
   init_map_rnd = random;
 
   map.reset(new Map(MapGeometry(map_size)));
-  ClassicMissionMapGenerator generator(*map, init_map_rnd);
-  generator.init();
-  generator.generate();
-  map->init_tiles(generator);
+  std::unique_ptr<ClassicMapGenerator> generator;
+  if (parallel_map) {
+    generator.reset(new ParallelMapGenerator(*map, init_map_rnd,
+                                             thread_pool));
+  } else {
+    generator.reset(new ClassicMissionMapGenerator(*map, init_map_rnd));
+  }
+  generator->init(MapGenerator::HeightGeneratorMidpoints, true);
+  generator->generate();
+  map->init_tiles(*generator);
   gold_total = map->get_gold_deposit();
+  military_index.init(map->geom());
 
   return true;
 }
 
+/* Mark the nearest inventory field of player as outdated. */
+void
+Game::invalidate_inventory_field(unsigned int player) {
+  if (player >= GAME_MAX_PLAYER_COUNT) return;
+
+  inventory_field_gen[player] += 1;
+  if (inventory_field_gen[player] == 0) inventory_field_gen[player] = 1;
+}
+
+unsigned int
+Game::get_inventory_field_gen(unsigned int player) const {
+  if (player >= GAME_MAX_PLAYER_COUNT) return 0;
+  return inventory_field_gen[player];
+}
+
+/* Recompute the nearest inventory of every flag owned by player.
+
+   Instead of searching outward from each flag, one breadth-first search
+   is started from all accepting inventories at once and follows roads
+   backwards. A road is followed when a search from the far flag would have
+   been allowed to take it: resources need a transporter on that side, serfs
+   need a land road. Flags reached at the same depth from several
+   inventories are assigned to the inventory with the lowest flag index. */
+void
+Game::update_inventory_field(unsigned int player) {
+  if (player >= GAME_MAX_PLAYER_COUNT) return;
+
+  unsigned int gen = inventory_field_gen[player];
+
+  std::vector<Flag*> res_queue;
+  std::vector<Flag*> serf_queue;
+  for (Flag *flag : flags) {
+    if (flag->get_index() == 0 || flag->get_owner() != player) continue;
+
+    flag->reset_inventory_field(gen);
+    if (flag->accepts_resources()) {
+      flag->set_inventory_for_resource(flag->get_index());
+      res_queue.push_back(flag);
+    }
+    if (flag->accepts_serfs()) {
+      flag->set_inventory_for_serf(flag->get_index());
+      serf_queue.push_back(flag);
+    }
+  }
+
+  for (size_t i = 0; i < res_queue.size(); i++) {
+    Flag *flag = res_queue[i];
+    for (Direction d : cycle_directions_ccw()) {
+      if (!flag->has_path(d)) continue;
+
+      Flag *other_flag = flag->get_other_end_flag(d);
+      if (other_flag->get_owner() == player &&
+          other_flag->get_inventory_for_resource() < 0 &&
+          other_flag->has_transporter(flag->get_other_end_dir(d))) {
+        other_flag->set_inventory_for_resource(
+                                          flag->get_inventory_for_resource());
+        res_queue.push_back(other_flag);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < serf_queue.size(); i++) {
+    Flag *flag = serf_queue[i];
+    for (Direction d : cycle_directions_ccw()) {
+      if (!flag->has_path(d)) continue;
+
+      Flag *other_flag = flag->get_other_end_flag(d);
+      if (other_flag->get_owner() == player &&
+          other_flag->get_inventory_for_serf() < 0 &&
+          !other_flag->is_water_path(flag->get_other_end_dir(d))) {
+        other_flag->set_inventory_for_serf(flag->get_inventory_for_serf());
+        serf_queue.push_back(other_flag);
+      }
+    }
+  }
+}
+
 /* Cancel a resource being transported to destination. This
    ensures that the destination can request a new resource. */
 void
@@ -2068,7 +2641,11 @@ Game::create_serf(int index) {
 
 void
 Game::delete_serf(Serf *serf) {
-  serfs.erase(serf->get_index());
+  unsigned int index = serf->get_index();
+  if ((index >> 6) < planned_serfs.size()) {
+    planned_serfs[index >> 6] &= ~(uint64_t(1) << (index & 63));
+  }
+  serfs.erase(index);
 }
 
 Flag *
@@ -2105,10 +2682,29 @@ Game::create_building(int index) {
 
 void
 Game::delete_building(Building *building) {
+  if (building->is_military()) military_index.remove(building);
+  remove_building_influence(building->get_index());
   map->set_object(building->get_position(), Map::ObjectNone, 0);
   buildings.erase(building->get_index());
 }
 
+void
+Game::wake_building(unsigned int index) {
+  if ((index >> 6) >= awake_buildings.size()) {
+    awake_buildings.resize((index >> 6) + 1, 0);
+  }
+  awake_buildings[index >> 6] |= uint64_t(1) << (index & 63);
+}
+
+void
+Game::wake_player_buildings(unsigned int player) {
+  for (Building *building : buildings) {
+    if (building->get_owner() == player) {
+      wake_building(building->get_index());
+    }
+  }
+}
+
 Game::ListSerfs
 Game::get_player_serfs(Player *player) {
   ListSerfs player_serfs;
@@ -2511,8 +3107,26 @@ operator >> (SaveReaderText &reader, Game &game) {
 
   /* Initialize remaining map dimensions. */
   game.map.reset(new Map(MapGeometry(size)));
-  for (SaveReaderText* subreader : reader.get_sections("map")) {
-    *subreader >> *game.map;
+  if (game_reader->has_value("map.tiles")) {
+    /* The tiles were saved in files of their own, which must not have
+       changed since. */
+    std::string path;
+    std::string hash;
+    game_reader->value("map.tiles") >> path;
+    game_reader->value("map.hash") >> hash;
+    if (!game.map->load_mapped_tiles(path)) {
+      throw ExceptionFreeserf("Failed to map tiles from " + path);
+    }
+    if (std::to_string(game.map->get_state_hash()) != hash) {
+      throw ExceptionFreeserf("Tiles in " + path +
+                              " changed since the game was saved");
+    }
+    /* Ownership is rebuilt below along with the land area of players. */
+    for (MapPos pos : game.map->geom()) game.map->del_owner(pos);
+  } else {
+    for (SaveReaderText* subreader : reader.get_sections("map")) {
+      *subreader >> *game.map;
+    }
   }
 
 //  std::string version;
@@ -2705,7 +3319,13 @@ operator << (SaveWriterText &writer, Game &game) {
     serf_writer << *serf;
   }
 
-  writer << *game.map;
+  /* Mapped tiles are in their files already, synced by the caller. */
+  if (game.map->is_mapped()) {
+    writer.value("map.tiles") << game.map->get_tiles_path();
+    writer.value("map.hash") << std::to_string(game.map->get_state_hash());
+  } else {
+    writer << *game.map;
+  }
 
   return writer;
 }
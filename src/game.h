@@ -22,10 +22,12 @@
 #ifndef SRC_GAME_H_
 #define SRC_GAME_H_
 
+#include <array>
 #include <vector>
 #include <map>
 #include <string>
 #include <list>
+#include <functional>
 #include <memory>
 
 #include "src/player.h"
@@ -33,6 +35,8 @@
 #include "src/serf.h"
 #include "src/inventory.h"
 #include "src/map.h"
+#include "src/build-cache.h"
+#include "src/military-index.h"
 #include "src/random.h"
 #include "src/objects.h"
 
@@ -40,9 +44,18 @@
 
 #define GAME_MAX_PLAYER_COUNT  4
 
+#define SERF_WHEEL_SIZE  256
+
+/* Number of awake serfs from which their updates are planned in parallel
+   ahead of the serf update. */
+#ifndef SERF_PARALLEL_MIN
+# define SERF_PARALLEL_MIN  2048
+#endif
+
 class SaveReaderBinary;
 class SaveReaderText;
 class SaveWriterText;
+class ThreadPool;
 
 class Game {
  public:
@@ -59,7 +72,8 @@ class Game {
 
   PMap map;
 
-  typedef std::map<unsigned int, unsigned int> Values;
+  /* Value of some measure for each player, by player index. */
+  typedef std::array<unsigned int, GAME_MAX_PLAYER_COUNT> Values;
   int map_gold_morale_factor;
   unsigned int gold_total;
 
@@ -102,6 +116,57 @@ class Game {
   int knight_morale_counter;
   int inventory_schedule_counter;
 
+  /* Generation of the nearest inventory field per player. */
+  unsigned int inventory_field_gen[GAME_MAX_PLAYER_COUNT];
+
+  MilitaryIndex military_index;
+  std::unique_ptr<BuildCache> build_cache;
+
+  /* One bit per building index for the buildings due in the next
+     building update. A building whose update would only repeat itself
+     goes to sleep and is woken by whatever changes its stock, its serf
+     or the settings of its owner. */
+  std::vector<uint64_t> awake_buildings;
+
+  /* Serfs that only count down until some tick sleep in a wheel of
+     slots keyed by that tick, and the serf update visits only the awake
+     serfs. A sleeping serf catches up on the skipped count when it
+     wakes, from the tick its last update would have had. */
+  typedef struct SerfWakeup {
+    unsigned int tick;
+    unsigned int serf;
+  } SerfWakeup;
+  std::vector<uint64_t> awake_serfs;
+  std::vector<SerfWakeup> serf_wheel[SERF_WHEEL_SIZE];
+  unsigned int serf_wheel_tick;
+  unsigned int serfs_tick;
+  unsigned int serfs_last_tick;
+  unsigned int serf_cursor;
+  bool updating_serfs;
+  bool serfs_sleep;
+
+  /* Awake serfs whose coming update was planned ahead, and the plan of
+     each by serf index. */
+  std::vector<uint64_t> planned_serfs;
+  std::vector<Serf::Intent> serf_intents;
+  unsigned int serf_parallel_min;
+  unsigned int committed_serf_plans;
+
+  ThreadPool *thread_pool;
+
+  /* Military influence of each player on each map position: the sum of
+     influence values and the number of buildings claiming the position
+     outright. The influence each building has added is recorded so it
+     can be taken back when the building changes. */
+  typedef struct InfluenceSource {
+    int type = -1;
+    unsigned int owner = 0;
+    MapPos pos = 0;
+  } InfluenceSource;
+  std::vector<int16_t> influence_sum[GAME_MAX_PLAYER_COUNT];
+  std::vector<uint8_t> influence_claims[GAME_MAX_PLAYER_COUNT];
+  std::vector<InfluenceSource> influence_sources;
+
  public:
   Game();
   virtual ~Game();
@@ -114,6 +179,17 @@ class Game {
   unsigned int get_gold_total() const { return gold_total; }
   void add_gold_total(int delta);
 
+  /* Hash of the simulation state: map tiles, serfs, flags, buildings,
+     inventories, the game tick and the random generators. Two games that
+     agree on it are in lockstep. */
+  uint64_t state_hash() const;
+
+  /* Take over the state of source, a game this one is a copy of or that
+     is new, so that this game goes on as source does. The map keeps its
+     change handlers, which hear of the tiles that differ, and settings
+     such as the thread pool stay as they are. */
+  void copy_state(const Game &source);
+
   Building *get_building_at_pos(MapPos pos);
   Flag *get_flag_at_pos(MapPos pos);
   Serf *get_serf_at_pos(MapPos pos);
@@ -121,7 +197,8 @@ class Game {
   /* External interface */
   unsigned int add_player(unsigned int intelligence, unsigned int supplies,
                           unsigned int reproduction);
-  bool init(unsigned int map_size, const Random &random);
+  bool init(unsigned int map_size, const Random &random,
+            bool parallel_map = false);
 
   void update();
   void pause();
@@ -130,6 +207,8 @@ class Game {
   void speed_reset();
 
   void prepare_ground_analysis(MapPos pos, int estimates[5]);
+  std::vector<MapPos> find_mine_sites(Map::Minerals mineral,
+                                      unsigned int count) const;
   bool send_geologist(Flag *dest);
 
   int get_leveling_height(MapPos pos) const;
@@ -143,6 +222,9 @@ class Game {
   bool can_build_castle(MapPos pos, const Player *player) const;
   bool can_build_flag(MapPos pos, const Player *player) const;
   bool can_player_build(MapPos pos, const Player *player) const;
+  /* What player could build at pos, as shown in build mode. The result
+     is cached until the map around pos changes. */
+  BuildCache::Build get_build_possibility(MapPos pos, const Player *player);
 
   int can_build_road(const Road &road, const Player *player,
                      MapPos *dest, bool *water) const;
@@ -169,10 +251,30 @@ class Game {
   void update_land_ownership(MapPos pos);
   void occupy_enemy_building(Building *building, int player);
 
+  void invalidate_inventory_field(unsigned int player);
+  unsigned int get_inventory_field_gen(unsigned int player) const;
+  void update_inventory_field(unsigned int player);
+
   void cancel_transported_resource(Resource::Type type, unsigned int dest);
   void lose_resource(Resource::Type type);
 
   uint16_t random_int();
+  /* New games draw from a generator seeded with the time of day; seed it
+     to make the game repeatable. */
+  void set_random(const Random &random) { rnd = random; }
+  /* Whether idle serfs sleep between updates (the default). Polling
+     every serf on every update gives the same game, only slower. */
+  void set_serfs_sleep(bool sleep) { serfs_sleep = sleep; }
+  /* Pool the update spreads its parallel work over, the shared pool
+     unless set. The pool must outlive the game. */
+  void set_thread_pool(ThreadPool *pool) { thread_pool = pool; }
+  /* Plan the serf updates in parallel once this many serfs are awake,
+     SERF_PARALLEL_MIN unless set. Planned or not, the game is the same. */
+  void set_serf_parallel_min(unsigned int count) {
+    serf_parallel_min = count; }
+  /* Number of planned serf updates carried out as planned so far. */
+  unsigned int get_committed_serf_plans() const {
+    return committed_serf_plans; }
 
   bool send_serf_to_flag(Flag *dest, Serf::Type type, Resource::Type res1,
                          Resource::Type res2);
@@ -190,6 +292,11 @@ class Game {
   void delete_inventory(Inventory *inventory);
   Building *create_building(int index = -1);
   void delete_building(Building *building);
+  void wake_building(unsigned int index);
+  void wake_serf(unsigned int index);
+  bool is_serf_asleep(unsigned int index) const;
+  unsigned int get_serf_update_tick(unsigned int index) const;
+  void wake_player_buildings(unsigned int player);
 
   Serf *get_serf(unsigned int index) { return serfs[index]; }
   Flag *get_flag(unsigned int index) { return flags[index]; }
@@ -199,6 +306,7 @@ class Game {
 
   ListSerfs get_player_serfs(Player *player);
   ListBuildings get_player_buildings(Player *player);
+  const MilitaryIndex &get_military_index() const { return military_index; }
   ListSerfs get_serfs_in_inventory(Inventory *inventory);
   ListSerfs get_serfs_related_to(unsigned int dest, Direction dir);
   ListInventories get_player_inventories(Player *player);
@@ -213,17 +321,19 @@ class Game {
  protected:
   void clear_serf_request_failure();
   void update_knight_morale();
+  void for_each_player_parallel(std::function<void(Player*)> work);
   static bool update_inventories_cb(Flag *flag, void *data);
   void update_inventories();
   void update_flags();
   static bool send_serf_to_flag_search_cb(Flag *flag, void *data);
   void update_buildings();
   void update_serfs();
+  void wake_due_serfs();
+  void plan_serf_updates();
   void record_player_history(int max_level, int aspect,
                              const int history_index[], const Values &values);
   int calculate_clear_winner(const Values &values);
   void update_game_stats();
-  void get_resource_estimate(MapPos pos, int weight, int estimates[5]);
   bool road_segment_in_water(MapPos pos, Direction dir) const;
   void flag_reset_transport(Flag *flag);
   void building_remove_player_refs(Building *building);
@@ -237,6 +347,11 @@ class Game {
   bool demolish_building_(MapPos pos);
   void surrender_land(MapPos pos);
   void demolish_flag_and_roads(MapPos pos);
+  int get_influence_type(Building *building);
+  void add_influence(unsigned int player, MapPos pos, int type, int delta);
+  void update_building_influence(Building *building);
+  void remove_building_influence(unsigned int index);
+  int get_influence(unsigned int player, MapPos pos) const;
 
  public:
   friend SaveReaderBinary&
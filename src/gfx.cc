@@ -23,10 +23,12 @@
 
 #include <utility>
 #include <algorithm>
+#include <tuple>
 
 #include "src/log.h"
 #include "src/data.h"
 #include "src/video.h"
+#include "src/thread-pool.h"
 
 const Color Color::black = Color(0x00, 0x00, 0x00);
 const Color Color::white = Color(0xff, 0xff, 0xff);
@@ -109,11 +111,55 @@ Image::clear_cache() {
     image_cache.erase(image_cache.begin());
     delete image;
   }
+
+  std::lock_guard<std::mutex> lock(sprite_mutex);
+  sprite_cache.clear();
+}
+
+/* Decoded sprite cache, filled from background threads */
+Image::SpriteCache Image::sprite_cache;
+std::mutex Image::sprite_mutex;
+
+void
+Image::cache_sprite(uint64_t id, Data::PSprite sprite) {
+  std::lock_guard<std::mutex> lock(sprite_mutex);
+  sprite_cache[id] = sprite;
+}
+
+Data::PSprite
+Image::get_cached_sprite(uint64_t id) {
+  std::lock_guard<std::mutex> lock(sprite_mutex);
+  SpriteCache::iterator result = sprite_cache.find(id);
+  if (result == sprite_cache.end()) {
+    return nullptr;
+  }
+  return result->second;
+}
+
+void
+Image::uncache_sprite(uint64_t id) {
+  std::lock_guard<std::mutex> lock(sprite_mutex);
+  sprite_cache.erase(id);
+}
+
+/* Data sources that are not reentrant decode one sprite at a time. */
+static std::mutex decode_mutex;
+
+static Data::PSprite
+decode_sprite(Data::PSource source, Data::Resource res, unsigned int index,
+              const Data::Sprite::Color &color) {
+  if (source->is_reentrant()) {
+    return source->get_sprite(res, index, color);
+  }
+
+  std::lock_guard<std::mutex> lock(decode_mutex);
+  return source->get_sprite(res, index, color);
 }
 
 Graphics *Graphics::instance = nullptr;
 
-Graphics::Graphics() {
+Graphics::Graphics()
+  : predecode_stopping(false) {
   if (instance != nullptr) {
     throw ExceptionGFX("Unable to create second instance.");
   }
@@ -132,10 +178,18 @@ Graphics::Graphics() {
                     static_cast<unsigned int>(sprite->get_width()),
                     static_cast<unsigned int>(sprite->get_height()));
 
+  unsigned int hardware = std::thread::hardware_concurrency();
+  predecode_pool.reset(new ThreadPool((hardware > 1) ? hardware - 1 : 0));
+
   Graphics::instance = this;
 }
 
 Graphics::~Graphics() {
+  if (predecode_thread.joinable()) {
+    predecode_stopping = true;
+    predecode_thread.join();
+  }
+
   Image::clear_cache();
 }
 
@@ -145,6 +199,18 @@ Graphics::get_instance() {
   return graphics;
 }
 
+/* Return the decoded sprite, from the cache if it was decoded ahead. */
+Data::PSprite
+Frame::get_sprite(Data::Resource res, unsigned int index,
+                  const Data::Sprite::Color &color) {
+  uint64_t id = Data::Sprite::create_id(res, index, 0, 0, color);
+  Data::PSprite sprite = Image::get_cached_sprite(id);
+  if (sprite) {
+    return sprite;
+  }
+  return decode_sprite(data_source, res, index, color);
+}
+
 /* Draw the opaque sprite with data file index of
    sprite at x, y in dest frame. */
 void
@@ -162,7 +228,7 @@ Frame::draw_sprite(int x, int y, Data::Resource res, unsigned int index,
   uint64_t id = Data::Sprite::create_id(res, index, 0, 0, pc);
   Image *image = Image::get_cached_image(id);
   if (image == nullptr) {
-    Data::PSprite s = data_source->get_sprite(res, index, pc);
+    Data::PSprite s = get_sprite(res, index, pc);
     if (!s) {
       Log::Warn["graphics"] << "Failed to decode sprite #"
                             << Data::get_resource_name(res) << ":" << index;
@@ -171,6 +237,7 @@ Frame::draw_sprite(int x, int y, Data::Resource res, unsigned int index,
 
     image = new Image(video, s);
     Image::cache_image(id, image);
+    Image::uncache_sprite(id);
   }
 
   if (use_off) {
@@ -206,8 +273,8 @@ Frame::draw_sprite_relatively(int x, int y, Data::Resource res,
                               unsigned int index,
                               Data::Resource relative_to_res,
                               unsigned int relative_to_index) {
-  Data::PSprite s = data_source->get_sprite(relative_to_res, relative_to_index,
-                                            {0, 0, 0, 0});
+  Data::PSprite s = get_sprite(relative_to_res, relative_to_index,
+                               {0, 0, 0, 0});
   if (s == nullptr) {
     Log::Warn["graphics"] << "Failed to decode sprite #"
                           << Data::get_resource_name(res) << ":" << index;
@@ -230,15 +297,14 @@ Frame::draw_masked_sprite(int x, int y, Data::Resource mask_res,
                                         {0, 0, 0, 0});
   Image *image = Image::get_cached_image(id);
   if (image == nullptr) {
-    Data::PSprite s = data_source->get_sprite(res, index, {0, 0, 0, 0});
+    Data::PSprite s = get_sprite(res, index, {0, 0, 0, 0});
     if (!s) {
       Log::Warn["graphics"] << "Failed to decode sprite #"
                             << Data::get_resource_name(res) << ":" << index;
       return;
     }
 
-    Data::PSprite m = data_source->get_sprite(mask_res, mask_index,
-                                              {0, 0, 0, 0});
+    Data::PSprite m = get_sprite(mask_res, mask_index, {0, 0, 0, 0});
     if (!m) {
       Log::Warn["graphics"] << "Failed to decode sprite #"
                             << Data::get_resource_name(mask_res)
@@ -277,7 +343,7 @@ Frame::draw_waves_sprite(int x, int y, Data::Resource mask_res,
                                         {0, 0, 0, 0});
   Image *image = Image::get_cached_image(id);
   if (image == nullptr) {
-    Data::PSprite s = data_source->get_sprite(res, index, {0, 0, 0, 0});
+    Data::PSprite s = get_sprite(res, index, {0, 0, 0, 0});
     if (!s) {
       Log::Warn["graphics"] << "Failed to decode sprite #"
                             << Data::get_resource_name(res) << ":" << index;
@@ -285,8 +351,7 @@ Frame::draw_waves_sprite(int x, int y, Data::Resource mask_res,
     }
 
     if (mask_res > 0) {
-      Data::PSprite m = data_source->get_sprite(mask_res, mask_index,
-                                                {0, 0, 0, 0});
+      Data::PSprite m = get_sprite(mask_res, mask_index, {0, 0, 0, 0});
       if (!m) {
         Log::Warn["graphics"] << "Failed to decode sprite #"
                               << Data::get_resource_name(mask_res)
@@ -521,3 +586,64 @@ void
 Graphics::get_screen_factor(float *fx, float *fy) {
   video->get_screen_factor(fx, fy);
 }
+
+void
+Graphics::predecode_sprites(const std::vector<Color> &player_colors) {
+  if (predecode_thread.joinable()) {
+    return;
+  }
+
+  typedef std::tuple<Data::Resource, unsigned int, Data::Sprite::Color> Job;
+  std::vector<Job> jobs;
+  auto add_resource = [&jobs](Data::Resource res,
+                              const Data::Sprite::Color &color) {
+    for (unsigned int i = 0; i < Data::get_resource_count(res); i++) {
+      jobs.push_back(Job(res, i, color));
+    }
+  };
+
+  add_resource(Data::AssetMapGround, {0, 0, 0, 0});
+  add_resource(Data::AssetMapMaskUp, {0, 0, 0, 0});
+  add_resource(Data::AssetMapMaskDown, {0, 0, 0, 0});
+  add_resource(Data::AssetPathGround, {0, 0, 0, 0});
+  add_resource(Data::AssetPathMask, {0, 0, 0, 0});
+  add_resource(Data::AssetMapObject, {0, 0, 0, 0});
+  add_resource(Data::AssetMapShadow, {0, 0, 0, 0});
+  add_resource(Data::AssetGameObject, {0, 0, 0, 0});
+  add_resource(Data::AssetSerfShadow, {0, 0, 0, 0});
+  for (const Color &color : player_colors) {
+    add_resource(Data::AssetSerfTorso, {color.get_blue(), color.get_green(),
+                                        color.get_red(), color.get_alpha()});
+  }
+
+  predecode_stopping = false;
+  predecode_thread = std::thread([this, jobs]() {
+    Data::PSource source = Data::get_instance().get_data_source();
+    auto decode = [this, &jobs, source](size_t first, size_t last) {
+      for (size_t i = first; i < last && !predecode_stopping; i++) {
+        Data::Resource res = std::get<0>(jobs[i]);
+        unsigned int index = std::get<1>(jobs[i]);
+        const Data::Sprite::Color &color = std::get<2>(jobs[i]);
+        Data::PSprite sprite = decode_sprite(source, res, index, color);
+        if (sprite) {
+          Image::cache_sprite(Data::Sprite::create_id(res, index, 0, 0, color),
+                              sprite);
+        }
+      }
+    };
+
+    try {
+      if (source->is_reentrant()) {
+        predecode_pool->parallel_for(0, jobs.size(), 32, decode);
+      } else {
+        decode(0, jobs.size());
+      }
+    } catch (ExceptionFreeserf &e) {
+      Log::Warn["graphics"] << "Failed to decode sprites ahead: " << e.what();
+      return;
+    }
+
+    Log::Debug["graphics"] << "Decoded " << jobs.size()
+                           << " sprites ahead of use";
+  });
+}
@@ -22,14 +22,20 @@
 #ifndef SRC_GFX_H_
 #define SRC_GFX_H_
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "src/data.h"
 #include "src/debug.h"
 #include "src/video.h"
 
+class ThreadPool;
+
 class ExceptionGFX : public ExceptionFreeserf {
  public:
   explicit ExceptionGFX(const std::string &description);
@@ -92,6 +98,10 @@ class Image {
   typedef std::map<uint64_t, Image*> ImageCache;
   static ImageCache image_cache;
 
+  typedef std::map<uint64_t, Data::PSprite> SpriteCache;
+  static SpriteCache sprite_cache;
+  static std::mutex sprite_mutex;
+
  public:
   Image(Video *video, Data::PSprite sprite);
   virtual ~Image();
@@ -110,6 +120,13 @@ class Image {
   static Image *get_cached_image(uint64_t id);
   static void clear_cache();
 
+  /* Sprites decoded ahead of time, ready to be made into images. A sprite
+     is dropped once its own image is cached; sprites that masked images
+     are made from stay, as every mask combination needs them. */
+  static void cache_sprite(uint64_t id, Data::PSprite sprite);
+  static Data::PSprite get_cached_sprite(uint64_t id);
+  static void uncache_sprite(uint64_t id);
+
   Video::Image *get_video_image() const { return video_image; }
 };
 
@@ -161,6 +178,8 @@ class Frame {
   void draw_frame(int dx, int dy, int sx, int sy, Frame *src, int w, int h);
 
  protected:
+  Data::PSprite get_sprite(Data::Resource res, unsigned int index,
+                           const Data::Sprite::Color &color);
   void draw_char_sprite(int x, int y, unsigned char c, const Color &color,
                         const Color &shadow);
   void draw_sprite(int x, int y, Data::Resource res, unsigned int index,
@@ -171,6 +190,11 @@ class Graphics {
  protected:
   static Graphics *instance;
   Video *video;
+  std::thread predecode_thread;
+  std::atomic<bool> predecode_stopping;
+  /* Sprites are decoded on a pool of their own, so that a game tick
+     waiting on the shared pool never picks up decoding work. */
+  std::unique_ptr<ThreadPool> predecode_pool;
 
   Graphics();
 
@@ -194,6 +218,11 @@ class Graphics {
   float get_zoom_factor();
   bool set_zoom_factor(float factor);
   void get_screen_factor(float *fx, float *fy);
+
+  /* Decode the sprites a game draws most, serf torsos in each of the
+     player colors given, on background threads. Drawing them later only
+     has to create the images. */
+  void predecode_sprites(const std::vector<Color> &player_colors);
 };
 
 #endif  // SRC_GFX_H_
@@ -66,8 +66,9 @@ GuiObject::delete_frame() {
   }
 }
 
+/* Bring the frame of the object up to date. */
 void
-GuiObject::draw(Frame *_frame) {
+GuiObject::render() {
   if (!displayed) {
     return;
   }
@@ -85,6 +86,15 @@ GuiObject::draw(Frame *_frame) {
 
     redraw = false;
   }
+}
+
+void
+GuiObject::draw(Frame *_frame) {
+  if (!displayed) {
+    return;
+  }
+
+  render();
   _frame->draw_frame(x, y, 0, 0, frame, width, height);
 }
 
@@ -59,6 +59,7 @@ class GuiObject : public EventLoop::Handler {
   GuiObject();
   virtual ~GuiObject();
 
+  void render();
   void draw(Frame *frame);
   void move_to(int x, int y);
   void get_position(int *x, int *y);
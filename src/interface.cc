@@ -83,7 +83,7 @@ Interface::Interface()
   notification_box = nullptr;
 
   GameManager::get_instance().add_handler(this);
-  set_game(GameManager::get_instance().get_current_game());
+  set_game(GameManager::get_instance().get_view());
 }
 
 Interface::~Interface() {
@@ -189,7 +189,12 @@ Interface::open_message() {
     return_pos = pos;
   }
 
-  Message message = player->pop_notification();
+  Message message;
+  run_player_command([&message](Player *player_) {
+    if (player_->has_notification()) {
+      message = player_->pop_notification();
+    }
+  });
 
   if (message.type == Message::TypeCallToMenu) {
     /* TODO */
@@ -456,6 +461,22 @@ Interface::set_game(PGame new_game) {
   set_player(0);
 }
 
+void
+Interface::post_player_command(PlayerCommand command) {
+  unsigned int index = player->get_index();
+  GameManager::get_instance().post_command([index, command](Game *current) {
+    command(current->get_player(index));
+  });
+}
+
+void
+Interface::run_player_command(PlayerCommand command) {
+  unsigned int index = player->get_index();
+  GameManager::get_instance().run_command([index, command](Game *current) {
+    command(current->get_player(index));
+  });
+}
+
 void
 Interface::set_player(unsigned int player_index) {
   if (panel != nullptr) {
@@ -567,7 +588,12 @@ Interface::build_road_segment(Direction dir) {
 
   if (game->get_map()->get_obj(dest) == Map::ObjectFlag) {
     /* Existing flag at destination, try to connect. */
-    if (!game->build_road(building_road, player)) {
+    bool built = false;
+    Road road = building_road;
+    run_player_command([road, &built](Player *player_) {
+      built = player_->get_game()->build_road(road, player_);
+    });
+    if (!built) {
       build_road_end();
       return -1;
     } else {
@@ -629,9 +655,12 @@ void
 Interface::demolish_object() {
   determine_map_cursor_type();
 
+  MapPos pos = map_cursor_pos;
   if (map_cursor_type == CursorTypeRemovableFlag) {
     play_sound(Audio::TypeSfxClick);
-    game->demolish_flag(map_cursor_pos, player);
+    post_player_command([pos](Player *player_) {
+      player_->get_game()->demolish_flag(pos, player_);
+    });
   } else if (map_cursor_type == CursorTypeBuilding) {
     Building *building = game->get_building_at_pos(map_cursor_pos);
 
@@ -643,7 +672,9 @@ Interface::demolish_object() {
     }
 
     play_sound(Audio::TypeSfxAhhh);
-    game->demolish_building(map_cursor_pos, player);
+    post_player_command([pos](Player *player_) {
+      player_->get_game()->demolish_building(pos, player_);
+    });
   } else {
     play_sound(Audio::TypeSfxNotAccepted);
     update_interface();
@@ -653,7 +684,12 @@ Interface::demolish_object() {
 /* Build new flag. */
 void
 Interface::build_flag() {
-  if (!game->build_flag(map_cursor_pos, player)) {
+  bool built = false;
+  MapPos pos = map_cursor_pos;
+  run_player_command([pos, &built](Player *player_) {
+    built = player_->get_game()->build_flag(pos, player_);
+  });
+  if (!built) {
     play_sound(Audio::TypeSfxNotAccepted);
     return;
   }
@@ -664,7 +700,12 @@ Interface::build_flag() {
 /* Build a new building. */
 void
 Interface::build_building(Building::Type type) {
-  if (!game->build_building(map_cursor_pos, type, player)) {
+  bool built = false;
+  MapPos pos = map_cursor_pos;
+  run_player_command([pos, type, &built](Player *player_) {
+    built = player_->get_game()->build_building(pos, type, player_);
+  });
+  if (!built) {
     play_sound(Audio::TypeSfxNotAccepted);
     return;
   }
@@ -680,7 +721,12 @@ Interface::build_building(Building::Type type) {
 /* Build castle. */
 void
 Interface::build_castle() {
-  if (!game->build_castle(map_cursor_pos, player)) {
+  bool built = false;
+  MapPos pos = map_cursor_pos;
+  run_player_command([pos, &built](Player *player_) {
+    built = player_->get_game()->build_castle(pos, player_);
+  });
+  if (!built) {
     play_sound(Audio::TypeSfxNotAccepted);
     return;
   }
@@ -691,10 +737,18 @@ Interface::build_castle() {
 
 void
 Interface::build_road() {
-  bool r = game->build_road(building_road, player);
-  if (!r) {
+  bool built = false;
+  Road road = building_road;
+  MapPos pos = map_cursor_pos;
+  run_player_command([road, pos, &built](Player *player_) {
+    Game *current = player_->get_game();
+    built = current->build_road(road, player_);
+    if (!built) {
+      current->demolish_flag(pos, player_);
+    }
+  });
+  if (!built) {
     play_sound(Audio::TypeSfxNotAccepted);
-    game->demolish_flag(map_cursor_pos, player);
   } else {
     play_sound(Audio::TypeSfxAccepted);
     build_road_end();
@@ -759,14 +813,39 @@ Interface::layout() {
   set_redraw();
 }
 
-/* Called periodically when the game progresses. */
+/* Drop the notifications of player that are not shown with config from
+   the front of the queue. Returns whether a notification is left. */
+static bool
+drop_hidden_notifications(Player *player, int config) {
+  static const int msg_category[] = {
+    -1, 5, 5, 5, 4, 0, 4, 3, 4, 5,
+    5, 5, 4, 4, 4, 4, 0, 0, 0, 0
+  };
+
+  while (player->has_notification()) {
+    Message message = player->peek_notification();
+    if (BIT_TEST(config, msg_category[message.type])) {
+      return true;
+    }
+    player->pop_notification();
+  }
+
+  return false;
+}
+
+/* Called periodically to follow the game, which progresses on the
+   simulation thread. The view of the game is brought up to date here. */
 void
 Interface::update() {
+  if (init_box != nullptr) {
+    init_box->update_map_preview();
+  }
+
   if (!game) {
     return;
   }
 
-  game->update();
+  GameManager::get_instance().update_view();
 
   int tick_diff = game->get_const_tick() - last_const_tick;
   last_const_tick = game->get_const_tick();
@@ -780,36 +859,29 @@ Interface::update() {
     return_timeout -= tick_diff;
   }
 
-  const int msg_category[] = {
-    -1, 5, 5, 5, 4, 0, 4, 3, 4, 5,
-    5, 5, 4, 4, 4, 4, 0, 0, 0, 0
-  };
-
   /* Handle newly enqueued messages */
   if ((player != nullptr) && player->has_message()) {
-    player->drop_message();
-    while (player->has_notification()) {
-      Message message = player->peek_notification();
-      if (BIT_TEST(config, msg_category[message.type])) {
-        play_sound(Audio::TypeSfxMessage);
-        msg_flags |= BIT(0);
-        break;
-      }
-      player->pop_notification();
+    bool shown = false;
+    int shown_config = config;
+    run_player_command([shown_config, &shown](Player *player_) {
+      player_->drop_message();
+      shown = drop_hidden_notifications(player_, shown_config);
+    });
+    if (shown) {
+      play_sound(Audio::TypeSfxMessage);
+      msg_flags |= BIT(0);
     }
   }
 
   if ((player != nullptr) && BIT_TEST(msg_flags, 1)) {
     msg_flags &= ~BIT(1);
-    while (1) {
-      if (!player->has_notification()) {
-        msg_flags &= ~BIT(0);
-        break;
-      }
-
-      Message message = player->peek_notification();
-      if (BIT_TEST(config, msg_category[message.type])) break;
-      player->pop_notification();
+    bool shown = false;
+    int shown_config = config;
+    run_player_command([shown_config, &shown](Player *player_) {
+      shown = drop_hidden_notifications(player_, shown_config);
+    });
+    if (!shown) {
+      msg_flags &= ~BIT(0);
     }
   }
 
@@ -842,19 +914,27 @@ Interface::handle_key_pressed(char key, int modifier) {
 
     /* Game speed */
     case '+': {
-      game->speed_increase();
+      GameManager::get_instance().post_command([](Game *current) {
+        current->speed_increase();
+      });
       break;
     }
     case '-': {
-      game->speed_decrease();
+      GameManager::get_instance().post_command([](Game *current) {
+        current->speed_decrease();
+      });
       break;
     }
     case '0': {
-      game->speed_reset();
+      GameManager::get_instance().post_command([](Game *current) {
+        current->speed_reset();
+      });
       break;
     }
     case 'p': {
-      game->pause();
+      GameManager::get_instance().post_command([](Game *current) {
+        current->pause();
+      });
       break;
     }
 
@@ -895,7 +975,9 @@ Interface::handle_key_pressed(char key, int modifier) {
     }
     case 'z':
       if (modifier & 1) {
-        GameStore::get_instance().quick_save("quicksave", game.get());
+        GameManager::get_instance().post_command([](Game *current) {
+          GameStore::get_instance().quick_save("quicksave", current);
+        });
       }
       break;
     case 'n':
@@ -918,15 +1000,25 @@ Interface::handle_key_pressed(char key, int modifier) {
 
 bool
 Interface::handle_event(const Event *event) {
+  if (event->type == Event::TypeDraw) {
+    /* Show the picture rendered on the last update, so that drawing never
+       waits for the simulation. */
+    if (frame != nullptr) {
+      Frame *target = reinterpret_cast<Frame*>(event->object);
+      target->draw_frame(x, y, 0, 0, frame, width, height);
+    }
+    return true;
+  }
+
   switch (event->type) {
     case Event::TypeResize:
       set_size(event->dx, event->dy);
       break;
     case Event::TypeUpdate:
       update();
-      break;
-    case Event::TypeDraw:
-      draw(reinterpret_cast<Frame*>(event->object));
+      /* Everything on screen that depends on the game is rendered here,
+         right after the view of the game is updated. */
+      render();
       break;
 
     default:
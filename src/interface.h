@@ -22,6 +22,8 @@
 #ifndef SRC_INTERFACE_H_
 #define SRC_INTERFACE_H_
 
+#include <functional>
+
 #include "src/misc.h"
 #include "src/random.h"
 #include "src/map.h"
@@ -45,6 +47,10 @@ class NotificationBox;
 
 class Interface : public GuiObject, public GameManager::Handler {
  public:
+  /* A change made by the player of the interface, given that player in
+     the current game. */
+  typedef std::function<void(Player *player)> PlayerCommand;
+
   typedef enum CursorType {
     CursorTypeNone = 0,
     CursorTypeFlag,
@@ -127,9 +133,16 @@ class Interface : public GuiObject, public GameManager::Handler {
   Interface();
   virtual ~Interface();
 
+  /* The view of the game, see GameManager::get_view(). The game itself
+     is changed through the commands below. */
   PGame get_game() { return game; }
   void set_game(PGame game);
 
+  /* Post or run command on the current game, see
+     GameManager::post_command() and GameManager::run_command(). */
+  void post_player_command(PlayerCommand command);
+  void run_player_command(PlayerCommand command);
+
   Color get_player_color(unsigned int player_index);
 
   Viewport *get_viewport();
@@ -27,6 +27,7 @@
 #include "src/flag.h"
 #include "src/game.h"
 #include "src/serf.h"
+#include "src/misc.h"
 
 Inventory::Inventory(Game *game, unsigned int index)
   : GameObject(game, index)
@@ -43,6 +44,28 @@ Inventory::Inventory(Game *game, unsigned int index)
   }
 }
 
+uint64_t
+Inventory::get_state_hash() const {
+  uint64_t hash = hash_combine(0, get_index());
+  hash = hash_combine(hash, owner);
+  hash = hash_combine(hash, flag);
+  hash = hash_combine(hash, building);
+  hash = hash_combine(hash, serfs_out);
+  hash = hash_combine(hash, generic_count);
+  hash = hash_combine(hash, res_dir);
+  for (const auto &q : out_queue) {
+    hash = hash_combine(hash, q.type);
+    hash = hash_combine(hash, q.dest);
+  }
+  for (const auto &res : resources) {
+    hash = hash_combine(hash, (res.first << 24) ^ res.second);
+  }
+  for (const auto &serf : serfs) {
+    hash = hash_combine(hash, (serf.first << 24) ^ serf.second);
+  }
+  return hash;
+}
+
 Inventory::~Inventory() {
   for (int i = 0; i < 2 && out_queue[i].type != Resource::TypeNone; i++) {
     Resource::Type res = out_queue[i].type;
@@ -62,6 +62,9 @@ class Inventory : public GameObject {
 
  public:
   Inventory(Game *game, unsigned int index);
+
+  /* Hash of the state, for checking that two games run in lockstep. */
+  uint64_t get_state_hash() const;
   virtual ~Inventory();
 
   unsigned int get_owner() { return owner; }
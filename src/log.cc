@@ -35,7 +35,7 @@ Log::Level Log::level = Log::LevelInfo;
 
 std::ostream *Log::stream = &std::cout;
 
-std::ostream Log::Logger::dummy(0);
+std::recursive_mutex Log::mutex;
 Log::Logger Log::Verbose(Log::LevelVerbose, "Verbose");
 Log::Logger Log::Debug(Log::LevelDebug, "Debug");
 Log::Logger Log::Info(Log::LevelInfo, "Info");
@@ -35,8 +35,10 @@
 #ifndef SRC_LOG_H_
 #define SRC_LOG_H_
 
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
 
 class Log {
  public:
@@ -51,26 +53,45 @@ class Log {
     LevelMax
   } Level;
 
+  /* One line of output. The log is held for the lifetime of the stream so
+     that lines from several threads do not interleave. Lines of disabled
+     levels have no stream and are dropped. */
   class Stream {
    protected:
     std::ostream *stream;
+    std::unique_lock<std::recursive_mutex> lock;
 
    public:
-    explicit Stream(std::ostream *_stream) : stream(_stream) {}
+    explicit Stream(std::ostream *_stream) : stream(_stream) {
+      if (stream != nullptr) {
+        lock = std::unique_lock<std::recursive_mutex>(Log::mutex);
+      }
+    }
+    Stream(Stream &&other)
+      : stream(other.stream)
+      , lock(std::move(other.lock)) {
+      other.stream = nullptr;
+    }
     ~Stream() {
-      *stream << std::endl;
-      stream->flush();
+      if (stream != nullptr) {
+        *stream << std::endl;
+        stream->flush();
+      }
     }
 
     std::ostream *get_stream() { return stream; }
 
     template <class T> Stream & operator << (const T &val) {
-      *stream << val;
+      if (stream != nullptr) {
+        *stream << val;
+      }
       return *this;
     }
 
     Stream & operator << (const char val[]) {
-      *stream << std::string(val);
+      if (stream != nullptr) {
+        *stream << std::string(val);
+      }
       return *this;
     }
   };
@@ -80,7 +101,6 @@ class Log {
     Level level;
     std::string prefix;
     std::ostream *stream;
-    static std::ostream dummy;
 
    public:
     explicit Logger(Level _level, std::string _prefix)
@@ -89,13 +109,14 @@ class Log {
     }
 
     virtual Stream operator[](std::string subsystem) {
-      *stream << prefix << ": [" << subsystem << "] ";
-      return Stream(stream);
+      Stream line(stream);
+      line << prefix << ": [" << subsystem << "] ";
+      return line;
     }
 
     void apply_level() {
       if (level < Log::level) {
-        stream = &dummy;
+        stream = nullptr;
       } else {
         stream = Log::stream;
       }
@@ -117,6 +138,7 @@ class Log {
  protected:
   static std::ostream *stream;
   static Level level;
+  static std::recursive_mutex mutex;
 };
 
 #endif  // SRC_LOG_H_
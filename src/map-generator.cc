@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <array>
+#include <utility>
 
 #include "src/debug.h"
 
@@ -37,7 +38,8 @@ ClassicMapGenerator::ClassicMapGenerator(const Map& map, const Random& random)
   , preserve_bugs(false)
   , water_level(default_water_level)
   , max_lake_area(default_max_lake_area)
-  , terrain_spikyness(default_terrain_spikyness) {
+  , terrain_spikyness(default_terrain_spikyness)
+  , abandoned(false) {
   tiles.resize(map.geom().tile_count());
   tags.resize(map.geom().tile_count());
 }
@@ -90,6 +92,7 @@ void ClassicMapGenerator::generate() {
   init_types();
   remove_islands();
   heights_rescale();
+  if (!report_progress(StageTerrain)) return;
 
   // Adjust terrain types on shores
   change_shore_water_type();
@@ -97,6 +100,7 @@ void ClassicMapGenerator::generate() {
 
   // Create deserts
   create_deserts();
+  if (!report_progress(StageDeserts)) return;
 
   // Create map objects (trees, boulders, etc.)
   create_objects();
@@ -104,6 +108,7 @@ void ClassicMapGenerator::generate() {
   create_mineral_deposits();
 
   clean_up();
+  report_progress(StageObjects);
 }
 
 uint16_t
@@ -111,6 +116,14 @@ ClassicMapGenerator::random_int() {
   return rnd.random();
 }
 
+bool
+ClassicMapGenerator::report_progress(Stage stage) {
+  if (!abandoned && progress && !progress(stage)) {
+    abandoned = true;
+  }
+  return !abandoned;
+}
+
 /* Midpoint displacement map generator. This function initialises the height
    values in the corners of 16x16 squares. */
 void
@@ -154,6 +167,7 @@ ClassicMapGenerator::init_heights_midpoints() {
 
   for (int i = 8; i > 0; i >>= 1) {
     for (unsigned int y = 0; y < map.get_rows(); y += 2*i) {
+      if (!keep_going(map.pos(0, y))) return;
       for (unsigned int x = 0; x < map.get_cols(); x += 2*i) {
         MapPos pos_ = map.pos(x, y);
         int h = tiles[pos_].height;
@@ -284,6 +298,7 @@ ClassicMapGenerator::clamp_heights() {
   while (changed) {
     changed = false;
     for (MapPos pos_ : map.geom()) {
+      if (!keep_going(pos_)) return;
       int h = tiles[pos_].height;
 
       MapPos pos_d = map.move_down(pos_);
@@ -403,6 +418,7 @@ void
 ClassicMapGenerator::create_water_bodies() {
   for (unsigned int h = 0; h <= water_level; h++) {
     for (MapPos pos_ : map.geom()) {
+      if (!keep_going(pos_)) return;
       if (tiles[pos_].height == h) {
         expand_water_body(pos_);
       }
@@ -502,6 +518,7 @@ ClassicMapGenerator::remove_islands() {
       while (changed) {
         changed = false;
         for (MapPos pos_ : map.geom()) {
+          if (!keep_going(pos_)) return;
           if (tags[pos_] == 1) {
             num += 1;
             tags[pos_] = 2;
@@ -580,6 +597,7 @@ void
 ClassicMapGenerator::seed_terrain_type(Map::Terrain old, Map::Terrain seed,
                                        Map::Terrain new_) {
   for (MapPos pos_ : map.geom()) {
+    if (!keep_going(pos_)) return;
     // Check that the central triangle is of type old (*), and that any
     // adjacent triangle is of type seed:
     //     ____
@@ -673,7 +691,7 @@ ClassicMapGenerator::change_shore_grass_type() {
 //    \/
 //
 bool
-ClassicMapGenerator::check_desert_down_triangle(MapPos pos_) {
+ClassicMapGenerator::check_desert_down_triangle(MapPos pos_) const {
   Map::Terrain type_d = tiles[pos_].type_down;
   Map::Terrain type_u = tiles[pos_].type_up;
 
@@ -709,7 +727,7 @@ ClassicMapGenerator::check_desert_down_triangle(MapPos pos_) {
 //   /__\/__\
 //
 bool
-ClassicMapGenerator::check_desert_up_triangle(MapPos pos_) {
+ClassicMapGenerator::check_desert_up_triangle(MapPos pos_) const {
   Map::Terrain type_d = tiles[pos_].type_down;
   Map::Terrain type_u = tiles[pos_].type_up;
 
@@ -823,7 +841,7 @@ ClassicMapGenerator::create_crosses() {
    maps. */
 bool
 ClassicMapGenerator::hexagon_types_in_range(MapPos pos_, Map::Terrain min,
-                                            Map::Terrain max) {
+                                            Map::Terrain max) const {
   Map::Terrain type_d = tiles[pos_].type_down;
   Map::Terrain type_u = tiles[pos_].type_up;
 
@@ -1084,3 +1102,451 @@ ClassicMissionMapGenerator::ClassicMissionMapGenerator(
 void ClassicMissionMapGenerator::init() {
   ClassicMapGenerator::init(MapGenerator::HeightGeneratorMidpoints, true);
 }
+
+ParallelMapGenerator::ParallelMapGenerator(const Map &map,
+                                           const Random &random,
+                                           ThreadPool *pool)
+  : ClassicMapGenerator(map, random)
+  , pool(pool)
+  , phase(0) {
+}
+
+/* Random generator for one chunk of the current phase. The seed mixes the
+   map seed with the phase and chunk numbers. */
+Random
+ParallelMapGenerator::chunk_random(unsigned int chunk) const {
+  uint64_t z = rnd.get_state() ^ (static_cast<uint64_t>(phase) << 48);
+  z += (chunk + 1) * 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z ^= z >> 31;
+
+  return Random(z & 0xffff, (z >> 16) & 0xffff, ((z >> 32) & 0xffff) | 1);
+}
+
+/* Visit every position, rows of the map split among the threads. */
+void
+ParallelMapGenerator::for_each_row(std::function<void(MapPos pos)> visit) {
+  pool->parallel_for(0, map.get_rows(), 8, [&](size_t first, size_t last) {
+    for (size_t y = first; y < last; y++) {
+      for (unsigned int x = 0; x < map.get_cols(); x++) {
+        visit(map.pos(x, static_cast<unsigned int>(y)));
+      }
+    }
+  });
+}
+
+int
+ParallelMapGenerator::displace_height(Random *random, int avg, int base,
+                                      int offset) const {
+  int r = random->random();
+  int h = ((r * base) >> 16) - offset + avg;
+
+  return std::max(0, std::min(h, 250));
+}
+
+void
+ParallelMapGenerator::init_heights_squares() {
+  phase += 1;
+  unsigned int rows = (map.get_rows() + 15) / 16;
+  pool->parallel_for(0, rows, 1, [&](size_t first, size_t last) {
+    for (size_t row = first; row < last; row++) {
+      Random random = chunk_random(static_cast<unsigned int>(row));
+      unsigned int y = static_cast<unsigned int>(row) * 16;
+      for (unsigned int x = 0; x < map.get_cols(); x += 16) {
+        int rndl = random.random() & 0xff;
+        tiles[map.pos(x, y)].height = std::min(rndl, 250);
+      }
+    }
+  });
+}
+
+/* Each level of the subdivision only reads the positions of the coarser
+   levels, so the rows of a level can be done in any order. */
+void
+ParallelMapGenerator::init_heights_midpoints() {
+  phase += 1;
+  int rndl = chunk_random(0).random();
+  int r1 = 0x80 + (rndl & 0x7f);
+  int r2 = (r1 * terrain_spikyness) >> 16;
+
+  for (int i = 8; i > 0; i >>= 1) {
+    phase += 1;
+    unsigned int rows = (map.get_rows() + 2*i - 1) / (2*i);
+    pool->parallel_for(0, rows, 1, [&](size_t first, size_t last) {
+      for (size_t row = first; row < last; row++) {
+        Random random = chunk_random(static_cast<unsigned int>(row));
+        unsigned int y = static_cast<unsigned int>(row) * 2*i;
+        for (unsigned int x = 0; x < map.get_cols(); x += 2*i) {
+          MapPos pos_ = map.pos(x, y);
+          int h = tiles[pos_].height;
+
+          MapPos pos_r = map.move_right_n(pos_, 2*i);
+          MapPos pos_mid_r = map.move_right_n(pos_, i);
+          int h_r = tiles[pos_r].height;
+          if (preserve_bugs) {
+            if (x == 0 && y == 0 && i == 8) h_r |= rndl & 0xff00;
+          }
+          tiles[pos_mid_r].height = displace_height(&random, (h + h_r)/2,
+                                                    r1, r2);
+
+          MapPos pos_d = map.move_down_n(pos_, 2*i);
+          MapPos pos_mid_d = map.move_down_n(pos_, i);
+          int h_d = tiles[pos_d].height;
+          tiles[pos_mid_d].height = displace_height(&random, (h + h_d)/2,
+                                                    r1, r2);
+
+          MapPos pos_dr = map.move_right_n(map.move_down_n(pos_, 2*i), 2*i);
+          MapPos pos_mid_dr = map.move_right_n(map.move_down_n(pos_, i), i);
+          int h_dr = tiles[pos_dr].height;
+          tiles[pos_mid_dr].height = displace_height(&random, (h + h_dr)/2,
+                                                     r1, r2);
+        }
+      }
+    });
+
+    r1 >>= 1;
+    r2 >>= 1;
+  }
+}
+
+/* The diamond step only reads the corners of the squares and the square
+   step only reads corners and centers, so the rows of each step can be
+   done in any order. */
+void
+ParallelMapGenerator::init_heights_diamond_square() {
+  phase += 1;
+  int rndl = chunk_random(0).random();
+  int r1 = 0x80 + (rndl & 0x7f);
+  int r2 = (r1 * terrain_spikyness) >> 16;
+
+  for (int i = 8; i > 0; i >>= 1) {
+    unsigned int rows = (map.get_rows() + 2*i - 1) / (2*i);
+
+    /* Diamond step */
+    phase += 1;
+    pool->parallel_for(0, rows, 1, [&](size_t first, size_t last) {
+      for (size_t row = first; row < last; row++) {
+        Random random = chunk_random(static_cast<unsigned int>(row));
+        unsigned int y = static_cast<unsigned int>(row) * 2*i;
+        for (unsigned int x = 0; x < map.get_cols(); x += 2*i) {
+          MapPos pos_ = map.pos(x, y);
+          int h = tiles[pos_].height;
+          int h_r = tiles[map.move_right_n(pos_, 2*i)].height;
+          int h_d = tiles[map.move_down_n(pos_, 2*i)].height;
+          int h_dr =
+            tiles[map.move_right_n(map.move_down_n(pos_, 2*i), 2*i)].height;
+
+          MapPos pos_mid_dr = map.move_right_n(map.move_down_n(pos_, i), i);
+          int avg = (h + h_r + h_d + h_dr) / 4;
+          tiles[pos_mid_dr].height = displace_height(&random, avg, r1, r2);
+        }
+      }
+    });
+
+    /* Square step */
+    phase += 1;
+    pool->parallel_for(0, rows, 1, [&](size_t first, size_t last) {
+      for (size_t row = first; row < last; row++) {
+        Random random = chunk_random(static_cast<unsigned int>(row));
+        unsigned int y = static_cast<unsigned int>(row) * 2*i;
+        for (unsigned int x = 0; x < map.get_cols(); x += 2*i) {
+          MapPos pos_ = map.pos(x, y);
+          int h = tiles[pos_].height;
+          int h_r = tiles[map.move_right_n(pos_, 2*i)].height;
+          int h_d = tiles[map.move_down_n(pos_, 2*i)].height;
+          int h_ur =
+            tiles[map.move_right_n(map.move_down_n(pos_, -i), i)].height;
+          int h_dr =
+            tiles[map.move_right_n(map.move_down_n(pos_, i), i)].height;
+          int h_dl =
+            tiles[map.move_right_n(map.move_down_n(pos_, i), -i)].height;
+
+          MapPos pos_mid_r = map.move_right_n(pos_, i);
+          int avg_r = (h + h_r + h_ur + h_dr) / 4;
+          tiles[pos_mid_r].height = displace_height(&random, avg_r, r1, r2);
+
+          MapPos pos_mid_d = map.move_down_n(pos_, i);
+          int avg_d = (h + h_d + h_dl + h_dr) / 4;
+          tiles[pos_mid_d].height = displace_height(&random, avg_d, r1, r2);
+        }
+      }
+    });
+
+    r1 >>= 1;
+    r2 >>= 1;
+  }
+}
+
+/* Lakes grow into each other, so they are still made one at a time. Only
+   stocking them with fish is split up. */
+void
+ParallelMapGenerator::create_water_bodies() {
+  for (unsigned int h = 0; h <= water_level; h++) {
+    for (MapPos pos_ : map.geom()) {
+      if (tiles[pos_].height == h) {
+        expand_water_body(pos_);
+      }
+    }
+  }
+
+  phase += 1;
+  pool->parallel_for(0, map.get_rows(), 8, [&](size_t first, size_t last) {
+    for (size_t y = first; y < last; y++) {
+      Random random = chunk_random(static_cast<unsigned int>(y));
+      for (unsigned int x = 0; x < map.get_cols(); x++) {
+        MapPos pos_ = map.pos(x, static_cast<unsigned int>(y));
+        switch (tiles[pos_].height) {
+          case 0:
+            tiles[pos_].height = water_level + 1;
+            break;
+          case 252:
+            tiles[pos_].height = water_level;
+            break;
+          case 253:
+            tiles[pos_].height = water_level - 1;
+            tiles[pos_].mineral = Map::MineralsNone;
+            tiles[pos_].resource_amount = random.random() & 7; /* Fish */
+            break;
+        }
+      }
+    }
+  });
+}
+
+void
+ParallelMapGenerator::heights_rebase() {
+  int h = water_level - 1;
+  for_each_row([&](MapPos pos) {
+    tiles[pos].height -= h;
+  });
+}
+
+void
+ParallelMapGenerator::init_types() {
+  for_each_row([&](MapPos pos_) {
+    int h1 = tiles[pos_].height;
+    int h2 = tiles[map.move_right(pos_)].height;
+    int h3 = tiles[map.move_down_right(pos_)].height;
+    int h4 = tiles[map.move_down(pos_)].height;
+    tiles[pos_].type_up = calc_map_type(h1 + h3 + h4);
+    tiles[pos_].type_down = calc_map_type(h1 + h2 + h3);
+  });
+}
+
+void
+ParallelMapGenerator::heights_rescale() {
+  for_each_row([&](MapPos pos_) {
+    tiles[pos_].height = (tiles[pos_].height + 6) >> 3;
+  });
+}
+
+/* A triangle changed to the new type never becomes the seed type, so
+   looking at all triangles before changing any gives the same result as
+   the classic generator. */
+void
+ParallelMapGenerator::seed_terrain_type(Map::Terrain old, Map::Terrain seed,
+                                        Map::Terrain new_) {
+  std::vector<uint8_t> changes(tiles.size());
+  for_each_row([&](MapPos pos_) {
+    if (tiles[pos_].type_up == old &&
+        (seed == tiles[map.move_up_left(pos_)].type_down ||
+         seed == tiles[map.move_up_left(pos_)].type_up ||
+         seed == tiles[map.move_up(pos_)].type_up ||
+         seed == tiles[map.move_left(pos_)].type_down ||
+         seed == tiles[map.move_left(pos_)].type_up ||
+         seed == tiles[pos_].type_down ||
+         seed == tiles[map.move_right(pos_)].type_up ||
+         seed == tiles[map.move_left(map.move_down(pos_))].type_down ||
+         seed == tiles[map.move_down(pos_)].type_down ||
+         seed == tiles[map.move_down(pos_)].type_up ||
+         seed == tiles[map.move_down_right(pos_)].type_down ||
+         seed == tiles[map.move_down_right(pos_)].type_up)) {
+      changes[pos_] |= 1;
+    }
+
+    if (tiles[pos_].type_down == old &&
+        (seed == tiles[map.move_up_left(pos_)].type_down ||
+         seed == tiles[map.move_up_left(pos_)].type_up ||
+         seed == tiles[map.move_up(pos_)].type_down ||
+         seed == tiles[map.move_up(pos_)].type_up ||
+         seed == tiles[map.move_right(map.move_up(pos_))].type_up ||
+         seed == tiles[map.move_left(pos_)].type_down ||
+         seed == tiles[pos_].type_up ||
+         seed == tiles[map.move_right(pos_)].type_down ||
+         seed == tiles[map.move_right(pos_)].type_up ||
+         seed == tiles[map.move_down(pos_)].type_down ||
+         seed == tiles[map.move_down_right(pos_)].type_down ||
+         seed == tiles[map.move_down_right(pos_)].type_up)) {
+      changes[pos_] |= 2;
+    }
+  });
+
+  for_each_row([&](MapPos pos_) {
+    if (changes[pos_] & 1) tiles[pos_].type_up = new_;
+    if (changes[pos_] & 2) tiles[pos_].type_down = new_;
+  });
+}
+
+/* The desert areas are all placed looking at the terrain before any of
+   them, then marked in region order. */
+void
+ParallelMapGenerator::create_deserts() {
+  phase += 1;
+  unsigned int regions = map.get_region_count();
+  std::vector<std::vector<std::pair<MapPos, int>>> marks(regions);
+  pool->parallel_for(0, regions, 1, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      Random random = chunk_random(static_cast<unsigned int>(i));
+      for (int try_ = 0; try_ < 200; try_++) {
+        MapPos rnd_pos = map.get_rnd_coord(NULL, NULL, &random);
+
+        if (tiles[rnd_pos].type_up == Map::TerrainGrass1 &&
+            tiles[rnd_pos].type_down == Map::TerrainGrass1) {
+          for (int index = 255; index >= 0; index--) {
+            MapPos pos = map.pos_add_spirally(rnd_pos, index);
+            int mark = (check_desert_down_triangle(pos) ? 1 : 0) |
+                       (check_desert_up_triangle(pos) ? 2 : 0);
+            if (mark != 0) marks[i].push_back(std::make_pair(pos, mark));
+          }
+          break;
+        }
+      }
+    }
+  });
+
+  for (const std::vector<std::pair<MapPos, int>> &region : marks) {
+    for (const std::pair<MapPos, int> &mark : region) {
+      if (mark.second & 1) tiles[mark.first].type_up = Map::TerrainDesert2;
+      if (mark.second & 2) tiles[mark.first].type_down = Map::TerrainDesert2;
+    }
+  }
+
+  seed_terrain_type(
+    Map::TerrainDesert2, Map::TerrainGrass1, Map::TerrainGrass3);
+  seed_terrain_type(
+    Map::TerrainDesert2, Map::TerrainGrass3, Map::TerrainDesert0);
+  seed_terrain_type(
+    Map::TerrainDesert2, Map::TerrainDesert0, Map::TerrainDesert1);
+
+  for_each_row([&](MapPos pos_) {
+    int type_d = tiles[pos_].type_down;
+    int type_u = tiles[pos_].type_up;
+
+    if (type_d >= Map::TerrainGrass3 && type_d <= Map::TerrainDesert1) {
+      tiles[pos_].type_down = Map::TerrainGrass1;
+    }
+    if (type_u >= Map::TerrainGrass3 && type_u <= Map::TerrainDesert1) {
+      tiles[pos_].type_up = Map::TerrainGrass1;
+    }
+  });
+
+  seed_terrain_type(
+    Map::TerrainGrass1, Map::TerrainDesert2, Map::TerrainDesert1);
+  seed_terrain_type(
+    Map::TerrainGrass1, Map::TerrainDesert1, Map::TerrainDesert0);
+  seed_terrain_type(
+    Map::TerrainGrass1, Map::TerrainDesert0, Map::TerrainGrass3);
+}
+
+void
+ParallelMapGenerator::create_crosses() {
+  for_each_row([&](MapPos pos_) {
+    unsigned int h = tiles[pos_].height;
+    if (h >= 26 &&
+        h >= tiles[map.move_right(pos_)].height &&
+        h >= tiles[map.move_down_right(pos_)].height &&
+        h >= tiles[map.move_down(pos_)].height &&
+        h > tiles[map.move_left(pos_)].height &&
+        h > tiles[map.move_up_left(pos_)].height &&
+        h > tiles[map.move_up(pos_)].height) {
+      tiles[pos_].obj = Map::ObjectCross;
+    }
+  });
+}
+
+/* Each cluster picks its positions on its own, then the objects are placed
+   in cluster order where no earlier object is in the way. */
+void
+ParallelMapGenerator::create_random_object_clusters(
+    int num_clusters, int objs_in_cluster, int pos_mask, Map::Terrain type_min,
+    Map::Terrain type_max, int obj_base, int obj_mask) {
+  phase += 1;
+  std::vector<std::vector<std::pair<MapPos, Map::Object>>>
+    clusters(num_clusters);
+  pool->parallel_for(0, num_clusters, 8, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      Random random = chunk_random(static_cast<unsigned int>(i));
+      for (int try_ = 0; try_ < 100; try_++) {
+        MapPos rnd_pos = map.get_rnd_coord(NULL, NULL, &random);
+        if (hexagon_types_in_range(rnd_pos, type_min, type_max)) {
+          for (int j = 0; j < objs_in_cluster; j++) {
+            MapPos pos_ = map.pos_add_spirally(rnd_pos,
+                                               random.random() & pos_mask);
+            Map::Object obj = static_cast<Map::Object>(
+              (random.random() & obj_mask) + obj_base);
+            if (hexagon_types_in_range(pos_, type_min, type_max)) {
+              clusters[i].push_back(std::make_pair(pos_, obj));
+            }
+          }
+          break;
+        }
+      }
+    }
+  });
+
+  for (const std::vector<std::pair<MapPos, Map::Object>> &cluster :
+         clusters) {
+    for (const std::pair<MapPos, Map::Object> &object : cluster) {
+      if (tiles[object.first].obj == Map::ObjectNone) {
+        tiles[object.first].obj = object.second;
+      }
+    }
+  }
+}
+
+/* As for objects, each cluster is laid out on its own and the deposits
+   are merged in cluster order. */
+void
+ParallelMapGenerator::create_random_mineral_clusters(
+    int num_clusters, Map::Minerals type,
+    Map::Terrain min, Map::Terrain max) {
+  const int iterations[] = { 1, 6, 12, 18, 24, 30 };
+
+  phase += 1;
+  std::vector<std::vector<std::pair<MapPos, int>>> clusters(num_clusters);
+  pool->parallel_for(0, num_clusters, 8, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      Random random = chunk_random(static_cast<unsigned int>(i));
+      for (int try_ = 0; try_ < 100; try_++) {
+        MapPos pos_ = map.get_rnd_coord(NULL, NULL, &random);
+
+        if (hexagon_types_in_range(pos_, min, max)) {
+          int index = 0;
+          int count = 2 + ((random.random() >> 2) & 3);
+
+          for (int j = 0; j < count; j++) {
+            int amount = 4 * (count - j);
+            for (int k = 0; k < iterations[j]; k++) {
+              MapPos pos = map.pos_add_spirally(pos_, index++);
+              clusters[i].push_back(std::make_pair(pos, amount));
+            }
+          }
+
+          break;
+        }
+      }
+    }
+  });
+
+  for (const std::vector<std::pair<MapPos, int>> &cluster : clusters) {
+    for (const std::pair<MapPos, int> &deposit : cluster) {
+      Map::LandscapeTile &tile = tiles[deposit.first];
+      if (tile.mineral == Map::MineralsNone ||
+          tile.resource_amount < deposit.second) {
+        tile.mineral = type;
+        tile.resource_amount = deposit.second;
+      }
+    }
+  }
+}
@@ -22,11 +22,13 @@
 #ifndef SRC_MAP_GENERATOR_H_
 #define SRC_MAP_GENERATOR_H_
 
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include "src/map.h"
 #include "src/random.h"
+#include "src/thread-pool.h"
 
 /* Interface for map generators. */
 class MapGenerator {
@@ -56,6 +58,19 @@ class ClassicMapGenerator : public MapGenerator {
   static const int default_water_level;
   static const int default_terrain_spikyness;
 
+  /* Stages of generation, after each of which the landscape is complete
+     up to that point. */
+  typedef enum Stage {
+    StageTerrain = 0,  /* Heights and terrain types */
+    StageDeserts,      /* Shores and deserts */
+    StageObjects,      /* Trees, stones and such */
+    StageWorking       /* Part way through a stage */
+  } Stage;
+
+  /* Called after each stage, and once per map row of the longer passes
+     with StageWorking; generation is abandoned if it returns false. */
+  typedef std::function<bool(Stage stage)> ProgressHandler;
+
   ClassicMapGenerator(const Map &map, const Random &random);
   void init(HeightGenerator height_generator, bool preserve_bugs,
             int max_lake_area = default_max_lake_area,
@@ -63,6 +78,8 @@ class ClassicMapGenerator : public MapGenerator {
             int terrain_spikyness = default_terrain_spikyness);
   void generate();
 
+  void set_progress_handler(ProgressHandler handler) { progress = handler; }
+
   int get_height(MapPos pos) const { return tiles[pos].height; }
   Map::Terrain get_type_up(MapPos pos) const {
     return tiles[pos].type_up; }
@@ -88,52 +105,66 @@ class ClassicMapGenerator : public MapGenerator {
   unsigned int water_level;
   unsigned int max_lake_area;
   int terrain_spikyness;
+  ProgressHandler progress;
+  bool abandoned;
 
   uint16_t random_int();
+  bool report_progress(Stage stage);
+  /* Report progress at the start of each row. Passes stop when this
+     returns false, leaving the landscape unfinished. */
+  bool keep_going(MapPos pos) {
+    return (map.pos_col(pos) != 0) ? !abandoned
+                                   : report_progress(StageWorking);
+  }
   MapPos pos_add_spirally_random(MapPos pos, int mask);
 
   bool is_water_tile(MapPos pos) const;
   bool is_in_water(MapPos pos) const;
 
-  void init_heights_squares();
+  virtual void init_heights_squares();
   int calc_height_displacement(int avg, int base, int offset);
-  void init_heights_midpoints();
-  void init_heights_diamond_square();
+  virtual void init_heights_midpoints();
+  virtual void init_heights_diamond_square();
   bool adjust_map_height(int h1, int h2, MapPos pos);
   void clamp_heights();
 
   bool expand_water_position(MapPos pos);
   void expand_water_body(MapPos pos);
-  void create_water_bodies();
+  virtual void create_water_bodies();
 
-  void heights_rebase();
-  void init_types();
+  virtual void heights_rebase();
+  virtual void init_types();
   void clear_all_tags();
   void remove_islands();
-  void heights_rescale();
+  virtual void heights_rescale();
 
-  void seed_terrain_type(Map::Terrain old, Map::Terrain seed,
-                         Map::Terrain new_);
+  virtual void seed_terrain_type(Map::Terrain old, Map::Terrain seed,
+                                 Map::Terrain new_);
   void change_shore_water_type();
   void change_shore_grass_type();
 
-  bool check_desert_down_triangle(MapPos pos);
-  bool check_desert_up_triangle(MapPos pos);
-  void create_deserts();
+  bool check_desert_down_triangle(MapPos pos) const;
+  bool check_desert_up_triangle(MapPos pos) const;
+  virtual void create_deserts();
 
-  void create_crosses();
+  virtual void create_crosses();
   void create_objects();
 
-  bool hexagon_types_in_range(MapPos pos, Map::Terrain min, Map::Terrain max);
-  void create_random_object_clusters(int num_clusters, int objs_in_cluster,
-                                     int pos_mask, Map::Terrain type_min,
-                                     Map::Terrain type_max, int obj_base,
-                                     int obj_mask);
+  bool hexagon_types_in_range(MapPos pos, Map::Terrain min,
+                              Map::Terrain max) const;
+  virtual void create_random_object_clusters(int num_clusters,
+                                             int objs_in_cluster,
+                                             int pos_mask,
+                                             Map::Terrain type_min,
+                                             Map::Terrain type_max,
+                                             int obj_base, int obj_mask);
 
   void expand_mineral_cluster(int iters, MapPos pos, int *index,
                               int amount, Map::Minerals type);
-  void create_random_mineral_clusters(int num_clusters, Map::Minerals type,
-                                      Map::Terrain min, Map::Terrain max);
+  virtual void create_random_mineral_clusters(int num_clusters,
+                                              Map::Minerals type,
+                                              Map::Terrain min,
+                                              Map::Terrain max);
   void create_mineral_deposits();
 
   void clean_up();
@@ -146,4 +177,49 @@ class ClassicMissionMapGenerator : public ClassicMapGenerator {
   void init();
 };
 
+/* Map generator that runs the phases of the classic generator on a thread
+   pool. The map is split into fixed chunks, rows of the map or clusters
+   of objects, and each chunk draws from a generator of its own seeded
+   from the map seed, the phase and the chunk number. Chunks that could
+   touch the same positions are merged in chunk order. The map depends on
+   the seed only, not on the number of threads, but it is not the map the
+   classic generator makes from that seed. */
+class ParallelMapGenerator : public ClassicMapGenerator {
+ protected:
+  ThreadPool *pool;
+  unsigned int phase;
+
+ public:
+  ParallelMapGenerator(const Map &map, const Random &random,
+                       ThreadPool *pool = &ThreadPool::get_instance());
+
+ protected:
+  Random chunk_random(unsigned int chunk) const;
+  void for_each_row(std::function<void(MapPos pos)> visit);
+
+  int displace_height(Random *random, int avg, int base, int offset) const;
+
+  virtual void init_heights_squares();
+  virtual void init_heights_midpoints();
+  virtual void init_heights_diamond_square();
+  virtual void create_water_bodies();
+  virtual void heights_rebase();
+  virtual void init_types();
+  virtual void heights_rescale();
+  virtual void seed_terrain_type(Map::Terrain old, Map::Terrain seed,
+                                 Map::Terrain new_);
+  virtual void create_deserts();
+  virtual void create_crosses();
+  virtual void create_random_object_clusters(int num_clusters,
+                                             int objs_in_cluster,
+                                             int pos_mask,
+                                             Map::Terrain type_min,
+                                             Map::Terrain type_max,
+                                             int obj_base, int obj_mask);
+  virtual void create_random_mineral_clusters(int num_clusters,
+                                              Map::Minerals type,
+                                              Map::Terrain min,
+                                              Map::Terrain max);
+};
+
 #endif  // SRC_MAP_GENERATOR_H_
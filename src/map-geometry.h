@@ -21,7 +21,9 @@
 #ifndef SRC_MAP_GEOMETRY_H_
 #define SRC_MAP_GEOMETRY_H_
 
+#include <cstdint>
 #include <limits>
+#include <string>
 #include <utility>
 
 #include "src/debug.h"
@@ -172,9 +174,15 @@ cycle_directions_ccw(Direction start = DirectionUp, unsigned int length = 6) {
 
 // MapPos is a compact composition of col and row values that
 // uniquely identifies a vertex in the map space. It is also used
-// directly as index to map data arrays.
+// directly as index to map data arrays. Builds with
+// FREESERF_WIDE_MAP_POS use 64-bit positions, which allow map sizes
+// above 20.
+#ifdef FREESERF_WIDE_MAP_POS
+typedef uint64_t MapPos;
+#else
 typedef unsigned int MapPos;
-const MapPos bad_map_pos = std::numeric_limits<unsigned int>::max();
+#endif
+const MapPos bad_map_pos = std::numeric_limits<MapPos>::max();
 
 
 class MapGeometry {
@@ -270,14 +278,15 @@ class MapGeometry {
   unsigned int col_mask() const { return col_mask_; }
   unsigned int row_mask() const { return row_mask_; }
   unsigned int row_shift() const { return row_shift_; }
-  unsigned int tile_count() const { return cols_ * rows_; }
+  MapPos tile_count() const { return static_cast<MapPos>(cols_) * rows_; }
 
   /* Extract col and row from MapPos */
-  int pos_col(int pos) const { return (pos & col_mask_); }
-  int pos_row(int pos) const { return ((pos >> row_shift_) & row_mask_); }
+  int pos_col(MapPos pos) const { return (pos & col_mask_); }
+  int pos_row(MapPos pos) const { return ((pos >> row_shift_) & row_mask_); }
 
   /* Translate col, row coordinate to MapPos value. */
-  MapPos pos(int x, int y) const { return ((y << row_shift_) | x); }
+  MapPos pos(int x, int y) const {
+    return ((static_cast<MapPos>(y) << row_shift_) | x); }
 
   /* Addition of two map positions. */
   MapPos pos_add(MapPos pos_, int x, int y) const {
@@ -321,15 +330,20 @@ class MapGeometry {
 
  protected:
   void init() {
-    if (size_ > 20) {
-      throw ExceptionFreeserf("Above size 20 the map positions can no longer "
-                              "fit in a 32-bit integer.");
-    }
-
     col_size_ = 5 + size_ / 2;
     row_size_ = 5 + (size_ - 1) / 2;
-    cols_ = 1 << col_size_;
-    rows_ = 1 << row_size_;
+
+    /* Keep three bits spare, as the 32-bit limit of size 20 did. Saved
+       positions are stored shifted left. Columns and rows are also
+       handled as int, and two of them are added when offsetting. */
+    if (col_size_ + row_size_ + 3 > 8 * sizeof(MapPos) ||
+        col_size_ + 2 > 8 * sizeof(int)) {
+      throw ExceptionFreeserf("Map positions of size " +
+                              std::to_string(size_) + " do not fit in " +
+                              std::to_string(8 * sizeof(MapPos)) + " bits.");
+    }
+    cols_ = 1u << col_size_;
+    rows_ = 1u << row_size_;
 
     col_mask_ = cols_ - 1;
     row_mask_ = rows_ - 1;
@@ -66,6 +66,8 @@
 #include "src/map.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <mutex>
 #include <utility>
 
 #include "src/debug.h"
@@ -128,15 +130,12 @@ static int spiral_pattern[] = {
   24, 16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 };
 
-static int spiral_pattern_initialized = 0;
+static std::once_flag spiral_pattern_initialized;
 
-/* Initialize the global spiral_pattern. */
+/* Initialize the global spiral_pattern. It is transformed in place, so this
+   must run exactly once, see spiral_pattern_initialized. */
 static void
 init_spiral_pattern() {
-  if (spiral_pattern_initialized) {
-    return;
-  }
-
   static const int spiral_matrix[] = {
     1,  0,  0,  1,
     1,  1, -1,  0,
@@ -157,8 +156,6 @@ init_spiral_pattern() {
                                      y*spiral_matrix[4*j+3];
     }
   }
-
-  spiral_pattern_initialized = 1;
 }
 
 int *
@@ -328,6 +325,16 @@ Map::Map(const MapGeometry& geom)
 
   landscape_tiles.resize(geom_.tile_count());
   game_tiles.resize(geom_.tile_count());
+  walkable_dirs.resize(geom_.tile_count());
+  sailable_dirs.resize(geom_.tile_count());
+  occupied_dirs.resize(geom_.tile_count());
+  active_tiles.resize((geom_.tile_count() + 63) / 64);
+  tile_hashes.resize(geom_.tile_count());
+  for (int i = 0; i < 4; i++) {
+    mineral_sums[i].resize(geom_.rows() * (geom_.cols() + 1));
+    mineral_moments[i].resize(geom_.rows() * (geom_.cols() + 1));
+  }
+  changed_tiles.resize(geom_.tile_count());
 
   update_state.last_tick = 0;
   update_state.counter = 0;
@@ -336,8 +343,14 @@ Map::Map(const MapGeometry& geom)
 
   regions = (geom.cols() >> 5) * (geom.rows() >> 5);
 
-  init_spiral_pattern();
+  /* Inverse of the sweep step modulo the tile count, which is a power of
+     two. Each Newton iteration doubles the number of correct bits. */
+  sweep_inverse = 23;
+  for (int i = 0; i < 6; i++) sweep_inverse *= 2 - 23 * sweep_inverse;
+
+  std::call_once(spiral_pattern_initialized, init_spiral_pattern);
   init_spiral_pos_pattern();
+  init_tile_hashes();
 }
 
 /* Return a random map position.
@@ -352,6 +365,110 @@ Map::get_rnd_coord(int *col, int *row, Random *rnd) const {
   return pos(c, r);
 }
 
+template <typename T>
+static size_t
+vector_bytes(const std::vector<T> &vector) {
+  return vector.capacity() * sizeof(T);
+}
+
+size_t
+Map::get_memory_usage() const {
+  size_t bytes = landscape_tiles.heap_bytes() + game_tiles.heap_bytes() +
+                 vector_bytes(walkable_dirs) + vector_bytes(sailable_dirs) +
+                 vector_bytes(occupied_dirs) + vector_bytes(active_tiles) +
+                 vector_bytes(tile_hashes) + vector_bytes(changed_tiles);
+  for (int i = 0; i < 4; i++) {
+    bytes += vector_bytes(mineral_sums[i]) + vector_bytes(mineral_moments[i]);
+  }
+  return bytes;
+}
+
+bool
+Map::map_tiles(const std::string &path) {
+  if (!landscape_tiles.map_new(path + ".landscape")) return false;
+  if (!game_tiles.map_new(path + ".game")) {
+    /* Bring the landscape back to the heap and drop its file. */
+    landscape_tiles.unmap();
+    std::remove((path + ".landscape").c_str());
+    return false;
+  }
+
+  tiles_path = path;
+  return true;
+}
+
+bool
+Map::load_mapped_tiles(const std::string &path) {
+  /* Open both files before either plane lets go of its tiles. */
+  MappedFile landscape;
+  MappedFile game;
+  if (!landscape.open(path + ".landscape", landscape_tiles.bytes(), false) ||
+      !game.open(path + ".game", game_tiles.bytes(), false)) {
+    return false;
+  }
+  landscape_tiles.map_file(&landscape);
+  game_tiles.map_file(&game);
+  tiles_path = path;
+
+  /* Rebuild everything derived from the tiles. */
+  init_passability();
+  init_active_tiles();
+  for (unsigned int row = 0; row < geom_.rows(); row++) init_mineral_row(row);
+  init_tile_hashes();
+
+  return true;
+}
+
+bool
+Map::sync_tiles() {
+  return landscape_tiles.sync() && game_tiles.sync();
+}
+
+void
+Map::copy_state(const Map &source) {
+  if (geom_ != source.geom_) {
+    throw ExceptionFreeserf("Failed to copy map of another size.");
+  }
+
+  /* Tiles that hash alike are taken to be unchanged. */
+  if (!change_handlers.empty()) {
+    for (MapPos pos_ : geom_) {
+      if (tile_hashes[pos_] == source.tile_hashes[pos_]) continue;
+
+      const LandscapeTile &landscape = source.landscape_tiles[pos_];
+      const GameTile &game = source.game_tiles[pos_];
+      if (landscape_tiles[pos_].height != landscape.height) {
+        mark_changed(pos_, ChangeHeight);
+      }
+      if (landscape_tiles[pos_].obj != landscape.obj ||
+          game_tiles[pos_].obj_index != game.obj_index) {
+        mark_changed(pos_, ChangeObject);
+      }
+      if (game_tiles[pos_].owner != game.owner) {
+        mark_changed(pos_, ChangeOwner);
+      }
+      if (game_tiles[pos_].paths != game.paths) {
+        mark_changed(pos_, ChangePaths);
+      }
+    }
+  }
+
+  landscape_tiles.assign(source.landscape_tiles);
+  game_tiles.assign(source.game_tiles);
+  walkable_dirs = source.walkable_dirs;
+  sailable_dirs = source.sailable_dirs;
+  occupied_dirs = source.occupied_dirs;
+  active_tiles = source.active_tiles;
+  for (int i = 0; i < 4; i++) {
+    mineral_sums[i] = source.mineral_sums[i];
+    mineral_moments[i] = source.mineral_moments[i];
+  }
+  tile_hashes = source.tile_hashes;
+  tiles_hash = source.tiles_hash;
+  regions = source.regions;
+  update_state = source.update_state;
+}
+
 // Get count of gold mineral deposits in the map.
 unsigned int
 Map::get_gold_deposit() const {
@@ -381,19 +498,228 @@ Map::init_spiral_pos_pattern() {
 void
 Map::init_tiles(const MapGenerator &generator) {
   landscape_tiles = generator.get_landscape();
+  init_passability();
+  init_active_tiles();
+  for (unsigned int row = 0; row < geom_.rows(); row++) init_mineral_row(row);
+  init_tile_hashes();
+}
+
+/* Rebuild the passability and occupancy masks from the tile data. */
+void
+Map::init_passability() {
+  for (MapPos pos_ : geom_) {
+    update_passability(pos_);
+    update_occupancy(pos_);
+  }
+}
+
+/* Update the masks of the neighbours of pos to reflect whether pos can
+   be walked or sailed on. */
+void
+Map::update_passability(MapPos pos) {
+  bool walkable = !is_in_water(pos) &&
+                  map_space_from_obj[get_obj(pos)] <= SpaceSemipassable;
+  bool sailable = (get_obj(pos) == ObjectNone);
+
+  for (Direction d : cycle_directions_cw()) {
+    MapPos other = move(pos, d);
+    uint8_t bit = BIT(reverse_direction(d));
+    walkable_dirs[other] = walkable ? (walkable_dirs[other] | bit) :
+                                      (walkable_dirs[other] & ~bit);
+    sailable_dirs[other] = sailable ? (sailable_dirs[other] | bit) :
+                                      (sailable_dirs[other] & ~bit);
+  }
+}
+
+/* Update the masks of the neighbours of pos to reflect whether pos is
+   occupied by a serf. */
+void
+Map::update_occupancy(MapPos pos) {
+  bool occupied = has_serf(pos);
+
+  for (Direction d : cycle_directions_cw()) {
+    MapPos other = move(pos, d);
+    uint8_t bit = BIT(reverse_direction(d));
+    occupied_dirs[other] = occupied ? (occupied_dirs[other] | bit) :
+                                      (occupied_dirs[other] & ~bit);
+  }
+}
+
+/* Amount of mineral at pos that ground analysis counts. Deposits below
+   flags and buildings are not seen. */
+int
+Map::get_counted_mineral(MapPos pos, Minerals mineral) const {
+  Object obj = get_obj(pos);
+  if ((obj != ObjectNone && obj < ObjectTree0) ||
+      get_res_type(pos) != mineral) {
+    return 0;
+  }
+
+  return get_res_amount(pos);
+}
+
+void
+Map::init_mineral_row(unsigned int row) {
+  MapPos base = static_cast<MapPos>(row) * (geom_.cols() + 1);
+  for (int m = 0; m < 4; m++) {
+    Minerals mineral = static_cast<Minerals>(MineralsGold + m);
+    MineralSum sum = 0;
+    MineralSum moment = 0;
+    for (unsigned int col = 0; col < geom_.cols(); col++) {
+      mineral_sums[m][base + col] = sum;
+      mineral_moments[m][base + col] = moment;
+      MineralSum amount = get_counted_mineral(pos(col, row), mineral);
+      sum += amount;
+      moment += amount * col;
+    }
+    mineral_sums[m][base + geom_.cols()] = sum;
+    mineral_moments[m][base + geom_.cols()] = moment;
+  }
+}
+
+/* Update the prefix sums of the row of pos after the counted amount at
+   pos may have changed. */
+void
+Map::update_minerals(MapPos pos) {
+  unsigned int col = pos_col(pos);
+  MapPos base = static_cast<MapPos>(pos_row(pos)) * (geom_.cols() + 1);
+  for (int m = 0; m < 4; m++) {
+    Minerals mineral = static_cast<Minerals>(MineralsGold + m);
+    MineralSum old = mineral_sums[m][base + col + 1] -
+                     mineral_sums[m][base + col];
+    MineralSum delta = get_counted_mineral(pos, mineral) - old;
+    if (delta == 0) continue;
+
+    for (unsigned int c = col + 1; c <= geom_.cols(); c++) {
+      mineral_sums[m][base + c] += delta;
+      mineral_moments[m][base + c] += delta * col;
+    }
+  }
+}
+
+/* Sum of the counted amounts of mineral in row between the columns
+   col + first and col + last, each weighted by weight + slope * (column
+   offset from col). The range may wrap around the map but must be
+   narrower than the map. */
+Map::MineralSum
+Map::sum_mineral_row(unsigned int row, int col, int first, int last,
+                     int weight, int slope, Minerals mineral) const {
+  if (first > last) return 0;
+
+  const int cols = geom_.cols();
+  MapPos base = static_cast<MapPos>(row) * (cols + 1);
+  const MineralSum *sums = &mineral_sums[mineral - 1][base];
+  const MineralSum *moments = &mineral_moments[mineral - 1][base];
+
+  MineralSum total = 0;
+  int begin = col + first;
+  int end = col + last + 1;
+  while (begin < end) {
+    /* Shift the next piece into the map; offset = column - col. */
+    int shift = (begin >= 0) ? -(begin / cols) * cols
+                             : ((cols - 1 - begin) / cols) * cols;
+    int lo = begin + shift;
+    int hi = std::min(end + shift, cols);
+    MineralSum sum = sums[hi] - sums[lo];
+    MineralSum moment = moments[hi] - moments[lo];
+    total += (weight - slope * static_cast<MineralSum>(shift + col)) * sum +
+             slope * moment;
+    begin += hi - lo;
+  }
+
+  return total;
+}
+
+Map::MineralSum
+Map::get_mineral_amount(MapPos pos, int distance, Minerals mineral) const {
+  int col = pos_col(pos);
+  int row = pos_row(pos);
+
+  /* Row dy holds the offsets dx with dy - distance <= dx <= distance
+     below pos and -distance <= dx <= distance + dy above. */
+  MineralSum total = 0;
+  for (int dy = -distance; dy <= distance; dy++) {
+    unsigned int r = (row + dy) & geom_.row_mask();
+    int first = (dy > 0) ? dy - distance : -distance;
+    int last = (dy < 0) ? distance + dy : distance;
+    total += sum_mineral_row(r, col, first, last, 1, 0, mineral);
+  }
+
+  return total;
+}
+
+int
+Map::get_mineral_estimate(MapPos pos, int radius, Minerals mineral) const {
+  int col = pos_col(pos);
+  int row = pos_row(pos);
+  int distance = radius - 1;
+
+  /* Offsets of the same sign are max(|dx|, |dy|) away, others |dx| + |dy|.
+     Each row therefore splits into three runs with weights linear in dx. */
+  MineralSum total = 0;
+  for (int dy = -distance; dy <= distance; dy++) {
+    unsigned int r = (row + dy) & geom_.row_mask();
+    if (dy >= 0) {
+      total += sum_mineral_row(r, col, dy - distance, -1,
+                               radius + 1 - dy, 1, mineral);
+      total += sum_mineral_row(r, col, 0, dy, radius + 1 - dy, 0, mineral);
+      total += sum_mineral_row(r, col, dy + 1, distance,
+                               radius + 1, -1, mineral);
+    } else {
+      total += sum_mineral_row(r, col, -distance, dy - 1,
+                               radius + 1, 1, mineral);
+      total += sum_mineral_row(r, col, dy, 0, radius + 1 + dy, 0, mineral);
+      total += sum_mineral_row(r, col, 1, distance + dy,
+                               radius + 1 + dy, -1, mineral);
+    }
+  }
+
+  /* The center was counted with weight radius + 1. */
+  return static_cast<int>(total - get_counted_mineral(pos, mineral));
+}
+
+uint64_t
+Map::compute_tile_hash(MapPos pos) const {
+  const LandscapeTile &landscape = landscape_tiles[pos];
+  const GameTile &game = game_tiles[pos];
+
+  uint64_t hash = hash_combine(0, pos);
+  hash = hash_combine(hash, landscape.height);
+  hash = hash_combine(hash, (landscape.type_up << 4) | landscape.type_down);
+  hash = hash_combine(hash, landscape.mineral);
+  hash = hash_combine(hash, landscape.resource_amount);
+  hash = hash_combine(hash, landscape.obj);
+  hash = hash_combine(hash, game.serf);
+  hash = hash_combine(hash, game.owner);
+  hash = hash_combine(hash, game.obj_index);
+  hash = hash_combine(hash, game.paths);
+  return hash_combine(hash, game.idle_serf);
+}
+
+void
+Map::init_tile_hashes() {
+  tiles_hash = 0;
+  for (MapPos pos_ : geom_) {
+    tile_hashes[pos_] = compute_tile_hash(pos_);
+    tiles_hash ^= tile_hashes[pos_];
+  }
+}
+
+void
+Map::update_tile_hash(MapPos pos) {
+  tiles_hash ^= tile_hashes[pos];
+  tile_hashes[pos] = compute_tile_hash(pos);
+  tiles_hash ^= tile_hashes[pos];
 }
 
 /* Change the height of a map position. */
 void
 Map::set_height(MapPos pos, int height) {
   landscape_tiles[pos].height = height;
+  update_tile_hash(pos);
 
   /* Mark landscape dirty */
-  for (Direction d : cycle_directions_cw()) {
-    for (Handler *handler : change_handlers) {
-      handler->on_height_changed(move(pos, d));
-    }
-  }
+  mark_changed(pos, ChangeHeight);
 }
 
 /* Change the object at a map position. If index is non-negative
@@ -403,13 +729,13 @@ void
 Map::set_object(MapPos pos, Object obj, int index) {
   landscape_tiles[pos].obj = obj;
   if (index >= 0) game_tiles[pos].obj_index = index;
+  update_tile_hash(pos);
+  update_passability(pos);
+  update_activity(pos);
+  update_minerals(pos);
 
   /* Notify about object change */
-  for (Direction d : cycle_directions_cw()) {
-    for (Handler *handler : change_handlers) {
-      handler->on_object_changed(move(pos, d));
-    }
-  }
+  mark_changed(pos, ChangeObject);
 }
 
 /* Remove resources from the ground at a map position. */
@@ -421,18 +747,24 @@ Map::remove_ground_deposit(MapPos pos, int amount) {
     /* Also sets the ground deposit type to none. */
     landscape_tiles[pos].mineral = MineralsNone;
   }
+
+  update_tile_hash(pos);
+  update_minerals(pos);
 }
 
 /* Remove fish at a map position (must be water). */
 void
 Map::remove_fish(MapPos pos, int amount) {
   landscape_tiles[pos].resource_amount -= amount;
+  update_tile_hash(pos);
 }
 
 /* Set the index of the serf occupying map position. */
 void
 Map::set_serf_index(MapPos pos, int index) {
   game_tiles[pos].serf = index;
+  update_tile_hash(pos);
+  update_occupancy(pos);
 
   /* TODO Mark dirty in viewport. */
 }
@@ -509,6 +841,7 @@ Map::update_hidden(MapPos pos, Random *rnd) {
     if (landscape_tiles[pos].resource_amount < 10 && (r & 0x3f00)) {
       /* Spawn more fish. */
       landscape_tiles[pos].resource_amount += 1;
+      update_tile_hash(pos);
     }
 
     /* Move in a random direction of: right, down right, left, up left */
@@ -525,10 +858,59 @@ Map::update_hidden(MapPos pos, Random *rnd) {
       /* Migrate a fish to adjacent water space. */
       landscape_tiles[pos].resource_amount -= 1;
       landscape_tiles[adj_pos].resource_amount += 1;
+      update_tile_hash(pos);
+      update_tile_hash(adj_pos);
+      update_activity(adj_pos);
     }
   }
 }
 
+/* Whether update() may change anything at pos. */
+bool
+Map::is_active(MapPos pos) const {
+  Object obj = get_obj(pos);
+  if (obj == ObjectStub ||
+      (obj >= ObjectFelledPine0 && obj <= ObjectField5)) {
+    return true;
+  }
+
+  return is_in_water(pos) && landscape_tiles[pos].resource_amount > 0;
+}
+
+/* Return the step of the update sweep at which pos is visited. The sweep
+   moves 23 positions right, continuing on the next row when it crosses
+   the map boundary, which is a step of 23 in MapPos order. */
+MapPos
+Map::sweep_index(MapPos pos) const {
+  return (pos * sweep_inverse) & (geom_.tile_count() - 1);
+}
+
+void
+Map::init_active_tiles() {
+  std::fill(active_tiles.begin(), active_tiles.end(), 0);
+  for (MapPos pos_ : geom_) update_activity(pos_);
+}
+
+void
+Map::update_activity(MapPos pos) {
+  MapPos index = sweep_index(pos);
+  uint64_t bit = static_cast<uint64_t>(1) << (index & 63);
+  if (is_active(pos)) {
+    active_tiles[index >> 6] |= bit;
+  } else {
+    active_tiles[index >> 6] &= ~bit;
+  }
+}
+
+/* Value of the sign removal counter after a number of sweep steps. It
+   counts down from 16 to 0 and starts over. */
+static int
+remove_signs_counter_after(int counter, MapPos steps) {
+  counter = std::max(counter, 0);
+  if (steps <= static_cast<MapPos>(counter)) return counter - steps;
+  return 16 - (steps - counter - 1) % 17;
+}
+
 /* Update map data as part of the game progression. */
 void
 Map::update(unsigned int tick, Random *rnd) {
@@ -542,28 +924,48 @@ Map::update(unsigned int tick, Random *rnd) {
     update_state.counter += 20;
   }
 
-  MapPos pos = update_state.initial_pos;
+  /* Only the active positions along the sweep are visited. Inert
+     positions would neither change nor draw random numbers, so the
+     outcome is the same as visiting every step. The bits are read anew
+     after each visit since a visit may activate positions ahead. */
+  MapPos count = geom_.tile_count();
+  MapPos start = sweep_index(update_state.initial_pos);
+  int signs_counter = update_state.remove_signs_counter;
+
+  MapPos step = 1;
+  while (step <= static_cast<MapPos>(iters)) {
+    MapPos first = (start + step) & (count - 1);
+    MapPos last = first + std::min(iters - step + 1, count - first);
+
+    MapPos index = first;
+    while (index < last) {
+      uint64_t word = active_tiles[index >> 6] >> (index & 63);
+      if (word == 0) {
+        index = (index | 63) + 1;
+        continue;
+      }
 
-  for (int i = 0; i < iters; i++) {
-    update_state.remove_signs_counter -= 1;
-    if (update_state.remove_signs_counter < 0) {
-      update_state.remove_signs_counter = 16;
-    }
+      index += __builtin_ctzll(word);
+      if (index >= last) break;
 
-    /* Test if moving 23 positions right crosses map boundary. */
-    if (pos_col(pos) + 23 < static_cast<int>(geom_.cols())) {
-      pos = move_right_n(pos, 23);
-    } else {
-      pos = move_right_n(pos, 23);
-      pos = move_down(pos);
+      MapPos pos = (index * 23) & (count - 1);
+      update_state.remove_signs_counter =
+        remove_signs_counter_after(signs_counter, step + (index - first));
+
+      /* Update map at position. */
+      update_hidden(pos, rnd);
+      update_public(pos, rnd);
+      if (!is_active(pos)) update_activity(pos);
+
+      index += 1;
     }
 
-    /* Update map at position. */
-    update_hidden(pos, rnd);
-    update_public(pos, rnd);
+    step += last - first;
   }
 
-  update_state.initial_pos = pos;
+  update_state.remove_signs_counter =
+    remove_signs_counter_after(signs_counter, iters);
+  update_state.initial_pos = ((start + iters) * 23) & (count - 1);
 }
 
 /* Return non-zero if the road segment from pos in direction dir
@@ -609,8 +1011,8 @@ Map::place_road_segments(const Road &road) {
         Direction rev_dir = *it;
         Direction dir = reverse_direction(rev_dir);
 
-        game_tiles[pos_].paths &= ~BIT(dir);
-        game_tiles[move(pos_, dir)].paths &= ~BIT(rev_dir);
+        del_path(pos_, dir);
+        del_path(move(pos_, dir), rev_dir);
 
         pos_ = move(pos_, dir);
       }
@@ -618,8 +1020,8 @@ Map::place_road_segments(const Road &road) {
       return false;
     }
 
-    game_tiles[pos_].paths |= BIT(*it);
-    game_tiles[move(pos_, *it)].paths |= BIT(rev_dir);
+    add_path(pos_, *it);
+    add_path(move(pos_, *it), rev_dir);
 
     pos_ = move(pos_, *it);
   }
@@ -633,7 +1035,7 @@ Map::remove_road_backref_until_flag(MapPos pos_, Direction dir) {
     pos_ = move(pos_, dir);
 
     /* Clear backreference */
-    game_tiles[pos_].paths &= ~BIT(reverse_direction(dir));
+    del_path(pos_, reverse_direction(dir));
 
     if (get_obj(pos_) == ObjectFlag) break;
 
@@ -687,11 +1089,11 @@ Map::remove_road_backrefs(MapPos pos_) {
 Direction
 Map::remove_road_segment(MapPos *pos, Direction dir) {
   /* Clear forward reference. */
-  game_tiles[*pos].paths &= ~BIT(dir);
+  del_path(*pos, dir);
   *pos = move(*pos, dir);
 
   /* Clear backreference. */
-  game_tiles[*pos].paths &= ~BIT(reverse_direction(dir));
+  del_path(*pos, reverse_direction(dir));
 
   /* Find next direction of path. */
   dir = DirectionNone;
@@ -749,6 +1151,41 @@ Map::add_change_handler(Handler *handler) {
 void
 Map::del_change_handler(Handler *handler) {
   change_handlers.remove(handler);
+
+  if (change_handlers.empty()) {
+    for (MapPos pos_ : changed_list) changed_tiles[pos_] = 0;
+    changed_list.clear();
+  }
+}
+
+/* Record a change at pos for the next dispatch_changes(). Nothing is
+   recorded while there is no handler to tell. */
+void
+Map::mark_changed(MapPos pos, Change change) {
+  if (change_handlers.empty()) return;
+
+  if (changed_tiles[pos] == 0) changed_list.push_back(pos);
+  changed_tiles[pos] |= change;
+}
+
+void
+Map::dispatch_changes() {
+  for (MapPos pos_ : changed_list) {
+    uint8_t change = changed_tiles[pos_];
+    changed_tiles[pos_] = 0;
+
+    for (Handler *handler : change_handlers) handler->on_tile_changed(pos_);
+
+    for (Direction d : cycle_directions_cw()) {
+      MapPos other = move(pos_, d);
+      for (Handler *handler : change_handlers) {
+        if (change & ChangeHeight) handler->on_height_changed(other);
+        if (change & ChangeObject) handler->on_object_changed(other);
+      }
+    }
+  }
+
+  changed_list.clear();
 }
 
 bool
@@ -846,6 +1283,13 @@ operator >> (SaveReaderBinary &reader, Map &map) {
     }
   }
 
+  map.init_passability();
+  map.init_active_tiles();
+  for (unsigned int row = 0; row < map.get_rows(); row++) {
+    map.init_mineral_row(row);
+  }
+  map.init_tile_hashes();
+
   return reader;
 }
 
@@ -909,6 +1353,24 @@ operator >> (SaveReaderText &reader, Map &map) {
     }
   }
 
+  /* The terrain of a position also decides whether the positions below
+     and to the right of it are surrounded by water. */
+  for (int y = 0; y <= SAVE_MAP_TILE_SIZE; y++) {
+    for (int x = 0; x <= SAVE_MAP_TILE_SIZE; x++) {
+      MapPos p = map.pos_add(pos, map.pos(x, y));
+      map.update_passability(p);
+      map.update_activity(p);
+      if (x < SAVE_MAP_TILE_SIZE && y < SAVE_MAP_TILE_SIZE) {
+        map.update_occupancy(p);
+        map.update_tile_hash(p);
+      }
+    }
+  }
+
+  for (int y = 0; y < SAVE_MAP_TILE_SIZE; y++) {
+    map.init_mineral_row(map.pos_row(map.pos_add(pos, map.pos(0, y))));
+  }
+
   return reader;
 }
 
@@ -923,24 +1385,35 @@ operator << (SaveWriterText &writer, Map &map) {
       map_writer.value("pos") << tx;
       map_writer.value("pos") << ty;
 
+      /* Look the values up once, not for every tile. */
+      SaveWriterTextValue &height = map_writer.value("height");
+      SaveWriterTextValue &type_up = map_writer.value("type.up");
+      SaveWriterTextValue &type_down = map_writer.value("type.down");
+      SaveWriterTextValue &paths = map_writer.value("paths");
+      SaveWriterTextValue &object = map_writer.value("object");
+      SaveWriterTextValue &serf = map_writer.value("serf");
+      SaveWriterTextValue &idle_serf = map_writer.value("idle_serf");
+      SaveWriterTextValue &res_type = map_writer.value("resource.type");
+      SaveWriterTextValue &res_amount = map_writer.value("resource.amount");
+
       for (int y = 0; y < SAVE_MAP_TILE_SIZE; y++) {
         for (int x = 0; x < SAVE_MAP_TILE_SIZE; x++) {
           MapPos pos = map.pos(tx+x, ty+y);
 
-          map_writer.value("height") << map.get_height(pos);
-          map_writer.value("type.up") << map.type_up(pos);
-          map_writer.value("type.down") << map.type_down(pos);
-          map_writer.value("paths") << map.paths(pos);
-          map_writer.value("object") << map.get_obj(pos);
-          map_writer.value("serf") << map.get_serf_index(pos);
-          map_writer.value("idle_serf") << map.get_idle_serf(pos);
+          height << map.get_height(pos);
+          type_up << map.type_up(pos);
+          type_down << map.type_down(pos);
+          paths << map.paths(pos);
+          object << map.get_obj(pos);
+          serf << map.get_serf_index(pos);
+          idle_serf << map.get_idle_serf(pos);
 
           if (map.is_in_water(pos)) {
-            map_writer.value("resource.type") << 0;
-            map_writer.value("resource.amount") << map.get_res_fish(pos);
+            res_type << 0;
+            res_amount << map.get_res_fish(pos);
           } else {
-            map_writer.value("resource.type") << map.get_res_type(pos);
-            map_writer.value("resource.amount") << map.get_res_amount(pos);
+            res_type << map.get_res_type(pos);
+            res_amount << map.get_res_amount(pos);
           }
         }
       }
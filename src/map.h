@@ -24,12 +24,14 @@
 
 #include <list>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "src/map-geometry.h"
 #include "src/misc.h"
 #include "src/random.h"
+#include "src/tile-plane.h"
 
 class Map;
 
@@ -194,6 +196,11 @@ class Map {
     MineralsStone,
   } Minerals;
 
+  /* Running sums of mineral amounts along a row. The sums of amounts
+     times column grow with the square of the row length, beyond 32 bits
+     on the largest maps. */
+  typedef int64_t MineralSum;
+
   /* A map space can be OPEN which means that
      a building can be constructed in the space.
      A FILLED space can be passed by a serf, but
@@ -232,6 +239,8 @@ class Map {
     virtual ~Handler() {}
     virtual void on_height_changed(MapPos pos) = 0;
     virtual void on_object_changed(MapPos pos) = 0;
+    /* Called once for a changed position, whatever the kind of change. */
+    virtual void on_tile_changed(MapPos pos) {}
   };
 
   typedef struct LandscapeTile {
@@ -293,8 +302,34 @@ class Map {
   } GameTile;
 
   MapGeometry geom_;
-  std::vector<LandscapeTile> landscape_tiles;
-  std::vector<GameTile> game_tiles;
+  TilePlane<LandscapeTile> landscape_tiles;
+  TilePlane<GameTile> game_tiles;
+  /* Path the tile files were mapped from, without the suffixes. */
+  std::string tiles_path;
+
+  /* For each position, bit masks of the directions leading to a neighbour
+     that can be walked on, sailed on or is occupied by a serf. These are
+     derived from the tiles and kept up to date by the setters. */
+  std::vector<uint8_t> walkable_dirs;
+  std::vector<uint8_t> sailable_dirs;
+  std::vector<uint8_t> occupied_dirs;
+
+  /* Positions that update() may change, one bit each, in the order the
+     update sweep visits them. Positions that turn out to be inert when
+     visited are dropped again. */
+  std::vector<uint64_t> active_tiles;
+  MapPos sweep_inverse;
+
+  /* For each mineral and row, prefix sums over the columns of the amounts
+     that ground analysis counts, and of those amounts times their column.
+     Row r starts at r * (cols + 1); mineral m is at index m - 1. */
+  std::vector<MineralSum> mineral_sums[4];
+  std::vector<MineralSum> mineral_moments[4];
+
+  /* Hash of every tile, and the XOR of them all. Kept up to date by the
+     setters so the state of the map can be compared cheaply. */
+  std::vector<uint64_t> tile_hashes;
+  uint64_t tiles_hash;
 
   uint16_t regions;
 
@@ -304,6 +339,17 @@ class Map {
   typedef std::list<Handler*> ChangeHandlers;
   ChangeHandlers change_handlers;
 
+  /* Positions changed since the handlers were last notified. Each
+     position is listed once, with the kinds of change in changed_tiles. */
+  typedef enum Change {
+    ChangeHeight = 1,
+    ChangeObject = 2,
+    ChangeOwner = 4,
+    ChangePaths = 8,
+  } Change;
+  std::vector<uint8_t> changed_tiles;
+  std::vector<MapPos> changed_list;
+
   std::unique_ptr<MapPos[]> spiral_pos_pattern;
 
  public:
@@ -366,16 +412,27 @@ class Map {
   bool has_path(MapPos pos, Direction dir) const {
     return (BIT_TEST(game_tiles[pos].paths, dir) != 0); }
   void add_path(MapPos pos, Direction dir) {
-    game_tiles[pos].paths |= BIT(dir); }
+    game_tiles[pos].paths |= BIT(dir);
+    update_tile_hash(pos);
+    mark_changed(pos, ChangePaths); }
   void del_path(MapPos pos, Direction dir) {
-    game_tiles[pos].paths &= ~BIT(dir); }
+    game_tiles[pos].paths &= ~BIT(dir);
+    update_tile_hash(pos);
+    mark_changed(pos, ChangePaths); }
 
   bool has_owner(MapPos pos) const { return (game_tiles[pos].owner != 0); }
   unsigned int get_owner(MapPos pos) const {
     return game_tiles[pos].owner - 1; }
   void set_owner(MapPos pos, unsigned int _owner) {
-    game_tiles[pos].owner = _owner + 1; }
-  void del_owner(MapPos pos) { game_tiles[pos].owner = 0; }
+    if (game_tiles[pos].owner == _owner + 1) return;
+    game_tiles[pos].owner = _owner + 1;
+    update_tile_hash(pos);
+    mark_changed(pos, ChangeOwner); }
+  void del_owner(MapPos pos) {
+    if (game_tiles[pos].owner == 0) return;
+    game_tiles[pos].owner = 0;
+    update_tile_hash(pos);
+    mark_changed(pos, ChangeOwner); }
   unsigned int get_height(MapPos pos) const {
     return landscape_tiles[pos].height; }
 
@@ -385,18 +442,36 @@ class Map {
 
   Object get_obj(MapPos pos) const { return landscape_tiles[pos].obj; }
   bool get_idle_serf(MapPos pos) const { return game_tiles[pos].idle_serf; }
-  void set_idle_serf(MapPos pos) { game_tiles[pos].idle_serf = true; }
-  void clear_idle_serf(MapPos pos) { game_tiles[pos].idle_serf = false; }
+  void set_idle_serf(MapPos pos) {
+    game_tiles[pos].idle_serf = true;
+    update_tile_hash(pos); }
+  void clear_idle_serf(MapPos pos) {
+    game_tiles[pos].idle_serf = false;
+    update_tile_hash(pos); }
 
   unsigned int get_obj_index(MapPos pos) const {
     return game_tiles[pos].obj_index; }
   void set_obj_index(MapPos pos, unsigned int index) {
-    game_tiles[pos].obj_index = index; }
+    game_tiles[pos].obj_index = index;
+    update_tile_hash(pos); }
   Minerals get_res_type(MapPos pos) const {
     return landscape_tiles[pos].mineral; }
   unsigned int get_res_amount(MapPos pos) const {
     return landscape_tiles[pos].resource_amount; }
   unsigned int get_res_fish(MapPos pos) const { return get_res_amount(pos); }
+  /* Amount of mineral at pos that ground analysis and miners count, none
+     under flags and buildings. */
+  int get_counted_mineral(MapPos pos, Minerals mineral) const;
+  /* Amount of mineral within distance of pos, where the distance counts
+     steps between neighbouring positions. Positions covered by flags or
+     buildings are left out, as in ground analysis. */
+  MineralSum get_mineral_amount(MapPos pos, int distance,
+                                Minerals mineral) const;
+  /* Amount of mineral around pos weighted by radius + 1 minus the
+     distance, counting positions up to radius - 1 away. The position
+     itself has weight radius. This is the weighting of ground analysis.
+     Positions covered by flags or buildings are left out. */
+  int get_mineral_estimate(MapPos pos, int radius, Minerals mineral) const;
   unsigned int get_serf_index(MapPos pos) const { return game_tiles[pos].serf; }
   unsigned int has_serf(MapPos pos) const {
     return (game_tiles[pos].serf != 0); }
@@ -422,6 +497,15 @@ class Map {
   /* Mapping from Object to Space. */
   static const Space map_space_from_obj[128];
 
+  /* Directions from pos to a neighbour a free-walking serf can move to:
+     passable (or open water when sailing) and not occupied by a serf. */
+  unsigned int get_free_dirs(MapPos pos, bool water) const {
+    return (water ? sailable_dirs[pos] : walkable_dirs[pos]) &
+           ~occupied_dirs[pos]; }
+  /* Directions from pos to a neighbour occupied by a serf. */
+  unsigned int get_occupied_dirs(MapPos pos) const {
+    return occupied_dirs[pos]; }
+
   void set_height(MapPos pos, int height);
   void set_object(MapPos pos, Object obj, int index);
   void remove_ground_deposit(MapPos pos, int amount);
@@ -440,6 +524,38 @@ class Map {
 
   void add_change_handler(Handler *handler);
   void del_change_handler(Handler *handler);
+  /* Notify the change handlers about the neighbours of every position
+     changed since the last call. Called by the handlers once per frame. */
+  void dispatch_changes();
+  /* Record that the object at pos changed state without being replaced,
+     e.g. a large building that finished leveling. */
+  void mark_object_changed(MapPos pos) { mark_changed(pos, ChangeObject); }
+
+  /* Hash of the contents of all tiles. */
+  uint64_t get_state_hash() const { return tiles_hash; }
+
+  /* Take over the tiles of a map of the same geometry. Positions whose
+     tiles differ are passed on to the change handlers, which stay. */
+  void copy_state(const Map &source);
+
+  /* Bytes held on the heap by the tiles and the tables kept for each
+     tile. Mapped tiles are not counted. */
+  size_t get_memory_usage() const;
+
+  /* Keep the landscape and game tiles in files at path with the suffixes
+     .landscape and .game, mapped into memory, instead of on the heap. The
+     current tiles are copied to the files. On failure the tiles stay on
+     the heap and no files are left behind. */
+  bool map_tiles(const std::string &path);
+  /* Map tile files written for a map of the same geometry and use them
+     as the tiles of this map. On failure the tiles are unchanged. */
+  bool load_mapped_tiles(const std::string &path);
+  bool is_mapped() const {
+    return landscape_tiles.is_mapped() || game_tiles.is_mapped(); }
+  const std::string &get_tiles_path() const { return tiles_path; }
+  /* Write changes of mapped tiles back to their files, after which the
+     files are a snapshot of the tiles. */
+  bool sync_tiles();
 
   static int *get_spiral_pattern();
 
@@ -465,6 +581,21 @@ class Map {
 
  protected:
   void init_spiral_pos_pattern();
+  void mark_changed(MapPos pos, Change change);
+  void init_passability();
+  void update_passability(MapPos pos);
+  void update_occupancy(MapPos pos);
+  bool is_active(MapPos pos) const;
+  MapPos sweep_index(MapPos pos) const;
+  void init_active_tiles();
+  void update_activity(MapPos pos);
+  void init_mineral_row(unsigned int row);
+  void update_minerals(MapPos pos);
+  uint64_t compute_tile_hash(MapPos pos) const;
+  void init_tile_hashes();
+  void update_tile_hash(MapPos pos);
+  MineralSum sum_mineral_row(unsigned int row, int col, int first, int last,
+                             int weight, int slope, Minerals mineral) const;
 
   void update_public(MapPos pos, Random *rnd);
   void update_hidden(MapPos pos, Random *rnd);
@@ -0,0 +1,132 @@
+/*
+ * military-index.cc - Spatial index of military buildings
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/military-index.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "src/building.h"
+#include "src/game.h"
+
+MilitaryIndex::MilitaryIndex()
+  : cols(0)
+  , rows(0)
+  , row_shift(0) {
+}
+
+void
+MilitaryIndex::init(const MapGeometry &geom) {
+  cols = geom.cols();
+  rows = geom.rows();
+  row_shift = geom.row_shift();
+  players.clear();
+}
+
+void
+MilitaryIndex::clear() {
+  players.clear();
+}
+
+unsigned int
+MilitaryIndex::cell_of(MapPos pos) const {
+  unsigned int col = (pos & (cols - 1)) >> kCellShift;
+  unsigned int row = ((pos >> row_shift) & (rows - 1)) >> kCellShift;
+  return row * cell_cols() + col;
+}
+
+void
+MilitaryIndex::copy_from(const MilitaryIndex &other, Game *game) {
+  cols = other.cols;
+  rows = other.rows;
+  row_shift = other.row_shift;
+  players = other.players;
+  for (Cells &cells : players) {
+    for (ListBuildings &cell : cells) {
+      for (Building *&building : cell) {
+        building = game->get_building(building->get_index());
+      }
+    }
+  }
+}
+
+void
+MilitaryIndex::add(Building *building) {
+  unsigned int owner = building->get_owner();
+  if (owner >= players.size()) {
+    players.resize(owner + 1);
+  }
+  Cells &cells = players[owner];
+  if (cells.empty()) {
+    cells.resize(cell_cols() * cell_rows());
+  }
+
+  cells[cell_of(building->get_position())].push_back(building);
+}
+
+void
+MilitaryIndex::remove(Building *building) {
+  unsigned int owner = building->get_owner();
+  if (owner >= players.size() || players[owner].empty()) return;
+
+  ListBuildings &cell = players[owner][cell_of(building->get_position())];
+  ListBuildings::iterator it = std::find(cell.begin(), cell.end(), building);
+  if (it != cell.end()) {
+    *it = cell.back();
+    cell.pop_back();
+  }
+}
+
+void
+MilitaryIndex::find(MapPos pos, int radius, unsigned int player,
+                    ListBuildings *result) const {
+  if (player >= players.size() || players[player].empty()) return;
+  const Cells &cells = players[player];
+
+  int col = pos & (cols - 1);
+  int row = (pos >> row_shift) & (rows - 1);
+
+  /* Range of cells covering the square, without visiting a cell twice
+     when the square wraps around the whole map. */
+  int first_col = (col - radius) >> kCellShift;
+  int col_count = std::min(((col + radius) >> kCellShift) - first_col + 1,
+                           static_cast<int>(cell_cols()));
+  int first_row = (row - radius) >> kCellShift;
+  int row_count = std::min(((row + radius) >> kCellShift) - first_row + 1,
+                           static_cast<int>(cell_rows()));
+
+  for (int y = 0; y < row_count; y++) {
+    unsigned int cell_row = (first_row + y) & (cell_rows() - 1);
+    for (int x = 0; x < col_count; x++) {
+      unsigned int cell_col = (first_col + x) & (cell_cols() - 1);
+      for (Building *building : cells[cell_row * cell_cols() + cell_col]) {
+        MapPos other = building->get_position();
+        int dx = ((other & (cols - 1)) - col) & (cols - 1);
+        int dy = (((other >> row_shift) & (rows - 1)) - row) & (rows - 1);
+        dx = std::min(dx, static_cast<int>(cols) - dx);
+        dy = std::min(dy, static_cast<int>(rows) - dy);
+        if (dx <= radius && dy <= radius) {
+          result->push_back(building);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * military-index.h - Spatial index of military buildings
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_MILITARY_INDEX_H_
+#define SRC_MILITARY_INDEX_H_
+
+#include <vector>
+
+#include "src/map-geometry.h"
+
+class Building;
+class Game;
+
+/* Military buildings of each player, bucketed by map position into square
+   cells so that proximity queries only look at nearby buildings. The
+   index only tracks which buildings exist and who owns them; callers
+   still check the state of the buildings they get back. */
+class MilitaryIndex {
+ public:
+  typedef std::vector<Building*> ListBuildings;
+
+ protected:
+  static const unsigned int kCellShift = 4;
+
+  typedef std::vector<ListBuildings> Cells;
+
+  std::vector<Cells> players;
+  unsigned int cols;
+  unsigned int rows;
+  unsigned int row_shift;
+
+  unsigned int cell_cols() const { return cols >> kCellShift; }
+  unsigned int cell_rows() const { return rows >> kCellShift; }
+  unsigned int cell_of(MapPos pos) const;
+
+ public:
+  MilitaryIndex();
+
+  void init(const MapGeometry &geom);
+  void clear();
+
+  /* Hold the buildings of other in the same order, each replaced by the
+     building of the same index in game. */
+  void copy_from(const MilitaryIndex &other, Game *game);
+
+  void add(Building *building);
+  void remove(Building *building);
+
+  /* Append the buildings of player that are at most radius columns and
+     rows away from pos to result. */
+  void find(MapPos pos, int radius, unsigned int player,
+            ListBuildings *result) const;
+};
+
+#endif  // SRC_MILITARY_INDEX_H_
@@ -181,7 +181,7 @@ void
 MinimapGame::draw_minimap_roads() {
   for (unsigned int row = 0; row < map->get_rows(); row++) {
     for (unsigned int col = 0; col < map->get_cols(); col++) {
-      int pos = map->pos(col, row);
+      MapPos pos = map->pos(col, row);
       if (map->paths(pos)) {
         draw_minimap_point(col, row, Color::black, scale);
       }
@@ -206,7 +206,7 @@ MinimapGame::draw_minimap_buildings() {
 
   for (unsigned int row = 0; row < map->get_rows(); row++) {
     for (unsigned int col = 0; col < map->get_cols(); col++) {
-      int pos = map->pos(col, row);
+      MapPos pos = map->pos(col, row);
       int obj = map->get_obj(pos);
       if (obj > Map::ObjectFlag && obj <= Map::ObjectCastle) {
         Color color = interface->get_player_color(map->get_owner(pos));
@@ -227,7 +227,7 @@ void
 MinimapGame::draw_minimap_traffic() {
   for (unsigned int row = 0; row < map->get_rows(); row++) {
     for (unsigned int col = 0; col < map->get_cols(); col++) {
-      int pos = map->pos(col, row);
+      MapPos pos = map->pos(col, row);
       if (map->get_idle_serf(pos)) {
         Color color = interface->get_player_color(map->get_owner(pos));
         draw_minimap_point(col, row, color, scale);
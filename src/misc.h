@@ -22,10 +22,23 @@
 #ifndef SRC_MISC_H_
 #define SRC_MISC_H_
 
+#include <cstdint>
+
 #define BIT(n)            (1 << (n))
 #define BIT_TEST(x, n)    ((x) & BIT(n))
 #define BIT_INVERT(x, n)  ((x) ^= 1 << (n))
 
 #define FREESERF_CLAMP(l, x, h)  (std::max((l), std::min((x), (h))))
 
+/* Fold value into a running 64-bit hash. The result is the same on every
+   platform, so hashes can be compared between machines. */
+inline uint64_t
+hash_combine(uint64_t hash, uint64_t value) {
+  uint64_t x = hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) +
+                       (hash >> 2));
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
 #endif  // SRC_MISC_H_
@@ -379,12 +379,14 @@ GameInfo::Mission missions[] = {
 
 GameInfo::GameInfo(const Random &_random_base)
   : map_size(3)
+  , parallel_map(false)
   , name(_random_base) {
   set_random_base(_random_base);
 }
 
 GameInfo::GameInfo(const GameInfo::Mission *mission_preset) {
   map_size = 3;
+  parallel_map = false;
   name = mission_preset->name;
   random_base = mission_preset->rnd;
   for (size_t i = 0; i < mission_preset->player.size(); i++) {
@@ -490,10 +492,13 @@ GameInfo::get_character_count() {
 }
 
 PGame
-GameInfo::instantiate() {
+GameInfo::instantiate(ThreadPool *pool) {
   PGame game = std::make_shared<Game>();
+  if (pool != nullptr) {
+    game->set_thread_pool(pool);
+  }
 
-  if (!game->init(map_size, random_base)) {
+  if (!game->init(map_size, random_base, parallel_map)) {
     return nullptr;
   }
 
@@ -102,6 +102,7 @@ class GameInfo {
 
  protected:
   unsigned int map_size;
+  bool parallel_map;
   Random random_base;
   PlayerInfos players;
   std::string name;
@@ -113,8 +114,13 @@ class GameInfo {
  public:
   explicit GameInfo(const Random &random_base);
 
+  std::string get_name() const { return name; }
   unsigned int get_map_size() const { return map_size; }
   void set_map_size(unsigned int size) { map_size = size; }
+  /* Whether the map comes from the parallel generator, which makes a
+     different map from the same seed. */
+  bool get_parallel_map() const { return parallel_map; }
+  void set_parallel_map(bool parallel) { parallel_map = parallel; }
   Random get_random_base() const { return random_base; }
   void set_random_base(const Random &base);
   size_t get_player_count() const { return players.size(); }
@@ -133,7 +139,8 @@ class GameInfo {
   static const Character *get_character(size_t character);
   static size_t get_character_count();
 
-  PGame instantiate();
+  /* Create the game, running its parallel work on pool if given. */
+  PGame instantiate(ThreadPool *pool = nullptr);
 };
 
 #endif  // SRC_MISSION_H_
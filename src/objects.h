@@ -43,7 +43,9 @@ class GameObject {
   GameObject(GameObject&& that) = delete;  // Moving prohibited
   virtual ~GameObject() {}
 
-  GameObject& operator = (const GameObject& that) = delete;
+  /* Assigning takes over the state of an object, usually the one with the
+     same index in another game, but not its game or index. */
+  GameObject& operator = (const GameObject& /*that*/) { return *this; }
   GameObject& operator = (GameObject&& that) = delete;
 
   Game *get_game() const { return game; }
@@ -91,6 +93,31 @@ class Collection {
     objects.clear();
   }
 
+  /* Hold copies of the objects of other at the same indexes, reusing the
+     objects already here. */
+  void copy_from(const Collection &other) {
+    for (size_t i = other.objects.size(); i < objects.size(); i++) {
+      delete objects[i];
+    }
+    objects.resize(other.objects.size(), nullptr);
+
+    for (unsigned int i = 0; i < objects.size(); i++) {
+      const T *source = other.objects[i];
+      if (source == nullptr) {
+        delete objects[i];
+        objects[i] = nullptr;
+        continue;
+      }
+      if (objects[i] == nullptr) {
+        objects[i] = new T(game, i);
+      }
+      *objects[i] = *source;
+    }
+
+    last_object_index = other.last_object_index;
+    free_object_indexes = other.free_object_indexes;
+  }
+
   T*
   allocate() {
     unsigned int new_index = 0;
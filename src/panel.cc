@@ -283,9 +283,11 @@ PanelBar::button_click(int button) {
       interface->build_castle();
       break;
     case ButtonDestroyRoad: {
-      bool r = interface->get_player()->get_game()->demolish_road(
-                                                interface->get_map_cursor_pos(),
-                                                       interface->get_player());
+      bool r = false;
+      MapPos pos = interface->get_map_cursor_pos();
+      interface->run_player_command([pos, &r](Player *player) {
+        r = player->get_game()->demolish_road(pos, player);
+      });
       if (!r) {
         play_sound(Audio::TypeSfxNotAccepted);
         interface->update_map_cursor_pos(interface->get_map_cursor_pos());
@@ -341,8 +343,11 @@ PanelBar::handle_click_left(int cx, int cy) {
       timer_length = 60*60;
     }
 
-    interface->get_player()->add_timer(timer_length * TICKS_PER_SEC,
-                                       interface->get_map_cursor_pos());
+    int timeout = timer_length * TICKS_PER_SEC;
+    MapPos pos = interface->get_map_cursor_pos();
+    interface->post_player_command([timeout, pos](Player *player) {
+      player->add_timer(timeout, pos);
+    });
 
     play_sound(Audio::TypeSfxAccepted);
   } else if (cy >= 4 && cy < 36 && cx >= 64) {
@@ -22,6 +22,10 @@
 #include "src/player.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include "src/game.h"
 #include "src/log.h"
@@ -259,6 +263,13 @@ Player::add_timer(int timeout, MapPos pos) {
   timers.push_back(new_timer);
 }
 
+/* The stock priorities of buildings follow the distribution settings,
+   so the buildings have to look at them again. */
+void
+Player::settings_changed() {
+  game->wake_player_buildings(index);
+}
+
 /* Set defaults for food distribution priorities. */
 void
 Player::reset_food_priority() {
@@ -266,6 +277,7 @@ Player::reset_food_priority() {
   food_coalmine = 45850;
   food_ironmine = 45850;
   food_goldmine = 65500;
+  settings_changed();
 }
 
 /* Set defaults for planks distribution priorities. */
@@ -274,6 +286,7 @@ Player::reset_planks_priority() {
   planks_construction = 65500;
   planks_boatbuilder = 3275;
   planks_toolmaker = 19650;
+  settings_changed();
 }
 
 /* Set defaults for steel distribution priorities. */
@@ -281,6 +294,7 @@ void
 Player::reset_steel_priority() {
   steel_toolmaker = 45850;
   steel_weaponsmith = 65500;
+  settings_changed();
 }
 
 /* Set defaults for coal distribution priorities. */
@@ -289,6 +303,7 @@ Player::reset_coal_priority() {
   coal_steelsmelter = 32750;
   coal_goldsmelter = 65500;
   coal_weaponsmith = 52400;
+  settings_changed();
 }
 
 /* Set defaults for coal distribution priorities. */
@@ -296,6 +311,7 @@ void
 Player::reset_wheat_priority() {
   wheat_pigfarm = 65500;
   wheat_mill = 32750;
+  settings_changed();
 }
 
 /* Set defaults for tool production priorities. */
@@ -463,6 +479,35 @@ Player::available_knights_at_pos(MapPos pos, int index_, int dist) {
   return index_ + 1;
 }
 
+/* Order in which the 32 shells around a target are visited when looking
+   for knights, indexed by column and row offset from the target. The
+   shells start right of the target and go clockwise. Offsets that are not
+   visited are -1. */
+static const int *
+attack_spiral_order() {
+  static int order[65*65];
+  static std::once_flag initialized;
+  std::call_once(initialized, []() {
+    std::fill(order, order + 65*65, -1);
+    const int moves[6][2] = {
+      { 0, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, 0 }, { 1, 1 }
+    };
+    int x = 0, y = 0, n = 0;
+    for (int i = 0; i < 32; i++) {
+      x += 1;
+      for (int k = 0; k < 6; k++) {
+        for (int j = 0; j < i+1; j++) {
+          order[(y+32)*65 + x+32] = n++;
+          x += moves[k][0];
+          y += moves[k][1];
+        }
+      }
+    }
+  });
+
+  return order;
+}
+
 int
 Player::knights_available_for_attack(MapPos pos) {
   /* Reset counters. */
@@ -470,36 +515,43 @@ Player::knights_available_for_attack(MapPos pos) {
     attacking_knights[i] = 0;
   }
 
-  int count = 0;
   PMap map = game->get_map();
-
-  /* Iterate each shell around the position.*/
-  for (int i = 0; i < 32; i++) {
-    pos = map->move_right(pos);
-    for (int j = 0; j < i+1; j++) {
-      count = available_knights_at_pos(pos, count, i >> 3);
-      pos = map->move_down(pos);
-    }
-    for (int j = 0; j < i+1; j++) {
-      count = available_knights_at_pos(pos, count, i >> 3);
-      pos = map->move_left(pos);
-    }
-    for (int j = 0; j < i+1; j++) {
-      count = available_knights_at_pos(pos, count, i >> 3);
-      pos = map->move_up_left(pos);
-    }
-    for (int j = 0; j < i+1; j++) {
-      count = available_knights_at_pos(pos, count, i >> 3);
-      pos = map->move_up(pos);
-    }
-    for (int j = 0; j < i+1; j++) {
-      count = available_knights_at_pos(pos, count, i >> 3);
-      pos = map->move_right(pos);
-    }
-    for (int j = 0; j < i+1; j++) {
-      count = available_knights_at_pos(pos, count, i >> 3);
-      pos = map->move_down_right(pos);
+  const int *order = attack_spiral_order();
+
+  /* Visit the military buildings near the position in the same order as
+     a walk along each shell around it. On small maps an offset can be
+     reached in more than one way; the first visit counts. */
+  MilitaryIndex::ListBuildings nearby;
+  game->get_military_index().find(pos, 32, index, &nearby);
+
+  std::vector<std::pair<int, Building*>> visits;
+  for (Building *building : nearby) {
+    int dx = map->dist_x(building->get_position(), pos);
+    int dy = map->dist_y(building->get_position(), pos);
+    int first = -1;
+    for (int x : { dx, dx - static_cast<int>(map->get_cols()),
+                   dx + static_cast<int>(map->get_cols()) }) {
+      for (int y : { dy, dy - static_cast<int>(map->get_rows()),
+                     dy + static_cast<int>(map->get_rows()) }) {
+        if (abs(x) > 32 || abs(y) > 32) continue;
+        int n = order[(y+32)*65 + x+32];
+        if (n >= 0 && (first < 0 || n < first)) first = n;
+      }
     }
+    if (first >= 0) visits.push_back(std::make_pair(first, building));
+  }
+  std::sort(visits.begin(), visits.end(),
+            [](const std::pair<int, Building*> &a,
+               const std::pair<int, Building*> &b) {
+    return a.first < b.first; });
+
+  int count = 0;
+  for (const std::pair<int, Building*> &visit : visits) {
+    /* Shell i holds the 6*(i+1) offsets after the first 3*i*(i+1). */
+    int shell = 0;
+    while (3*(shell+1)*(shell+2) <= visit.first) shell += 1;
+    count = available_knights_at_pos(visit.second->get_position(), count,
+                                     shell >> 3);
   }
 
   attacking_building_count = count;
@@ -307,33 +307,47 @@ class Player : public GameObject {
   void set_serf_to_knight_rate(int rate) { serf_to_knight_rate = rate; }
   unsigned int get_food_for_building(unsigned int bld_type) const;
   int get_food_stonemine() const { return food_stonemine; }
-  void set_food_stonemine(int val) { food_stonemine = val; }
+  void set_food_stonemine(int val) {
+    food_stonemine = val; settings_changed(); }
   int get_food_coalmine() const { return food_coalmine; }
-  void set_food_coalmine(int val) { food_coalmine = val; }
+  void set_food_coalmine(int val) {
+    food_coalmine = val; settings_changed(); }
   int get_food_ironmine() const { return food_ironmine; }
-  void set_food_ironmine(int val) { food_ironmine = val; }
+  void set_food_ironmine(int val) {
+    food_ironmine = val; settings_changed(); }
   int get_food_goldmine() const { return food_goldmine; }
-  void set_food_goldmine(int val) { food_goldmine = val; }
+  void set_food_goldmine(int val) {
+    food_goldmine = val; settings_changed(); }
   int get_planks_construction() const { return planks_construction; }
-  void set_planks_construction(int val) { planks_construction = val; }
+  void set_planks_construction(int val) {
+    planks_construction = val; settings_changed(); }
   int get_planks_boatbuilder() const { return planks_boatbuilder; }
-  void set_planks_boatbuilder(int val) { planks_boatbuilder = val; }
+  void set_planks_boatbuilder(int val) {
+    planks_boatbuilder = val; settings_changed(); }
   int get_planks_toolmaker() const { return planks_toolmaker; }
-  void set_planks_toolmaker(int val) { planks_toolmaker = val; }
+  void set_planks_toolmaker(int val) {
+    planks_toolmaker = val; settings_changed(); }
   int get_steel_toolmaker() const { return steel_toolmaker; }
-  void set_steel_toolmaker(int val) { steel_toolmaker = val; }
+  void set_steel_toolmaker(int val) {
+    steel_toolmaker = val; settings_changed(); }
   int get_steel_weaponsmith() const { return steel_weaponsmith; }
-  void set_steel_weaponsmith(int val) { steel_weaponsmith = val; }
+  void set_steel_weaponsmith(int val) {
+    steel_weaponsmith = val; settings_changed(); }
   int get_coal_steelsmelter() const { return coal_steelsmelter; }
-  void set_coal_steelsmelter(int val) { coal_steelsmelter = val; }
+  void set_coal_steelsmelter(int val) {
+    coal_steelsmelter = val; settings_changed(); }
   int get_coal_goldsmelter() const { return coal_goldsmelter; }
-  void set_coal_goldsmelter(int val) { coal_goldsmelter = val; }
+  void set_coal_goldsmelter(int val) {
+    coal_goldsmelter = val; settings_changed(); }
   int get_coal_weaponsmith() const { return coal_weaponsmith; }
-  void set_coal_weaponsmith(int val) { coal_weaponsmith = val; }
+  void set_coal_weaponsmith(int val) {
+    coal_weaponsmith = val; settings_changed(); }
   int get_wheat_pigfarm() const { return wheat_pigfarm; }
-  void set_wheat_pigfarm(int val) { wheat_pigfarm = val; }
+  void set_wheat_pigfarm(int val) {
+    wheat_pigfarm = val; settings_changed(); }
   int get_wheat_mill() const { return wheat_mill; }
-  void set_wheat_mill(int val) { wheat_mill = val; }
+  void set_wheat_mill(int val) {
+    wheat_mill = val; settings_changed(); }
 
   friend SaveReaderBinary&
     operator >> (SaveReaderBinary &reader, Player &player);
@@ -343,6 +357,7 @@ class Player : public GameObject {
     operator << (SaveWriterText &writer, Player &player);
 
  protected:
+  void settings_changed();
   void create_initial_castle_serfs(Building *castle);
   bool spawn_serf(Serf **serf, Inventory **inventory, bool want_knight);
 
@@ -26,6 +26,7 @@
 
 #include "src/misc.h"
 #include "src/game.h"
+#include "src/game-manager.h"
 #include "src/debug.h"
 #include "src/data.h"
 #include "src/audio.h"
@@ -2778,17 +2779,18 @@ PopupBox::activate_sett_5_6_item(int index) {
 
 void
 PopupBox::move_sett_5_6_item(int up, int to_end) {
-  int *prio = nullptr;
-  int cur = -1;
+  bool flags = (interface->get_popup_box()->get_box() == TypeSett5);
+  int cur = flags ? current_sett_5_item-1 : current_sett_6_item-1;
 
-  if (interface->get_popup_box()->get_box() == TypeSett5) {
-    prio = interface->get_player()->get_flag_prio();
-    cur = current_sett_5_item-1;
-  } else {
-    prio = interface->get_player()->get_inventory_prio();
-    cur = current_sett_6_item-1;
-  }
+  interface->run_player_command([flags, cur, up, to_end](Player *player) {
+    move_prio_item(flags ? player->get_flag_prio() :
+                           player->get_inventory_prio(), cur, up, to_end);
+  });
+}
 
+/* Move the item at index cur of the priority list prio up or down. */
+void
+PopupBox::move_prio_item(int *prio, int cur, int up, int to_end) {
   int cur_value = prio[cur];
   int next_value = -1;
   if (up) {
@@ -2819,9 +2821,13 @@ PopupBox::move_sett_5_6_item(int up, int to_end) {
 void
 PopupBox::handle_send_geologist() {
   MapPos pos = interface->get_map_cursor_pos();
-  Flag *flag = interface->get_game()->get_flag_at_pos(pos);
+  bool sent = false;
+  interface->run_player_command([pos, &sent](Player *player) {
+    Game *game = player->get_game();
+    sent = game->send_geologist(game->get_flag_at_pos(pos));
+  });
 
-  if (!interface->get_game()->send_geologist(flag)) {
+  if (!sent) {
     play_sound(Audio::TypeSfxNotAccepted);
   } else {
     play_sound(Audio::TypeSfxAccepted);
@@ -2831,7 +2837,10 @@ PopupBox::handle_send_geologist() {
 
 void
 PopupBox::sett_8_train(int number) {
-  int r = interface->get_player()->promote_serfs_to_knights(number);
+  int r = 0;
+  interface->run_player_command([number, &r](Player *player) {
+    r = player->promote_serfs_to_knights(number);
+  });
 
   if (r == 0) {
     play_sound(Audio::TypeSfxNotAccepted);
@@ -2842,18 +2851,20 @@ PopupBox::sett_8_train(int number) {
 
 void
 PopupBox::set_inventory_resource_mode(int mode) {
-  Building *building = interface->get_game()->get_building(
-                                           interface->get_player()->temp_index);
-  Inventory *inventory = building->get_inventory();
-  interface->get_game()->set_inventory_resource_mode(inventory, mode);
+  interface->run_player_command([mode](Player *player) {
+    Game *game = player->get_game();
+    Building *building = game->get_building(player->temp_index);
+    game->set_inventory_resource_mode(building->get_inventory(), mode);
+  });
 }
 
 void
 PopupBox::set_inventory_serf_mode(int mode) {
-  Building *building = interface->get_game()->get_building(
-                                           interface->get_player()->temp_index);
-  Inventory *inventory = building->get_inventory();
-  interface->get_game()->set_inventory_serf_mode(inventory, mode);
+  interface->run_player_command([mode](Player *player) {
+    Game *game = player->get_game();
+    Building *building = game->get_building(player->temp_index);
+    game->set_inventory_serf_mode(building->get_inventory(), mode);
+  });
 }
 
 void
@@ -3066,17 +3077,23 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
   }
   case ACTION_ATTACKING_KNIGHTS_DEC:
-    player->knights_attacking = std::max(player->knights_attacking-1, 0);
+    interface->run_player_command([](Player *player_) {
+      player_->knights_attacking = std::max(player_->knights_attacking-1, 0);
+    });
     break;
   case ACTION_ATTACKING_KNIGHTS_INC:
-    player->knights_attacking = std::min(player->knights_attacking + 1,
-                                std::min(player->total_attacking_knights, 100));
+    interface->run_player_command([](Player *player_) {
+      player_->knights_attacking = std::min(player_->knights_attacking + 1,
+                               std::min(player_->total_attacking_knights, 100));
+    });
     break;
   case ACTION_START_ATTACK:
     if (player->knights_attacking > 0) {
       if (player->attacking_building_count > 0) {
         play_sound(Audio::TypeSfxAccepted);
-        player->start_attack();
+        interface->post_player_command([](Player *player_) {
+          player_->start_attack();
+        });
       }
       interface->close_popup();
     } else {
@@ -3110,159 +3127,237 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
   case ACTION_SETT_1_ADJUST_STONEMINE:
     interface->open_popup(TypeSett1);
-    player->set_food_stonemine(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_food_stonemine(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_1_ADJUST_COALMINE:
     interface->open_popup(TypeSett1);
-    player->set_food_coalmine(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_food_coalmine(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_1_ADJUST_IRONMINE:
     interface->open_popup(TypeSett1);
-    player->set_food_ironmine(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_food_ironmine(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_1_ADJUST_GOLDMINE:
     interface->open_popup(TypeSett1);
-    player->set_food_goldmine(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_food_goldmine(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_2_ADJUST_CONSTRUCTION:
     interface->open_popup(TypeSett2);
-    player->set_planks_construction(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_planks_construction(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_2_ADJUST_BOATBUILDER:
     interface->open_popup(TypeSett2);
-    player->set_planks_boatbuilder(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_planks_boatbuilder(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_2_ADJUST_TOOLMAKER_PLANKS:
     interface->open_popup(TypeSett2);
-    player->set_planks_toolmaker(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_planks_toolmaker(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_2_ADJUST_TOOLMAKER_STEEL:
     interface->open_popup(TypeSett2);
-    player->set_steel_toolmaker(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_steel_toolmaker(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_2_ADJUST_WEAPONSMITH:
     interface->open_popup(TypeSett2);
-    player->set_steel_weaponsmith(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_steel_weaponsmith(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_3_ADJUST_STEELSMELTER:
     interface->open_popup(TypeSett3);
-    player->set_coal_steelsmelter(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_coal_steelsmelter(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_3_ADJUST_GOLDSMELTER:
     interface->open_popup(TypeSett3);
-    player->set_coal_goldsmelter(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_coal_goldsmelter(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_3_ADJUST_WEAPONSMITH:
     interface->open_popup(TypeSett3);
-    player->set_coal_weaponsmith(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_coal_weaponsmith(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_3_ADJUST_PIGFARM:
     interface->open_popup(TypeSett3);
-    player->set_wheat_pigfarm(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_wheat_pigfarm(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_3_ADJUST_MILL:
     interface->open_popup(TypeSett3);
-    player->set_wheat_mill(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_wheat_mill(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_KNIGHT_LEVEL_CLOSEST_MIN_DEC:
-    player->change_knight_occupation(3, 0, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(3, 0, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSEST_MIN_INC:
-    player->change_knight_occupation(3, 0, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(3, 0, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSEST_MAX_DEC:
-    player->change_knight_occupation(3, 1, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(3, 1, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSEST_MAX_INC:
-    player->change_knight_occupation(3, 1, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(3, 1, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSE_MIN_DEC:
-    player->change_knight_occupation(2, 0, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(2, 0, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSE_MIN_INC:
-    player->change_knight_occupation(2, 0, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(2, 0, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSE_MAX_DEC:
-    player->change_knight_occupation(2, 1, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(2, 1, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_CLOSE_MAX_INC:
-    player->change_knight_occupation(2, 1, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(2, 1, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FAR_MIN_DEC:
-    player->change_knight_occupation(1, 0, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(1, 0, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FAR_MIN_INC:
-    player->change_knight_occupation(1, 0, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(1, 0, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FAR_MAX_DEC:
-    player->change_knight_occupation(1, 1, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(1, 1, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FAR_MAX_INC:
-    player->change_knight_occupation(1, 1, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(1, 1, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FARTHEST_MIN_DEC:
-    player->change_knight_occupation(0, 0, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(0, 0, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FARTHEST_MIN_INC:
-    player->change_knight_occupation(0, 0, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(0, 0, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FARTHEST_MAX_DEC:
-    player->change_knight_occupation(0, 1, -1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(0, 1, -1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_KNIGHT_LEVEL_FARTHEST_MAX_INC:
-    player->change_knight_occupation(0, 1, 1);
+    interface->run_player_command([](Player *player_) {
+      player_->change_knight_occupation(0, 1, 1);
+    });
     interface->open_popup(TypeKnightLevel);
     break;
   case ACTION_SETT_4_ADJUST_SHOVEL:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(0, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(0, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_HAMMER:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(1, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(1, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_AXE:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(5, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(5, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_SAW:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(6, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(6, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_SCYTHE:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(4, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(4, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_PICK:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(7, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(7, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_PINCER:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(8, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(8, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_CLEAVER:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(3, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(3, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_4_ADJUST_ROD:
     interface->open_popup(TypeSett4);
-    player->set_tool_prio(2, gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_tool_prio(2, gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_5_6_ITEM_1:
   case ACTION_SETT_5_6_ITEM_2:
@@ -3327,7 +3422,9 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
     /* TODO */
   case ACTION_SETT_8_CYCLE:
-    player->cycle_knights();
+    interface->run_player_command([](Player *player_) {
+      player_->cycle_knights();
+    });
     play_sound(Audio::TypeSfxAccepted);
     break;
   case ACTION_CLOSE_OPTIONS:
@@ -3350,20 +3447,28 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
   case ACTION_DEFAULT_SETT_1:
     interface->open_popup(TypeSett1);
-    player->reset_food_priority();
+    interface->run_player_command([](Player *player_) {
+      player_->reset_food_priority();
+    });
     break;
   case ACTION_DEFAULT_SETT_2:
     interface->open_popup(TypeSett2);
-    player->reset_planks_priority();
-    player->reset_steel_priority();
+    interface->run_player_command([](Player *player_) {
+      player_->reset_planks_priority();
+      player_->reset_steel_priority();
+    });
     break;
   case ACTION_DEFAULT_SETT_5_6:
     switch (box) {
       case TypeSett5:
-        player->reset_flag_priority();
+        interface->run_player_command([](Player *player_) {
+          player_->reset_flag_priority();
+        });
         break;
       case TypeSett6:
-        player->reset_inventory_priority();
+        interface->run_player_command([](Player *player_) {
+          player_->reset_inventory_priority();
+        });
         break;
       default:
         NOT_REACHED();
@@ -3402,7 +3507,9 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     set_box(TypeSett6);
     break;
   case ACTION_SETT_8_ADJUST_RATE:
-    player->set_serf_to_knight_rate(gui_get_slider_click_value(x_));
+    interface->run_player_command([x_](Player *player_) {
+      player_->set_serf_to_knight_rate(gui_get_slider_click_value(x_));
+    });
     break;
   case ACTION_SETT_8_TRAIN_1:
     sett_8_train(1);
@@ -3418,34 +3525,48 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
   case ACTION_DEFAULT_SETT_3:
     interface->open_popup(TypeSett3);
-    player->reset_coal_priority();
-    player->reset_wheat_priority();
+    interface->run_player_command([](Player *player_) {
+      player_->reset_coal_priority();
+      player_->reset_wheat_priority();
+    });
     break;
   case ACTION_SETT_8_SET_COMBAT_MODE_WEAK:
-    player->drop_send_strongest();
+    interface->run_player_command([](Player *player_) {
+      player_->drop_send_strongest();
+    });
     play_sound(Audio::TypeSfxAccepted);
     break;
   case ACTION_SETT_8_SET_COMBAT_MODE_STRONG:
-    player->set_send_strongest();
+    interface->run_player_command([](Player *player_) {
+      player_->set_send_strongest();
+    });
     play_sound(Audio::TypeSfxAccepted);
     break;
   case ACTION_ATTACKING_SELECT_ALL_1:
-    player->knights_attacking = player->attacking_knights[0];
+    interface->run_player_command([](Player *player_) {
+      player_->knights_attacking = player_->attacking_knights[0];
+    });
     break;
   case ACTION_ATTACKING_SELECT_ALL_2:
-    player->knights_attacking = player->attacking_knights[0]
-                                + player->attacking_knights[1];
+    interface->run_player_command([](Player *player_) {
+      player_->knights_attacking = player_->attacking_knights[0]
+                                   + player_->attacking_knights[1];
+    });
     break;
   case ACTION_ATTACKING_SELECT_ALL_3:
-    player->knights_attacking = player->attacking_knights[0]
-                                + player->attacking_knights[1]
-                                + player->attacking_knights[2];
+    interface->run_player_command([](Player *player_) {
+      player_->knights_attacking = player_->attacking_knights[0]
+                                   + player_->attacking_knights[1]
+                                   + player_->attacking_knights[2];
+    });
     break;
   case ACTION_ATTACKING_SELECT_ALL_4:
-    player->knights_attacking = player->attacking_knights[0]
-                                + player->attacking_knights[1]
-                                + player->attacking_knights[2]
-                                + player->attacking_knights[3];
+    interface->run_player_command([](Player *player_) {
+      player_->knights_attacking = player_->attacking_knights[0]
+                                   + player_->attacking_knights[1]
+                                   + player_->attacking_knights[2]
+                                   + player_->attacking_knights[3];
+    });
     break;
   case ACTION_MINIMAP_BLD_1:
   case ACTION_MINIMAP_BLD_2:
@@ -3489,7 +3610,9 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
   case ACTION_DEFAULT_SETT_4:
     interface->open_popup(TypeSett4);
-    player->reset_tool_priority();
+    interface->run_player_command([](Player *player_) {
+      player_->reset_tool_priority();
+    });
     break;
   case ACTION_SHOW_PLAYER_FACES:
     set_box(TypePlayerFaces);
@@ -3501,10 +3624,14 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
     break;
     /* TODO */
   case ACTION_SETT_8_CASTLE_DEF_DEC:
-    player->decrease_castle_knights_wanted();
+    interface->run_player_command([](Player *player_) {
+      player_->decrease_castle_knights_wanted();
+    });
     break;
   case ACTION_SETT_8_CASTLE_DEF_INC:
-    player->increase_castle_knights_wanted();
+    interface->run_player_command([](Player *player_) {
+      player_->increase_castle_knights_wanted();
+    });
     break;
   case ACTION_OPTIONS_MUSIC: {
     Audio &audio = Audio::get_instance();
@@ -3570,8 +3697,11 @@ PopupBox::handle_action(int action, int x_, int /*y_*/) {
       file_name += ".save";
     }
     std::string file_path = file_list->get_folder_path() + "/" + file_name;
-    if (GameStore::get_instance().save(file_path,
-                                       interface->get_game().get())) {
+    GameStore::PSnapshot snapshot;
+    GameManager::get_instance().run_command([&snapshot](Game *current) {
+      snapshot = GameStore::get_instance().snapshot(current);
+    });
+    if (GameStore::get_instance().save(file_path, snapshot)) {
       interface->close_popup();
     }
     break;
@@ -234,6 +234,7 @@ class PopupBox : public GuiObject {
   void draw_save_box();
   void activate_sett_5_6_item(int index);
   void move_sett_5_6_item(int up, int to_end);
+  static void move_prio_item(int *prio, int cur, int up, int to_end);
   void handle_send_geologist();
   void sett_8_train(int number);
   void set_inventory_resource_mode(int mode);
@@ -21,17 +21,205 @@
 
 #include "src/profiler.h"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <string>
 #include <istream>
+#include <thread>
+#include <vector>
 
 #include "src/command_line.h"
 #include "src/log.h"
 #include "src/version.h"
 #include "src/game-manager.h"
+#include "src/game.h"
+#include "src/batch-runner.h"
+#include "src/pathfinder.h"
+#include "src/thread-pool.h"
+
+/* Run a new game with one player on each map size from 3 to max_size and
+   report the time to generate the map, the memory and the update time per
+   tile. */
+static void
+benchmark_map_sizes(unsigned int max_size, unsigned int ticks,
+                    bool parallel_map) {
+  for (unsigned int size = 3; size <= max_size; size++) {
+    Game game;
+    auto generate_start = std::chrono::steady_clock::now();
+    game.init(size, Random("8667715887436237"), parallel_map);
+    std::chrono::duration<double, std::milli> generation =
+      std::chrono::steady_clock::now() - generate_start;
+    PMap map = game.get_map();
+
+    unsigned int index = game.add_player(20, 40, 30);
+    Player *player = game.get_player(index);
+    MapPos center = map->pos(map->get_cols() / 2, map->get_rows() / 2);
+    for (int i = 0; i < 295; i++) {
+      MapPos pos = map->pos_add_spirally(center, i);
+      if (game.build_castle(pos, player)) break;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < ticks; i++) game.update();
+    std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    double tiles = static_cast<double>(map->geom().tile_count());
+    Log::Info["profiler"] << "size " << size << ": "
+                          << map->get_cols() << "x" << map->get_rows()
+                          << " tiles, generated in " << generation.count()
+                          << " ms, "
+                          << map->get_memory_usage() / tiles << " bytes/tile, "
+                          << elapsed.count() / ticks / tiles
+                          << " ns/tick/tile";
+  }
+}
+
+/* Grow an economy around the castle of each player: every few hundred
+   ticks each player builds the next building of a fixed list, connected
+   to the castle flag by road. Returns the time spent updating. */
+static double
+run_growing_economy(Game *game, const std::vector<MapPos> &castles,
+                    unsigned int ticks) {
+  static const Building::Type types[] = {
+    Building::TypeLumberjack, Building::TypeForester,
+    Building::TypeStonecutter, Building::TypeSawmill, Building::TypeHut,
+    Building::TypeFisher, Building::TypeFarm, Building::TypeMill,
+    Building::TypeBaker, Building::TypeLumberjack, Building::TypeStock,
+    Building::TypeForester, Building::TypeTower
+  };
+  const unsigned int type_count = sizeof(types) / sizeof(types[0]);
+  PMap map = game->get_map();
+
+  std::chrono::duration<double, std::milli> elapsed(0);
+  for (unsigned int tick = 0; tick < ticks; tick++) {
+    if (tick % 300 == 10) {
+      for (unsigned int i = 0; i < castles.size(); i++) {
+        Player *player = game->get_player(i);
+        Building::Type type = types[(tick / 300) % type_count];
+        for (unsigned int offset = 7; offset < 295; offset++) {
+          MapPos pos = map->pos_add_spirally(castles[i], offset);
+          if (!game->can_build_building(pos, type, player) ||
+              !game->build_building(pos, type, player)) {
+            continue;
+          }
+          Road road = pathfinder_map(map.get(), map->move_down_right(pos),
+                                     map->move_down_right(castles[i]));
+          if (road.get_length() > 0 && game->build_road(road, player)) {
+            break;
+          }
+          game->demolish_building(pos, player);
+        }
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    game->update();
+    elapsed += std::chrono::steady_clock::now() - start;
+  }
+
+  return elapsed.count();
+}
+
+/* Run the same growing economy on a map of the given size with the serf
+   updates planned in parallel and without, and report the update time
+   of each. The two games must end in the same state. */
+static void
+benchmark_serf_planning(unsigned int size, unsigned int ticks,
+                        unsigned int threads) {
+  ThreadPool pool((threads > 1) ? threads - 1 : 0);
+  double elapsed[2];
+  uint64_t state_hash[2];
+  unsigned int committed = 0;
+  for (int planned = 0; planned < 2; planned++) {
+    Game game;
+    game.init(size, Random("8667715887436237"));
+    game.set_random(Random("1111222233334444"));
+    game.set_thread_pool(&pool);
+    game.set_serf_parallel_min(planned ? 1 : UINT_MAX);
+    PMap map = game.get_map();
+
+    std::vector<MapPos> castles;
+    for (unsigned int i = 0; i < GAME_MAX_PLAYER_COUNT; i++) {
+      unsigned int index = game.add_player(20, 40, 30);
+      Player *player = game.get_player(index);
+      MapPos center = map->pos(map->get_cols() / 4 +
+                               (i % 2) * map->get_cols() / 2,
+                               map->get_rows() / 4 +
+                               (i / 2) * map->get_rows() / 2);
+      for (unsigned int offset = 0; offset < 295; offset++) {
+        MapPos pos = map->pos_add_spirally(center, offset);
+        if (game.can_build_castle(pos, player) &&
+            game.build_castle(pos, player)) {
+          castles.push_back(pos);
+          break;
+        }
+      }
+      if (castles.size() <= i) {
+        Log::Warn["profiler"] << "no place for the castle of player " << i;
+        return;
+      }
+    }
+
+    elapsed[planned] = run_growing_economy(&game, castles, ticks);
+    state_hash[planned] = game.state_hash();
+    committed = game.get_committed_serf_plans();
+  }
+
+  Log::Info["profiler"] << "serf update on map size " << size << ": "
+                        << elapsed[0] / ticks << " ms/tick sequential, "
+                        << elapsed[1] / ticks << " ms/tick planned on "
+                        << pool.get_thread_count() + 1 << " threads ("
+                        << committed << " plans committed), state "
+                        << ((state_hash[0] == state_hash[1]) ?
+                            "the same" : "DIFFERS");
+}
+
+/* Run random games on a map of the given size from consecutive seeds, as
+   many at once as there are threads, and report each game and the overall
+   throughput. */
+static void
+run_batch(unsigned int games, unsigned int size, unsigned int ticks,
+          unsigned int threads, bool parallel_map) {
+  BatchRunner runner(ticks, threads);
+  for (unsigned int i = 0; i < games; i++) {
+    PGameInfo game_info(new GameInfo(Random(static_cast<uint16_t>(i + 1))));
+    game_info->set_map_size(size);
+    game_info->set_parallel_map(parallel_map);
+    runner.add_game(game_info);
+  }
+
+  std::vector<BatchRunner::GameSummary> summaries = runner.run();
+  for (const BatchRunner::GameSummary &summary : summaries) {
+    Log::Info["profiler"] << "game " << summary.name << ": "
+                          << summary.ticks << " ticks in "
+                          << summary.seconds << " s, state "
+                          << std::hex << summary.state_hash << std::dec;
+    for (size_t i = 0; i < summary.players.size(); i++) {
+      const BatchRunner::PlayerSummary &player = summary.players[i];
+      Log::Info["profiler"] << "  player " << i << ": land "
+                            << player.land_area << ", buildings "
+                            << player.building_score << ", military "
+                            << player.military_score << ", serfs "
+                            << player.serfs;
+    }
+  }
+  Log::Info["profiler"] << games << " games on " << threads << " threads: "
+                        << runner.get_elapsed() << " s, "
+                        << runner.get_ticks_per_second() << " ticks/s";
+}
 
 int
 main(int argc, char *argv[]) {
   std::string save_file;
+  unsigned int benchmark_size = 0;
+  unsigned int serf_benchmark_size = 0;
+  unsigned int batch_games = 0;
+  unsigned int batch_size = 3;
+  unsigned int batch_ticks = 5000;
+  unsigned int batch_threads = std::thread::hardware_concurrency();
+  bool parallel_map = false;
 
   CommandLine command_line;
   command_line.add_option('h', "Show this help text", [&command_line](){
@@ -43,13 +231,66 @@ main(int argc, char *argv[]) {
                   std::getline(s, save_file);
                   return true;
                 });
+  command_line.add_option('b', "Benchmark map sizes up to SIZE")
+                .add_parameter("SIZE", [&benchmark_size](std::istream& s) {
+                  s >> benchmark_size;
+                  return true;
+                });
+  command_line.add_option('u', "Benchmark serf update planning on map SIZE")
+                .add_parameter("SIZE", [&serf_benchmark_size](std::istream& s) {
+                  s >> serf_benchmark_size;
+                  return true;
+                });
+  command_line.add_option('k', "Run GAMES random games at once")
+                .add_parameter("GAMES", [&batch_games](std::istream& s) {
+                  s >> batch_games;
+                  return true;
+                });
+  command_line.add_option('s', "Map SIZE of the random games")
+                .add_parameter("SIZE", [&batch_size](std::istream& s) {
+                  s >> batch_size;
+                  return true;
+                });
+  command_line.add_option('t', "Run each random game for TICKS ticks")
+                .add_parameter("TICKS", [&batch_ticks](std::istream& s) {
+                  s >> batch_ticks;
+                  return true;
+                });
+  command_line.add_option('j', "Run the random games on THREADS threads")
+                .add_parameter("THREADS", [&batch_threads](std::istream& s) {
+                  s >> batch_threads;
+                  return true;
+                });
+  command_line.add_option('p', "Generate maps with the parallel generator",
+                          [&parallel_map](){
+                  parallel_map = true;
+                });
   command_line.set_comment("Please report bugs to <" PACKAGE_BUGREPORT ">");
-  if (!command_line.process(argc, argv) || save_file.empty()) {
+  if (!command_line.process(argc, argv) ||
+      (save_file.empty() && benchmark_size == 0 && batch_games == 0 &&
+       serf_benchmark_size == 0)) {
     return EXIT_FAILURE;
   }
 
   Log::Info["profiler"] << "starts " << FREESERF_VERSION;
 
+  if (benchmark_size > 0) {
+    benchmark_map_sizes(benchmark_size, 500, parallel_map);
+    return EXIT_SUCCESS;
+  }
+
+  if (serf_benchmark_size > 0) {
+    benchmark_serf_planning(serf_benchmark_size, batch_ticks,
+                            std::max(batch_threads, 1u));
+    return EXIT_SUCCESS;
+  }
+
+  if (batch_games > 0) {
+    run_batch(batch_games, batch_size, batch_ticks,
+              std::max(batch_threads, 1u), parallel_map);
+    return EXIT_SUCCESS;
+  }
+
   GameManager &game_manager = GameManager::get_instance();
 
   if (!game_manager.load_game(save_file)) {
@@ -57,6 +298,9 @@ main(int argc, char *argv[]) {
   }
   Log::Info["profiler"] << "loaded game '" << save_file << "'";
 
+  /* Update the game here as fast as it goes. */
+  game_manager.stop_simulation();
+
   PGame game = game_manager.get_current_game();
   while (true) {
     game->update();
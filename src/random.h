@@ -44,6 +44,11 @@ class Random {
   }
 
   uint16_t random();
+  /* The generator state packed into an integer. */
+  uint64_t get_state() const {
+    return (static_cast<uint64_t>(state[0]) << 32) |
+           (static_cast<uint64_t>(state[1]) << 16) | state[2];
+  }
 
   operator std::string() const;
   friend Random& operator^=(Random& left, const Random& right);
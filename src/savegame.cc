@@ -27,6 +27,7 @@
 #include <fstream>
 #include <iostream>
 #include <array>
+#include <cstdio>
 #include <ctime>
 #include <utility>
 #include <algorithm>
@@ -120,6 +121,11 @@ class SaveWriterTextSection : public SaveWriterText {
   }
 };
 
+class GameStore::Snapshot : public SaveWriterTextSection {
+ public:
+  Snapshot() : SaveWriterTextSection("game", 0) {}
+};
+
 typedef std::map<std::string, SaveReaderTextValue> Values;
 
 class SaveReaderTextSection : public SaveReaderText {
@@ -412,9 +418,7 @@ SaveWriterTextValue::operator << (int val) {
     value += ",";
   }
 
-  std::ostringstream ss;
-  ss << val;
-  value += ss.str();
+  value += std::to_string(val);
 
   return *this;
 }
@@ -425,9 +429,7 @@ SaveWriterTextValue::operator << (unsigned int val) {
     value += ",";
   }
 
-  std::ostringstream ss;
-  ss << val;
-  value += ss.str();
+  value += std::to_string(val);
 
   return *this;
 }
@@ -438,9 +440,7 @@ SaveWriterTextValue::operator << (Direction val) {
     value += ",";
   }
 
-  std::ostringstream ss;
-  ss << static_cast<int>(val);
-  value += ss.str();
+  value += std::to_string(static_cast<int>(val));
 
   return *this;
 }
@@ -451,9 +451,7 @@ SaveWriterTextValue::operator << (Resource::Type val) {
     value += ",";
   }
 
-  std::ostringstream ss;
-  ss << static_cast<int>(val);
-  value += ss.str();
+  value += std::to_string(static_cast<int>(val));
 
   return *this;
 }
@@ -471,7 +469,11 @@ SaveWriterTextValue::operator << (const std::string &val) {
 
 // SaveGame
 
-GameStore::GameStore() {
+GameStore::GameStore()
+  : writing(false)
+  , writer_stopping(false)
+  , mapped_tiles(false)
+  , mapped_count(0) {
   folder_path = ".";
 
 #ifdef _WIN32
@@ -516,6 +518,14 @@ GameStore::GameStore() {
 }
 
 GameStore::~GameStore() {
+  if (writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(writer_mutex);
+      writer_stopping = true;
+    }
+    writer_wakeup.notify_all();
+    writer.join();
+  }
 }
 
 GameStore &
@@ -779,7 +789,13 @@ GameStore::quick_save(const std::string &prefix, Game *game) {
   std::string path = save_game.get_folder_path();
   path += "/" + prefix + "-" + name + ".save";
 
-  return save(path, game);
+  PSnapshot state = snapshot(game);
+  if (!state) {
+    return false;
+  }
+  save_in_background(path, state);
+
+  return true;
 }
 
 // In target, replace any character from needle with replacement character.
@@ -802,15 +818,121 @@ strreplace(const std::string &src, const std::string &needle, char replace) {
 
 bool
 GameStore::save(const std::string &path, Game *game) {
+  return save(path, snapshot(game));
+}
+
+bool
+GameStore::map_tiles(Game *game) {
+  PMap map = game->get_map();
+  if (!mapped_tiles || map->is_mapped()) {
+    return true;
+  }
+
+  std::string path = folder_path + "/tiles-" + std::to_string(time(NULL)) +
+                     "-" + std::to_string(mapped_count++);
+  if (!map->map_tiles(path)) {
+    Log::Warn["savegame"] << "Failed to map tiles to " << path;
+    return false;
+  }
+
+  return true;
+}
+
+GameStore::PSnapshot
+GameStore::snapshot(Game *game) {
+  /* Saves only refer to mapped tiles, so their files must hold the tiles
+     as captured here. */
+  PMap map = game->get_map();
+  if (map->is_mapped() && !map->sync_tiles()) {
+    Log::Warn["savegame"] << "Failed to sync tiles to "
+                          << map->get_tiles_path();
+    return nullptr;
+  }
+
+  PSnapshot state = std::make_shared<Snapshot>();
+  *state << *game;
+  return state;
+}
+
+bool
+GameStore::save(const std::string &path, PSnapshot snapshot) {
   /* Substitute problematic characters. These are problematic
    particularly on windows platforms, but also in general on FAT
    filesystems through any platform. */
   /* TODO Possibly use PathCleanupSpec() when building for windows platform. */
+  if (!snapshot) {
+    return false;
+  }
+
   std::string file_path = strreplace(path, "*?\"<>|", '_');
 
-  SaveWriterTextSection writer("game", 0);
-  writer << *game;
-  return writer.save(file_path);
+  return snapshot->save(file_path);
+}
+
+void
+GameStore::save_in_background(const std::string &path, PSnapshot snapshot) {
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    if (!writer.joinable()) {
+      writer = std::thread(&GameStore::write_saves, this);
+    }
+
+    bool replaced = false;
+    for (PendingSave &pending : pending_saves) {
+      if (pending.first == path) {
+        pending.second = snapshot;
+        replaced = true;
+      }
+    }
+    if (!replaced) {
+      pending_saves.push_back(PendingSave(path, snapshot));
+    }
+  }
+  writer_wakeup.notify_all();
+}
+
+void
+GameStore::wait_for_saves() {
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  writer_wakeup.wait(lock, [this]() {
+    return pending_saves.empty() && !writing;
+  });
+}
+
+void
+GameStore::write_saves() {
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  while (true) {
+    writer_wakeup.wait(lock, [this]() {
+      return writer_stopping || !pending_saves.empty();
+    });
+    if (pending_saves.empty()) {
+      return;
+    }
+
+    PendingSave pending = pending_saves.front();
+    pending_saves.pop_front();
+    writing = true;
+    lock.unlock();
+
+    std::string file_path = strreplace(pending.first, "*?\"<>|", '_');
+    std::string temp_path = file_path + ".tmp";
+    bool saved = pending.second->save(temp_path);
+    if (saved) {
+#ifdef _WIN32
+      std::remove(file_path.c_str());
+#endif
+      saved = (std::rename(temp_path.c_str(), file_path.c_str()) == 0);
+    }
+    if (!saved) {
+      Log::Warn["savegame"] << "Failed to write " << file_path;
+      std::remove(temp_path.c_str());
+    }
+
+    lock.lock();
+    writing = false;
+    writer_wakeup.notify_all();
+  }
 }
 
 bool
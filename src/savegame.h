@@ -22,12 +22,17 @@
 #ifndef SRC_SAVEGAME_H_
 #define SRC_SAVEGAME_H_
 
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <string>
 #include <list>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <utility>
 
 #include "src/map.h"
 #include "src/resource.h"
@@ -98,9 +103,7 @@ class SaveWriterTextValue {
       if (!value.empty()) {
         value += ",";
       }
-      std::ostringstream ss;
-      ss << val;
-      value += ss.str();
+      value += std::to_string(val);
 
       return *this;
     }
@@ -149,12 +152,28 @@ class GameStore {
     Type type;
   };
 
+  /* State of a game captured between two ticks. Capturing is the only step
+     of saving that needs the game; formatting and writing the file can be
+     left to another thread. */
+  class Snapshot;
+  typedef std::shared_ptr<Snapshot> PSnapshot;
+
  protected:
   GameStore();
 
   std::string folder_path;
   std::vector<SaveInfo> saved_games;
 
+  typedef std::pair<std::string, PSnapshot> PendingSave;
+  std::thread writer;
+  std::mutex writer_mutex;
+  std::condition_variable writer_wakeup;
+  std::deque<PendingSave> pending_saves;
+  bool writing;
+  bool writer_stopping;
+  bool mapped_tiles;
+  unsigned int mapped_count;
+
  public:
   virtual ~GameStore();
 
@@ -165,12 +184,39 @@ class GameStore {
   bool is_folder_exists(const std::string &path);
   const std::vector<SaveInfo> &get_saved_games();
 
+  /* With mapped tiles the tiles of each game are kept in files in the save
+     folder. Saves then refer to these files, which are synced when the game
+     is captured, instead of holding the tiles themselves. As the files
+     follow the game, such a save can only be loaded until the game changes
+     its tiles again; loading an older one fails. */
+  void set_mapped_tiles(bool mapped) { mapped_tiles = mapped; }
+  bool get_mapped_tiles() const { return mapped_tiles; }
+  /* Move the tiles of a new game to files of their own if mapped tiles are
+     enabled. Returns false if they are enabled but the tiles stay on the
+     heap. */
+  bool map_tiles(Game *game);
+
   /* Generic save/load function that will try to detect the right
    format on load and save to the best format on write. */
   bool save(const std::string &path, Game *game);
   bool load(const std::string &path, Game *game);
+  /* Save the game under a new name made from prefix and the time. Returns
+     once the game is captured; the file is written in the background, and
+     a failure to write it is only logged. */
   bool quick_save(const std::string &prefix, Game *game);
 
+  PSnapshot snapshot(Game *game);
+  bool save(const std::string &path, PSnapshot snapshot);
+
+  /* Write the snapshot on the background writer. A snapshot still waiting
+     for the same path is replaced. The file is written under a temporary
+     name first, so an earlier save is kept intact until the new one is
+     complete. */
+  void save_in_background(const std::string &path, PSnapshot snapshot);
+  /* Wait until every snapshot handed to the background writer is
+     written. */
+  void wait_for_saves();
+
   bool read(std::istream *is, Game *game);
   bool write(std::ostream *os, Game *game);
 
@@ -181,6 +227,7 @@ class GameStore {
   void find_regular();
   std::string name_from_file(const std::string &file_name);
   bool is_file_exists(const std::string &path);
+  void write_saves();
 };
 
 #endif  // SRC_SAVEGAME_H_
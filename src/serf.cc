@@ -39,6 +39,7 @@
                        << "state " << Serf::get_state_name(state) \
                        << " -> " << Serf::get_state_name((new_state)) \
                        << " (" << __FUNCTION__ << ":" << __LINE__ << ")"; \
+  game->wake_serf(index); \
   state = new_state;
 
 #define set_other_state(other_serf, new_state)  \
@@ -48,6 +49,7 @@
                        << Serf::get_state_name(other_serf->state) \
                        << " -> " << Serf::get_state_name((new_state)) \
                        << "(" << __FUNCTION__ << ":" << __LINE__ << ")"; \
+  game->wake_serf(other_serf->index); \
   other_serf->state = new_state;
 
 
@@ -299,6 +301,210 @@ Serf::Serf(Game *game, unsigned int index) : GameObject(game, index) {
   pos = -1;
   tick = 0;
   s = { { 0 } };
+
+  game->wake_serf(index);
+}
+
+uint64_t
+Serf::get_state_hash() const {
+  uint64_t hash = hash_combine(0, get_index());
+  hash = hash_combine(hash, owner);
+  hash = hash_combine(hash, type);
+  hash = hash_combine(hash, state);
+  hash = hash_combine(hash, animation);
+  hash = hash_combine(hash, get_counter());
+  hash = hash_combine(hash, pos);
+  hash = hash_combine(hash, static_cast<uint16_t>(tick + pending_ticks()));
+
+  /* The state data that is in use, as written to save games. */
+  switch (state) {
+    case StateIdleInStock:
+      hash = hash_combine(hash, s.idle_in_stock.inv_index);
+      break;
+
+    case StateWalking:
+      hash = hash_combine(hash, s.walking.dir1);
+      hash = hash_combine(hash, s.walking.dest);
+      hash = hash_combine(hash, s.walking.dir);
+      hash = hash_combine(hash, s.walking.wait_counter);
+      break;
+
+    case StateTransporting:
+    case StateDelivering:
+      hash = hash_combine(hash, s.transporting.res);
+      hash = hash_combine(hash, s.transporting.dest);
+      hash = hash_combine(hash, s.transporting.dir);
+      hash = hash_combine(hash, s.transporting.wait_counter);
+      break;
+
+    case StateEnteringBuilding:
+      hash = hash_combine(hash, s.entering_building.field_B);
+      hash = hash_combine(hash, s.entering_building.slope_len);
+      break;
+
+    case StateLeavingBuilding:
+    case StateReadyToLeave:
+    case StateKnightLeaveForFight:
+      hash = hash_combine(hash, s.leaving_building.field_B);
+      hash = hash_combine(hash, s.leaving_building.dest);
+      hash = hash_combine(hash, s.leaving_building.dest2);
+      hash = hash_combine(hash, s.leaving_building.dir);
+      hash = hash_combine(hash, s.leaving_building.next_state);
+      break;
+
+    case StateReadyToEnter:
+      hash = hash_combine(hash, s.ready_to_enter.field_B);
+      break;
+
+    case StateDigging:
+      hash = hash_combine(hash, s.digging.h_index);
+      hash = hash_combine(hash, s.digging.target_h);
+      hash = hash_combine(hash, s.digging.dig_pos);
+      hash = hash_combine(hash, s.digging.substate);
+      break;
+
+    case StateBuilding:
+      hash = hash_combine(hash, s.building.mode);
+      hash = hash_combine(hash, s.building.bld_index);
+      hash = hash_combine(hash, s.building.material_step);
+      hash = hash_combine(hash, s.building.counter);
+      break;
+
+    case StateBuildingCastle:
+      hash = hash_combine(hash, s.building_castle.inv_index);
+      break;
+
+    case StateMoveResourceOut:
+    case StateDropResourceOut:
+      hash = hash_combine(hash, s.move_resource_out.res);
+      hash = hash_combine(hash, s.move_resource_out.res_dest);
+      hash = hash_combine(hash, s.move_resource_out.next_state);
+      break;
+
+    case StateReadyToLeaveInventory:
+      hash = hash_combine(hash, s.ready_to_leave_inventory.mode);
+      hash = hash_combine(hash, s.ready_to_leave_inventory.dest);
+      hash = hash_combine(hash, s.ready_to_leave_inventory.inv_index);
+      break;
+
+    case StateFreeWalking:
+    case StateLogging:
+    case StatePlanting:
+    case StateStoneCutting:
+    case StateStoneCutterFreeWalking:
+    case StateFishing:
+    case StateFarming:
+    case StateSamplingGeoSpot:
+    case StateKnightFreeWalking:
+    case StateKnightAttackingFree:
+    case StateKnightAttackingFreeWait:
+      hash = hash_combine(hash, s.free_walking.dist_col);
+      hash = hash_combine(hash, s.free_walking.dist_row);
+      hash = hash_combine(hash, s.free_walking.neg_dist1);
+      hash = hash_combine(hash, s.free_walking.neg_dist2);
+      hash = hash_combine(hash, s.free_walking.flags);
+      break;
+
+    case StateSawing:
+      hash = hash_combine(hash, s.sawing.mode);
+      break;
+
+    case StateLost:
+      hash = hash_combine(hash, s.lost.field_B);
+      break;
+
+    case StateMining:
+      hash = hash_combine(hash, s.mining.substate);
+      hash = hash_combine(hash, s.mining.res);
+      hash = hash_combine(hash, s.mining.deposit);
+      break;
+
+    case StateSmelting:
+      hash = hash_combine(hash, s.smelting.mode);
+      hash = hash_combine(hash, s.smelting.counter);
+      hash = hash_combine(hash, s.smelting.type);
+      break;
+
+    case StateMilling:
+      hash = hash_combine(hash, s.milling.mode);
+      break;
+
+    case StateBaking:
+      hash = hash_combine(hash, s.baking.mode);
+      break;
+
+    case StatePigFarming:
+      hash = hash_combine(hash, s.pigfarming.mode);
+      break;
+
+    case StateButchering:
+      hash = hash_combine(hash, s.butchering.mode);
+      break;
+
+    case StateMakingWeapon:
+      hash = hash_combine(hash, s.making_weapon.mode);
+      break;
+
+    case StateMakingTool:
+      hash = hash_combine(hash, s.making_tool.mode);
+      break;
+
+    case StateBuildingBoat:
+      hash = hash_combine(hash, s.building_boat.mode);
+      break;
+
+    case StateKnightEngagingBuilding:
+    case StateKnightPrepareAttacking:
+    case StateKnightPrepareDefendingFreeWait:
+    case StateKnightAttackingDefeatFree:
+    case StateKnightAttacking:
+    case StateKnightAttackingVictory:
+    case StateKnightEngageAttackingFree:
+    case StateKnightEngageAttackingFreeJoin:
+    case StateKnightAttackingVictoryFree:
+      hash = hash_combine(hash, s.attacking.move);
+      hash = hash_combine(hash, s.attacking.attacker_won);
+      hash = hash_combine(hash, s.attacking.field_D);
+      hash = hash_combine(hash, s.attacking.def_index);
+      break;
+
+    case StateKnightDefendingFree:
+    case StateKnightEngageDefendingFree:
+      hash = hash_combine(hash, s.defending_free.dist_col);
+      hash = hash_combine(hash, s.defending_free.dist_row);
+      hash = hash_combine(hash, s.defending_free.field_D);
+      hash = hash_combine(hash, s.defending_free.other_dist_col);
+      hash = hash_combine(hash, s.defending_free.other_dist_row);
+      break;
+
+    case StateKnightLeaveForWalkToFight:
+      hash = hash_combine(hash, s.leave_for_walk_to_fight.dist_col);
+      hash = hash_combine(hash, s.leave_for_walk_to_fight.dist_row);
+      hash = hash_combine(hash, s.leave_for_walk_to_fight.field_D);
+      hash = hash_combine(hash, s.leave_for_walk_to_fight.field_E);
+      hash = hash_combine(hash, s.leave_for_walk_to_fight.next_state);
+      break;
+
+    case StateIdleOnPath:
+    case StateWaitIdleOnPath:
+    case StateWakeAtFlag:
+    case StateWakeOnPath:
+      hash = hash_combine(hash, s.idle_on_path.rev_dir);
+      hash = hash_combine(hash, s.idle_on_path.flag);
+      hash = hash_combine(hash, s.idle_on_path.field_E);
+      break;
+
+    case StateDefendingHut:
+    case StateDefendingTower:
+    case StateDefendingFortress:
+    case StateDefendingCastle:
+      hash = hash_combine(hash, s.defending.next_knight);
+      break;
+
+    default: break;
+  }
+
+  return hash;
 }
 
 /* Change type of serf and update all global tables
@@ -309,6 +515,10 @@ Serf::set_type(Serf::Type new_type) {
     return;
   }
 
+  /* Whether the serf can sleep depends on its type, as for a knight that
+     has finished training, so let it catch up under the old type. */
+  game->wake_serf(index);
+
   Serf::Type old_type = type;
   type = new_type;
 
@@ -583,6 +793,9 @@ Serf::building_deleted(MapPos building_pos, bool escape) {
 
 void
 Serf::castle_deleted(MapPos castle_pos, bool transporter) {
+  /* Wake before the counter is reset, not at the state change. */
+  game->wake_serf(index);
+
   if ((!transporter || (get_type() == TypeTransporterInventory)) &&
       pos == castle_pos) {
     if (transporter) {
@@ -2603,9 +2816,10 @@ Serf::handle_serf_free_walking_switch_with_other() {
   Direction dir = DirectionNone;
   Serf *other_serf = NULL;
   PMap map = game->get_map();
+  unsigned int occupied_dirs = map->get_occupied_dirs(pos);
   for (Direction i : cycle_directions_cw()) {
-    new_pos = map->move(pos, i);
-    if (map->has_serf(new_pos)) {
+    if (BIT_TEST(occupied_dirs, i)) {
+      new_pos = map->move(pos, i);
       other_serf = game->get_serf_at_pos(new_pos);
       Direction other_dir;
 
@@ -2753,12 +2967,9 @@ Serf::handle_free_walking_follow_edge() {
   const Direction *a0 = &dir_arr[6*dir_index];
   Direction i0 = DirectionNone;
   Direction dir = DirectionNone;
-  PMap map = game->get_map();
+  unsigned int free_dirs = game->get_map()->get_free_dirs(pos, water);
   for (Direction i : cycle_directions_cw()) {
-    MapPos new_pos = map->move(pos, a0[i]);
-    if (((water && map->get_obj(new_pos) == 0) ||
-         (!water && !map->is_in_water(new_pos) &&
-          can_pass_map_pos(new_pos))) && !map->has_serf(new_pos)) {
+    if (BIT_TEST(free_dirs, a0[i])) {
       dir = a0[i];
       i0 = i;
       break;
@@ -2791,72 +3002,50 @@ Serf::handle_free_walking_follow_edge() {
   return -1;
 }
 
-void
-Serf::handle_free_walking_common() {
-  const Direction dir_from_offset[] = {
-    DirectionUpLeft, DirectionUp,   DirectionNone,
-    DirectionLeft,   DirectionNone, DirectionRight,
-    DirectionNone,   DirectionDown, DirectionDownRight
-  };
-
-  /* Directions for moving forwards. Each of the 12 lines represents
-     a general direction as shown in the diagram below.
-     The lines list the local directions in order of preference for that
-     general direction.
-
-     *         1    0
-     *    2   ________   11
-     *       /\      /\
-     *      /  \    /  \
-     *  3  /    \  /    \  10
-     *    /______\/______\
-     *    \      /\      /
-     *  4  \    /  \    /  9
-     *      \  /    \  /
-     *       \/______\/
-     *    5             8
-     *         6    7
-     */
-  const Direction dir_forward[] = {
-    DirectionUp, DirectionUpLeft, DirectionRight, DirectionLeft,
-    DirectionDownRight, DirectionDown, DirectionUpLeft, DirectionUp,
-    DirectionLeft, DirectionRight, DirectionDown, DirectionDownRight,
-    DirectionUpLeft, DirectionLeft, DirectionUp, DirectionDown, DirectionRight,
-    DirectionDownRight, DirectionLeft, DirectionUpLeft, DirectionDown,
-    DirectionUp, DirectionDownRight, DirectionRight, DirectionLeft,
-    DirectionDown, DirectionUpLeft, DirectionDownRight, DirectionUp,
-    DirectionRight, DirectionDown, DirectionLeft, DirectionDownRight,
-    DirectionUpLeft, DirectionRight, DirectionUp, DirectionDown,
-    DirectionDownRight, DirectionLeft, DirectionRight, DirectionUpLeft,
-    DirectionUp, DirectionDownRight, DirectionDown, DirectionRight,
-    DirectionLeft, DirectionUp, DirectionUpLeft, DirectionDownRight,
-    DirectionRight, DirectionDown, DirectionUp, DirectionLeft, DirectionUpLeft,
-    DirectionRight, DirectionDownRight, DirectionUp, DirectionDown,
-    DirectionUpLeft, DirectionLeft, DirectionRight, DirectionUp,
-    DirectionDownRight, DirectionUpLeft, DirectionDown, DirectionLeft,
-    DirectionUp, DirectionRight, DirectionUpLeft, DirectionDownRight,
-    DirectionLeft, DirectionDown
-  };
-
-  int water = (state == StateFreeSailing);
-
-  if (BIT_TEST(s.free_walking.flags, 3) &&
-      (s.free_walking.flags & 7) == 0) {
-    /* Destination reached */
-    handle_serf_free_walking_state_dest_reached();
-    return;
-  }
-
-  if ((s.free_walking.flags & 7) != 0) {
-    /* Obstacle encountered, follow along the edge */
-    int r = handle_free_walking_follow_edge();
-    if (r >= 0) return;
-  }
+/* Directions for moving forwards. Each of the 12 lines represents
+   a general direction as shown in the diagram below.
+   The lines list the local directions in order of preference for that
+   general direction.
+
+   *         1    0
+   *    2   ________   11
+   *       /\      /\
+   *      /  \    /  \
+   *  3  /    \  /    \  10
+   *    /______\/______\
+   *    \      /\      /
+   *  4  \    /  \    /  9
+   *      \  /    \  /
+   *       \/______\/
+   *    5             8
+   *         6    7
+   */
+static const Direction free_walking_dir_forward[] = {
+  DirectionUp, DirectionUpLeft, DirectionRight, DirectionLeft,
+  DirectionDownRight, DirectionDown, DirectionUpLeft, DirectionUp,
+  DirectionLeft, DirectionRight, DirectionDown, DirectionDownRight,
+  DirectionUpLeft, DirectionLeft, DirectionUp, DirectionDown, DirectionRight,
+  DirectionDownRight, DirectionLeft, DirectionUpLeft, DirectionDown,
+  DirectionUp, DirectionDownRight, DirectionRight, DirectionLeft,
+  DirectionDown, DirectionUpLeft, DirectionDownRight, DirectionUp,
+  DirectionRight, DirectionDown, DirectionLeft, DirectionDownRight,
+  DirectionUpLeft, DirectionRight, DirectionUp, DirectionDown,
+  DirectionDownRight, DirectionLeft, DirectionRight, DirectionUpLeft,
+  DirectionUp, DirectionDownRight, DirectionDown, DirectionRight,
+  DirectionLeft, DirectionUp, DirectionUpLeft, DirectionDownRight,
+  DirectionRight, DirectionDown, DirectionUp, DirectionLeft, DirectionUpLeft,
+  DirectionRight, DirectionDownRight, DirectionUp, DirectionDown,
+  DirectionUpLeft, DirectionLeft, DirectionRight, DirectionUp,
+  DirectionDownRight, DirectionUpLeft, DirectionDown, DirectionLeft,
+  DirectionUp, DirectionRight, DirectionUpLeft, DirectionDownRight,
+  DirectionLeft, DirectionDown
+};
 
-  /* Move fowards */
+/* General direction, as in the diagram above, of a destination at the
+   given offset. */
+static int
+free_walking_dir_index(int d1, int d2) {
   int dir_index = -1;
-  int d1 = s.free_walking.dist_col;
-  int d2 = s.free_walking.dist_row;
   if (d1 < 0) {
     if (d2 < 0) {
       if (-d2 < -d1) {
@@ -2903,15 +3092,43 @@ Serf::handle_free_walking_common() {
     }
   }
 
+  return dir_index;
+}
+
+void
+Serf::handle_free_walking_common() {
+  const Direction dir_from_offset[] = {
+    DirectionUpLeft, DirectionUp,   DirectionNone,
+    DirectionLeft,   DirectionNone, DirectionRight,
+    DirectionNone,   DirectionDown, DirectionDownRight
+  };
+
+  int water = (state == StateFreeSailing);
+
+  if (BIT_TEST(s.free_walking.flags, 3) &&
+      (s.free_walking.flags & 7) == 0) {
+    /* Destination reached */
+    handle_serf_free_walking_state_dest_reached();
+    return;
+  }
+
+  if ((s.free_walking.flags & 7) != 0) {
+    /* Obstacle encountered, follow along the edge */
+    int r = handle_free_walking_follow_edge();
+    if (r >= 0) return;
+  }
+
+  /* Move fowards */
+  int d1 = s.free_walking.dist_col;
+  int d2 = s.free_walking.dist_row;
+  int dir_index = free_walking_dir_index(d1, d2);
+
   /* Try to move directly in the preferred direction */
-  const Direction *a0 = &dir_forward[6*dir_index];
+  const Direction *a0 = &free_walking_dir_forward[6*dir_index];
   Direction dir = (Direction)a0[0];
   PMap map = game->get_map();
-  MapPos new_pos = map->move(pos, dir);
-  if (((water && map->get_obj(new_pos) == 0) ||
-       (!water && !map->is_in_water(new_pos) &&
-        can_pass_map_pos(new_pos))) &&
-      !map->has_serf(new_pos)) {
+  unsigned int free_dirs = map->get_free_dirs(pos, water);
+  if (BIT_TEST(free_dirs, dir)) {
     handle_serf_free_walking_switch_on_dir(dir);
     return;
   }
@@ -2997,10 +3214,7 @@ Serf::handle_free_walking_common() {
   Direction i0 = DirectionNone;
   for (int i = 0; i < 5; i++) {
     dir = a0[1+i];
-    MapPos new_pos = map->move(pos, dir);
-    if (((water && map->get_obj(new_pos) == 0) ||
-         (!water && !map->is_in_water(new_pos) &&
-          can_pass_map_pos(new_pos))) && !map->has_serf(new_pos)) {
+    if (BIT_TEST(free_dirs, dir)) {
       i0 = (Direction)i;
       break;
     }
@@ -5306,6 +5520,228 @@ Serf::update() {
   }
 }
 
+/* Whether the handler of the current state only counts down the
+   counter, up to the point where it runs out. */
+bool
+Serf::counts_down() const {
+  switch (state) {
+  case StatePlanningLogging:
+  case StatePlanningPlanting:
+  case StatePlanningStoneCutting:
+  case StatePlanningFishing:
+  case StatePlanningFarming:
+    return true;
+  case StateSawing:
+    return (s.sawing.mode != 0);
+  case StateSmelting:
+    return (s.smelting.mode != 0);
+  case StateMilling:
+    return (s.milling.mode != 0);
+  case StateBaking:
+    return (s.baking.mode != 0);
+  case StatePigFarming:
+    return (s.pigfarming.mode != 0);
+  case StateButchering:
+    return (s.butchering.mode != 0);
+  case StateMakingWeapon:
+    return (s.making_weapon.mode != 0);
+  case StateMakingTool:
+    return (s.making_tool.mode != 0);
+  case StateBuildingBoat:
+    return (s.building_boat.mode != 0);
+  case StateDefendingHut:
+  case StateDefendingTower:
+  case StateDefendingFortress:
+  case StateDefendingCastle:
+    /* Knights train until they reach the top level. */
+    return (get_type() != TypeKnight4);
+  default:
+    return false;
+  }
+}
+
+/* Number of ticks the serf can sleep before its update does more than
+   count down, 0 if it needs every update and -1 if it waits for other
+   serfs to change its state. The sleep is kept well below the range of
+   the 16 bit tick so the count skipped is never ambiguous. */
+int
+Serf::get_idle_ticks() const {
+  switch (state) {
+  case StateNull:
+  case StateKnightPrepareDefendingFreeWait:
+    return -1;
+  case StateDefendingHut:
+  case StateDefendingTower:
+  case StateDefendingFortress:
+  case StateDefendingCastle:
+    if (get_type() == TypeKnight4) return -1;
+    break;
+  default:
+    break;
+  }
+
+  if (!counts_down() || counter < 0) return 0;
+
+  /* Farming is planned when the counter reaches zero, the others act
+     once it goes below. */
+  int ticks = (state == StatePlanningFarming) ? counter : counter + 1;
+  return std::min(ticks, 0x4000);
+}
+
+/* Count down the ticks skipped while asleep, as the updates up to the
+   given tick would have done. */
+void
+Serf::catch_up(unsigned int last_tick) {
+  if (!counts_down()) return;
+
+  uint16_t delta = last_tick - tick;
+  tick = last_tick;
+  counter -= delta;
+}
+
+/* Ticks skipped so far by the serf while asleep. */
+int
+Serf::pending_ticks() const {
+  if (!counts_down() || !game->is_serf_asleep(index)) return 0;
+  return static_cast<uint16_t>(game->get_serf_update_tick(index) - tick);
+}
+
+int
+Serf::get_counter() const {
+  return counter - pending_ticks();
+}
+
+/* Plan the coming update. Only the serf and the map are read, so the
+   serfs can be planned in parallel while nothing else runs. */
+void
+Serf::plan_update(const Map &map, Intent *intent) const {
+  intent->type = IntentNone;
+
+  switch (state) {
+  case StateWalking:
+  case StateTransporting:
+  case StateLeavingBuilding:
+  case StateDelivering:
+  case StateFreeWalking:
+  case StateLogging:
+  case StatePlanningLogging:
+  case StatePlanningPlanting:
+  case StatePlanting:
+  case StatePlanningStoneCutting:
+  case StateStoneCutterFreeWalking:
+  case StateLost:
+  case StateLostSailor:
+  case StateFreeSailing:
+  case StateMining:
+  case StatePlanningFishing:
+  case StateFishing:
+  case StateFarming:
+  case StateSamplingGeoSpot:
+  case StateKnightEngagingBuilding:
+  case StateKnightAttackingDefeat:
+  case StateKnightFreeWalking:
+  case StateKnightEngageAttackingFree:
+  case StateKnightEngageAttackingFreeJoin:
+  case StateKnightPrepareDefendingFree:
+  case StateKnightAttackingDefeatFree:
+  case StateKnightAttackingFreeWait:
+    break;
+  default:
+    return;
+  }
+
+  intent->state = state;
+  intent->tick = tick;
+  intent->counter = counter;
+  intent->pos = pos;
+  uint16_t delta = game->get_tick() - tick;
+  intent->next_counter = counter - delta;
+
+  /* The handlers of these states do nothing but count down until the
+     counter goes below zero. */
+  if (intent->next_counter >= 0) {
+    intent->type = IntentCountdown;
+    return;
+  }
+
+  if (state == StateWalking && s.walking.dir >= 0 && !map.has_flag(pos)) {
+    /* Follow the road on to the next position. */
+    unsigned int paths = map.paths(pos);
+    unsigned int next = paths & ~BIT(s.walking.dir);
+    for (Direction d : cycle_directions_cw()) {
+      if (next == BIT(d)) {
+        intent->type = IntentRoadStep;
+        intent->dir = s.walking.dir;
+        intent->paths = paths;
+        intent->step = d;
+        return;
+      }
+    }
+  } else if (state == StateFreeWalking &&
+             (s.free_walking.flags & 0xf) == 0) {
+    /* Walk straight towards the destination if the way is free. */
+    int dir_index = free_walking_dir_index(s.free_walking.dist_col,
+                                           s.free_walking.dist_row);
+    Direction dir = free_walking_dir_forward[6*dir_index];
+    if (BIT_TEST(map.get_free_dirs(pos, false), dir)) {
+      intent->type = IntentFreeStep;
+      intent->dir = s.free_walking.flags;
+      intent->dist_col = s.free_walking.dist_col;
+      intent->dist_row = s.free_walking.dist_row;
+      intent->step = dir;
+    }
+  }
+}
+
+bool
+Serf::commit_update(const Intent &intent) {
+  if (state != intent.state || tick != intent.tick ||
+      counter != intent.counter || pos != intent.pos) {
+    update();
+    return false;
+  }
+
+  PMap map = game->get_map();
+  bool unchanged = false;
+  switch (intent.type) {
+  case IntentCountdown:
+    unchanged = true;
+    break;
+  case IntentRoadStep:
+    unchanged = (s.walking.dir == intent.dir && !map->has_flag(pos) &&
+                 map->paths(pos) == intent.paths);
+    break;
+  case IntentFreeStep:
+    unchanged = (s.free_walking.flags == intent.dir &&
+                 s.free_walking.dist_col == intent.dist_col &&
+                 s.free_walking.dist_row == intent.dist_row &&
+                 BIT_TEST(map->get_free_dirs(pos, false), intent.step));
+    break;
+  default:
+    break;
+  }
+  if (!unchanged) {
+    update();
+    return false;
+  }
+
+  tick = game->get_tick();
+  counter = intent.next_counter;
+
+  /* Take the planned step as the handler would, then let the handler go
+     on if the counter has not made up for it. With the ticks counted
+     down already, the handler picks up from here. */
+  if (intent.type == IntentRoadStep) {
+    change_direction(intent.step, 0);
+    if (counter < 0) handle_serf_walking_state();
+  } else if (intent.type == IntentFreeStep) {
+    handle_serf_free_walking_switch_on_dir(intent.step);
+    if (counter < 0) handle_serf_free_walking_state();
+  }
+
+  return true;
+}
+
 SaveReaderBinary&
 operator >> (SaveReaderBinary &reader, Serf &serf) {
   uint8_t v8;
@@ -5857,10 +6293,11 @@ operator << (SaveWriterText &writer, Serf &serf) {
   writer.value("type") << serf.type;
   writer.value("owner") << serf.owner;
   writer.value("animation") << serf.animation;
-  writer.value("counter") << serf.counter;
+  writer.value("counter") << serf.get_counter();
   writer.value("pos") << serf.get_game()->get_map()->pos_col(serf.pos);
   writer.value("pos") << serf.get_game()->get_map()->pos_row(serf.pos);
-  writer.value("tick") << serf.tick;
+  writer.value("tick") << static_cast<uint16_t>(serf.tick +
+                                                serf.pending_ticks());
   writer.value("state") << serf.state;
 
   switch (serf.state) {
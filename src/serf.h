@@ -378,6 +378,9 @@ class Serf : public GameObject {
  public:
   Serf(Game *game, unsigned int index);
 
+  /* Hash of the state, for checking that two games run in lockstep. */
+  uint64_t get_state_hash() const;
+
   unsigned int get_owner() const { return owner; }
   void set_owner(unsigned int player_num) { owner = player_num; }
 
@@ -390,7 +393,7 @@ class Serf : public GameObject {
 
   State get_state() const { return state; }
   int get_animation() const { return animation; }
-  int get_counter() const { return counter; }
+  int get_counter() const;
 
   MapPos get_pos() const { return pos; }
 
@@ -449,6 +452,44 @@ class Serf : public GameObject {
   void go_out_from_building(MapPos dest, int dir, int field_B);
 
   void update();
+  int get_idle_ticks() const;
+  void catch_up(unsigned int last_tick);
+
+  /* The coming update worked out ahead from a read of the serf and the
+     map, without changing anything, so that serfs can be planned in
+     parallel. Planned are updates that only count down, and the first
+     step of an update that walks on along a road or walks freely towards
+     the destination. Updates that draw random numbers are never planned,
+     so the draws stay in the order of the serf update. */
+  typedef enum IntentType {
+    IntentNone,
+    IntentCountdown,
+    IntentRoadStep,
+    IntentFreeStep
+  } IntentType;
+
+  typedef struct Intent {
+    IntentType type;
+    /* What the intent was worked out from. */
+    State state;
+    uint16_t tick;
+    int counter;
+    MapPos pos;
+    int dir;  /* Walking direction, or the free walking flags. */
+    int dist_col;
+    int dist_row;
+    unsigned int paths;
+    /* The counter once the ticks are counted down, and the direction of
+       the step. */
+    int next_counter;
+    Direction step;
+  } Intent;
+
+  void plan_update(const Map &map, Intent *intent) const;
+  /* Carry out the planned update, or run the handler if the serf or the
+     tiles the plan read have changed in the meantime. Returns whether the
+     plan was carried out. */
+  bool commit_update(const Intent &intent);
 
   static const char *get_state_name(State state);
   static const char *get_type_name(Type type);
@@ -463,6 +504,8 @@ class Serf : public GameObject {
   std::string print_state();
 
  protected:
+  bool counts_down() const;
+  int pending_ticks() const;
   bool is_waiting(Direction *dir);
   int switch_waiting(Direction dir);
   int get_walking_animation(int h_diff, Direction dir, int switch_pos);
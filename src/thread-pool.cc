@@ -0,0 +1,297 @@
+/*
+ * thread-pool.cc - Work-stealing thread pool and job helpers
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/thread-pool.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "src/debug.h"
+
+/* Pool and queue of the worker running on this thread, if any. */
+static thread_local ThreadPool *current_pool = nullptr;
+static thread_local unsigned int current_queue = 0;
+
+ThreadPool::ThreadPool(unsigned int threads)
+  : pending(0)
+  , stopping(false)
+  , next_queue(0) {
+  for (unsigned int i = 0; i < threads; i++) {
+    queues.emplace_back(new Queue());
+  }
+  for (unsigned int i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::work, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+ThreadPool &
+ThreadPool::get_instance() {
+  static unsigned int hardware = std::thread::hardware_concurrency();
+  static ThreadPool pool((hardware > 1) ? hardware - 1 : 0);
+  return pool;
+}
+
+void
+ThreadPool::submit(Task task) {
+  if (workers.empty()) {
+    task();
+    return;
+  }
+
+  unsigned int index = (current_pool == this) ? current_queue :
+                       static_cast<unsigned int>(next_queue++ % queues.size());
+  /* Count the task before it can be taken, so that pending never drops
+     below zero. */
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    pending++;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    queues[index]->tasks.push_back(std::move(task));
+  }
+  wakeup.notify_one();
+}
+
+/* Run one queued task, newest first from the own queue of a worker, else
+   oldest first from any other queue. Returns false if none was found. */
+bool
+ThreadPool::run_one() {
+  size_t count = queues.size();
+  if (count == 0) {
+    return false;
+  }
+
+  size_t own = (current_pool == this) ? current_queue : count;
+  Task task;
+  for (size_t i = 0; i < count && !task; i++) {
+    size_t index = (own < count) ? (own + i) % count : i;
+    Queue *queue = queues[index].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->tasks.empty()) {
+      continue;
+    }
+    if (index == own) {
+      task = std::move(queue->tasks.back());
+      queue->tasks.pop_back();
+    } else {
+      task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+    }
+  }
+
+  if (!task) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    pending--;
+  }
+  task();
+  return true;
+}
+
+void
+ThreadPool::work(unsigned int index) {
+  current_pool = this;
+  current_queue = index;
+
+  while (true) {
+    if (run_one()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    wakeup.wait(lock, [this]() { return stopping || pending > 0; });
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+void
+ThreadPool::parallel_for(size_t begin, size_t end, size_t grain,
+                         std::function<void(size_t, size_t)> body) {
+  if (grain == 0) {
+    grain = 1;
+  }
+
+  Batch batch(this);
+  for (size_t first = begin; first < end; first += grain) {
+    size_t last = std::min(first + grain, end);
+    batch.submit([&body, first, last]() { body(first, last); });
+  }
+  batch.wait();
+}
+
+ThreadPool::Batch::Batch(ThreadPool *pool)
+  : pool(pool)
+  , left(0) {
+}
+
+/* A batch left by an exception still has to outlive its tasks. */
+ThreadPool::Batch::~Batch() {
+  drain();
+}
+
+void
+ThreadPool::Batch::submit(Task task) {
+  left++;
+  pool->submit([this, task]() { run(task); });
+}
+
+void
+ThreadPool::Batch::wait() {
+  drain();
+
+  if (error) {
+    std::exception_ptr rethrow = error;
+    error = nullptr;
+    std::rethrow_exception(rethrow);
+  }
+}
+
+void
+ThreadPool::Batch::run(const Task &task) {
+  try {
+    task();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error) {
+      error = std::current_exception();
+    }
+  }
+
+  /* Last access to the batch; the waiting thread may free it once the
+     lock is released. */
+  std::lock_guard<std::mutex> lock(pool->sleep_mutex);
+  if (--left == 0) {
+    pool->wakeup.notify_all();
+  }
+}
+
+/* Run queued tasks until all tasks of the batch have finished. When there
+   is nothing left to run, sleep until a task is queued or the last task
+   of the batch is done on another thread. */
+void
+ThreadPool::Batch::drain() {
+  while (true) {
+    if (pool->run_one()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(pool->sleep_mutex);
+    pool->wakeup.wait(lock, [this]() {
+      return left == 0 || pool->pending > 0;
+    });
+    if (left == 0) {
+      return;
+    }
+  }
+}
+
+ThreadPool::Graph::Node
+ThreadPool::Graph::add(Task task) {
+  Entry *entry = new Entry();
+  entry->task = std::move(task);
+  entry->predecessors = 0;
+  entry->waiting = 0;
+  entries.emplace_back(entry);
+  return entries.size() - 1;
+}
+
+void
+ThreadPool::Graph::depends(Node node, Node on) {
+  entries[on]->successors.push_back(node);
+  entries[node]->predecessors++;
+}
+
+void
+ThreadPool::Graph::run(ThreadPool *pool) {
+  /* Find the order the tasks run in without workers, which also makes sure
+     that every task can run at all. */
+  std::vector<Node> order;
+  std::vector<unsigned int> waiting;
+  std::priority_queue<Node, std::vector<Node>, std::greater<Node>> ready;
+  for (Node node = 0; node < entries.size(); node++) {
+    waiting.push_back(entries[node]->predecessors);
+    if (waiting.back() == 0) {
+      ready.push(node);
+    }
+  }
+  while (!ready.empty()) {
+    Node node = ready.top();
+    ready.pop();
+    order.push_back(node);
+    for (Node successor : entries[node]->successors) {
+      if (--waiting[successor] == 0) {
+        ready.push(successor);
+      }
+    }
+  }
+  if (order.size() != entries.size()) {
+    throw ExceptionFreeserf("Task graph has a dependency cycle");
+  }
+
+  if (pool->get_thread_count() == 0) {
+    for (Node node : order) {
+      entries[node]->task();
+    }
+    return;
+  }
+
+  Batch batch(pool);
+  for (Node node = 0; node < entries.size(); node++) {
+    entries[node]->waiting = entries[node]->predecessors;
+  }
+  for (Node node = 0; node < entries.size(); node++) {
+    if (entries[node]->predecessors == 0) {
+      start(node, &batch);
+    }
+  }
+  batch.wait();
+}
+
+void
+ThreadPool::Graph::start(Node node, Batch *batch) {
+  batch->submit([this, node, batch]() {
+    entries[node]->task();
+    for (Node successor : entries[node]->successors) {
+      if (entries[successor]->waiting.fetch_sub(1) == 1) {
+        start(successor, batch);
+      }
+    }
+  });
+}
@@ -0,0 +1,162 @@
+/*
+ * thread-pool.h - Work-stealing thread pool and job helpers
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_THREAD_POOL_H_
+#define SRC_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A pool of worker threads, each with a task queue of its own. Workers take
+   work from the back of their own queue and steal from the front of the
+   others' when it runs dry. A thread that waits for a batch of tasks runs
+   queued tasks itself meanwhile, so tasks may start and wait for further
+   tasks without tying up the pool.
+
+   A pool created with no workers runs every task on the calling thread, in
+   submission order. All helpers below give the same results either way. */
+class ThreadPool {
+ public:
+  typedef std::function<void()> Task;
+
+  /* Tasks submitted together; wait() returns when all of them have run,
+     and rethrows the first exception thrown by any of them. */
+  class Batch {
+   protected:
+    ThreadPool *pool;
+    std::atomic<size_t> left;
+    std::mutex mutex;
+    std::exception_ptr error;
+
+   public:
+    explicit Batch(ThreadPool *pool);
+    ~Batch();
+
+    void submit(Task task);
+    void wait();
+
+   protected:
+    void run(const Task &task);
+    void drain();
+  };
+
+  /* Tasks with dependencies between them. Each task is started once all
+     the tasks it depends on have finished. Without workers tasks run in
+     the order they were added, dependencies permitting. */
+  class Graph {
+   public:
+    typedef size_t Node;
+
+   protected:
+    class Entry {
+     public:
+      Task task;
+      std::vector<Node> successors;
+      unsigned int predecessors;
+      std::atomic<unsigned int> waiting;
+    };
+
+    std::vector<std::unique_ptr<Entry>> entries;
+
+   public:
+    Node add(Task task);
+    void depends(Node node, Node on);
+    size_t size() const { return entries.size(); }
+
+    void run(ThreadPool *pool);
+
+   protected:
+    void start(Node node, Batch *batch);
+  };
+
+ protected:
+  class Queue {
+   public:
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex sleep_mutex;
+  std::condition_variable wakeup;
+  size_t pending;
+  bool stopping;
+  std::atomic<size_t> next_queue;
+
+ public:
+  /* Create a pool with the given number of worker threads. */
+  explicit ThreadPool(unsigned int threads);
+  virtual ~ThreadPool();
+
+  /* Shared pool with one worker less than the hardware has threads; the
+     thread waiting for results makes up the difference. */
+  static ThreadPool &get_instance();
+
+  unsigned int get_thread_count() const {
+    return static_cast<unsigned int>(workers.size());
+  }
+
+  /* Call body(first, last) for consecutive ranges of at most grain
+     elements covering [begin, end). */
+  void parallel_for(size_t begin, size_t end, size_t grain,
+                    std::function<void(size_t, size_t)> body);
+
+  /* Map each range of at most grain elements to a partial result and fold
+     the partial results from left to right, starting with init. The split
+     does not depend on the number of threads, so neither does the result,
+     even for operations that are not associative such as floating point
+     addition. */
+  template<class T, class Map, class Reduce>
+  T parallel_reduce(size_t begin, size_t end, size_t grain, T init,
+                    Map map, Reduce reduce) {
+    if (grain == 0) grain = 1;
+    size_t chunks = (end > begin) ? (end - begin + grain - 1) / grain : 0;
+    std::deque<T> partial(chunks, init);
+    parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        size_t from = begin + i * grain;
+        partial[i] = map(from, std::min(from + grain, end));
+      }
+    });
+    T result = init;
+    for (const T &value : partial) {
+      result = reduce(result, value);
+    }
+    return result;
+  }
+
+ protected:
+  void submit(Task task);
+  bool run_one();
+  void work(unsigned int index);
+};
+
+#endif  // SRC_THREAD_POOL_H_
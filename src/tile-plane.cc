@@ -0,0 +1,118 @@
+/*
+ * tile-plane.cc - Per-tile storage on the heap or in a mapped file
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/tile-plane.h"
+
+#include <utility>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+  : data(nullptr)
+  , size(0)
+  , fd(-1) {
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+void
+MappedFile::swap(MappedFile &other) {
+  std::swap(data, other.data);
+  std::swap(size, other.size);
+  std::swap(fd, other.fd);
+}
+
+#ifndef _WIN32
+
+bool
+MappedFile::open(const std::string &path, size_t _size, bool create) {
+  close();
+
+  int flags = create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR;
+  fd = ::open(path.c_str(), flags, 0644);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (create) {
+    if (ftruncate(fd, _size) != 0) {
+      close();
+      unlink(path.c_str());
+      return false;
+    }
+  } else if (fstat(fd, &st) != 0 ||
+             static_cast<size_t>(st.st_size) != _size) {
+    close();
+    return false;
+  }
+
+  void *mapped = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  if (mapped == MAP_FAILED) {
+    close();
+    if (create) unlink(path.c_str());
+    return false;
+  }
+
+  data = mapped;
+  size = _size;
+  return true;
+}
+
+void
+MappedFile::close() {
+  if (data != nullptr) munmap(data, size);
+  if (fd >= 0) ::close(fd);
+  data = nullptr;
+  size = 0;
+  fd = -1;
+}
+
+bool
+MappedFile::sync() {
+  if (data == nullptr) return false;
+  return (msync(data, size, MS_SYNC) == 0);
+}
+
+#else
+
+/* Mapped files are not supported on Windows; tiles stay on the heap. */
+bool
+MappedFile::open(const std::string &path, size_t _size, bool create) {
+  return false;
+}
+
+void
+MappedFile::close() {
+}
+
+bool
+MappedFile::sync() {
+  return false;
+}
+
+#endif
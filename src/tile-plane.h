@@ -0,0 +1,138 @@
+/*
+ * tile-plane.h - Per-tile storage on the heap or in a mapped file
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SRC_TILE_PLANE_H_
+#define SRC_TILE_PLANE_H_
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/* A file mapped into memory for reading and writing. */
+class MappedFile {
+ protected:
+  void *data;
+  size_t size;
+  int fd;
+
+ public:
+  MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile &operator = (const MappedFile&) = delete;
+  virtual ~MappedFile();
+
+  /* Map the file at path, which must hold exactly size bytes unless
+     create is set, in which case it is created or truncated to size. A
+     file created here is removed again if it cannot be mapped. */
+  bool open(const std::string &path, size_t size, bool create);
+  void close();
+  void swap(MappedFile &other);
+  /* Write changes back to the file. */
+  bool sync();
+
+  bool is_open() const { return (data != nullptr); }
+  void *get_data() const { return data; }
+};
+
+/* One value per map tile. The values are kept on the heap, or in a file
+   mapped into memory so that the operating system can page them out and
+   the file always holds the current tiles. */
+template <typename T>
+class TilePlane {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Tiles are stored as raw bytes in mapped files");
+
+ protected:
+  std::vector<T> heap;
+  MappedFile file;
+  T *data;
+  size_t count;
+
+ public:
+  TilePlane() : data(nullptr), count(0) {}
+
+  void resize(size_t size) {
+    file.close();
+    heap.resize(size);
+    data = heap.data();
+    count = size;
+  }
+
+  TilePlane &operator = (const std::vector<T> &tiles) {
+    if (tiles.size() != count) resize(tiles.size());
+    std::copy(tiles.begin(), tiles.end(), data);
+    return *this;
+  }
+
+  /* Take over the values of other, wherever they are kept here. */
+  void assign(const TilePlane &other) {
+    if (other.count != count) resize(other.count);
+    std::copy(other.data, other.data + count, data);
+  }
+
+  T &operator[] (size_t index) { return data[index]; }
+  const T &operator[] (size_t index) const { return data[index]; }
+  size_t size() const { return count; }
+  bool is_mapped() const { return file.is_open(); }
+  size_t heap_bytes() const { return heap.capacity() * sizeof(T); }
+
+  size_t bytes() const { return count * sizeof(T); }
+
+  /* Move the tiles into a new file at path. */
+  bool map_new(const std::string &path) {
+    MappedFile mapped;
+    if (!mapped.open(path, bytes(), true)) return false;
+    std::copy(data, data + count, static_cast<T*>(mapped.get_data()));
+    map_file(&mapped);
+    return true;
+  }
+
+  /* Use the tiles in the existing file at path. */
+  bool map_existing(const std::string &path) {
+    MappedFile mapped;
+    if (!mapped.open(path, bytes(), false)) return false;
+    map_file(&mapped);
+    return true;
+  }
+
+  /* Use the tiles in a file opened with the size of the plane, taking it
+     over from mapped. */
+  void map_file(MappedFile *mapped) {
+    file.swap(*mapped);
+    mapped->close();
+    data = static_cast<T*>(file.get_data());
+    std::vector<T>().swap(heap);
+  }
+
+  /* Move the tiles back onto the heap and close the file, which keeps
+     the tiles as they were last written. */
+  void unmap() {
+    if (!file.is_open()) return;
+    std::vector<T>(data, data + count).swap(heap);
+    data = heap.data();
+    file.close();
+  }
+
+  bool sync() { return !file.is_open() || file.sync(); }
+};
+
+#endif  // SRC_TILE_PLANE_H_
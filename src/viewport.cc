@@ -519,6 +519,47 @@ Viewport::draw_border_segment(int lx, int ly, MapPos pos, Direction dir) {
   frame->draw_sprite(lx, ly, Data::AssetMapBorder, sprite, false);
 }
 
+static void
+set_sfx(std::vector<bool> *sfx, unsigned int index, bool playing) {
+  if (index >= sfx->size()) {
+    if (!playing) return;
+    sfx->resize(index + 1, false);
+  }
+  (*sfx)[index] = playing;
+}
+
+bool
+Viewport::is_playing_sfx(const Serf *serf) const {
+  unsigned int index = serf->get_index();
+  return (index < serf_sfx.size()) && serf_sfx[index];
+}
+
+void
+Viewport::start_playing_sfx(const Serf *serf) {
+  set_sfx(&serf_sfx, serf->get_index(), true);
+}
+
+void
+Viewport::stop_playing_sfx(const Serf *serf) {
+  set_sfx(&serf_sfx, serf->get_index(), false);
+}
+
+bool
+Viewport::is_playing_sfx(const Building *building) const {
+  unsigned int index = building->get_index();
+  return (index < building_sfx.size()) && building_sfx[index];
+}
+
+void
+Viewport::start_playing_sfx(const Building *building) {
+  set_sfx(&building_sfx, building->get_index(), true);
+}
+
+void
+Viewport::stop_playing_sfx(const Building *building) {
+  set_sfx(&building_sfx, building->get_index(), false);
+}
+
 MapPos
 Viewport::get_offset(int *x_off, int *y_off, int *col, int *row) {
   if (x_off != nullptr) {
@@ -813,9 +854,9 @@ Viewport::draw_unharmed_building(Building *building, int lx, int ly) {
     case Building::TypeMill:
       if (building->is_active()) {
         if ((interface->get_game()->get_tick() >> 4) & 3) {
-          building->stop_playing_sfx();
-        } else if (!building->is_playing_sfx()) {
-          building->start_playing_sfx();
+          stop_playing_sfx(building);
+        } else if (!is_playing_sfx(building)) {
+          start_playing_sfx(building);
           play_sound(Audio::TypeSfxMillGrinding);
         }
         draw_shadow_and_building_sprite(lx, ly, map_building_sprite[type] +
@@ -835,11 +876,11 @@ Viewport::draw_unharmed_building(Building *building, int lx, int ly) {
       draw_shadow_and_building_sprite(lx, ly, map_building_sprite[type]);
       if (building->is_active()) {
         int i = (interface->get_game()->get_tick() >> 3) & 7;
-        if (i == 0 || (i == 7 && !building->is_playing_sfx())) {
-          building->start_playing_sfx();
+        if (i == 0 || (i == 7 && !is_playing_sfx(building))) {
+          start_playing_sfx(building);
           play_sound(Audio::TypeSfxGoldBoils);
         } else if (i != 7) {
-          building->stop_playing_sfx();
+          stop_playing_sfx(building);
         }
 
         draw_game_sprite(lx+6, ly-32, 128+i);
@@ -869,11 +910,11 @@ Viewport::draw_unharmed_building(Building *building, int lx, int ly) {
       draw_shadow_and_building_sprite(lx, ly, map_building_sprite[type]);
       if (building->is_active()) {
         int i = (interface->get_game()->get_tick() >> 3) & 7;
-        if (i == 0 || (i == 7 && !building->is_playing_sfx())) {
-          building->start_playing_sfx();
+        if (i == 0 || (i == 7 && !is_playing_sfx(building))) {
+          start_playing_sfx(building);
           play_sound(Audio::TypeSfxGoldBoils);
         } else if (i != 7) {
-          building->stop_playing_sfx();
+          stop_playing_sfx(building);
         }
 
         draw_game_sprite(lx-7, ly-33, 128+i);
@@ -1104,21 +1145,20 @@ Viewport::draw_burning_building(Building *building, int lx, int ly) {
     0, 13, 19, -1
   };
 
+  /* The game burns the building down in update_buildings(). Count ahead
+     from its last update without touching the building. */
+  uint16_t delta = interface->get_game()->get_tick() - building->get_tick();
+  int counter = building->get_burning_counter() - delta;
+
   /* Play sound effect. */
-  if (((building->get_burning_counter() >> 3) & 3) == 3 &&
-      !building->is_playing_sfx()) {
-    building->start_playing_sfx();
+  if (((counter >> 3) & 3) == 3 && !is_playing_sfx(building)) {
+    start_playing_sfx(building);
     play_sound(Audio::TypeSfxBurning);
   } else {
-    building->stop_playing_sfx();
+    stop_playing_sfx(building);
   }
 
-  uint16_t delta = interface->get_game()->get_tick() - building->get_tick();
-  building->set_tick(interface->get_game()->get_tick());
-
-  if (building->get_burning_counter() >= delta) {
-    building->decrease_burning_counter(delta);  // TODO(jonls): this is also
-                                                // done in update_buildings().
+  if (counter >= 0) {
     draw_unharmed_building(building, lx, ly);
 
     int type = 0;
@@ -1127,7 +1167,7 @@ Viewport::draw_burning_building(Building *building, int lx, int ly) {
       type = building->get_type();
     }
 
-    int offset = ((building->get_burning_counter() >> 3) & 7) ^ 7;
+    int offset = ((counter >> 3) & 7) ^ 7;
     const int *anim = building_burn_animation +
                       building_anim_offset_from_type[type];
     while (anim[0] >= 0) {
@@ -1135,8 +1175,6 @@ Viewport::draw_burning_building(Building *building, int lx, int ly) {
       offset = (offset + 3) & 7;
       anim += 3;
     }
-  } else {
-    building->set_burning_counter(0);
   }
 }
 
@@ -1387,12 +1425,12 @@ Viewport::serf_get_body(Serf *serf) {
     break;
   case Serf::TypeSailor:
     if (serf->get_state() == Serf::StateTransporting && t < 0x80) {
-      if (((t & 7) == 4 && !serf->playing_sfx()) ||
+      if (((t & 7) == 4 && !is_playing_sfx(serf)) ||
           (t & 7) == 3) {
-        serf->start_playing_sfx();
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxRowing);
       } else {
-        serf->stop_playing_sfx();
+        stop_playing_sfx(serf);
       }
     }
 
@@ -1401,12 +1439,12 @@ Viewport::serf_get_body(Serf *serf) {
         serf->get_state() == Serf::StateLostSailor ||
         serf->get_state() == Serf::StateFreeSailing) {
       if (t < 0x80) {
-        if (((t & 7) == 4 && !serf->playing_sfx()) ||
+        if (((t & 7) == 4 && !is_playing_sfx(serf)) ||
             (t & 7) == 3) {
-          serf->start_playing_sfx();
+          start_playing_sfx(serf);
           play_sound(Audio::TypeSfxRowing);
         } else {
-          serf->stop_playing_sfx();
+          stop_playing_sfx(serf);
         }
       }
       t += 0x200;
@@ -1420,13 +1458,13 @@ Viewport::serf_get_body(Serf *serf) {
     if (t < 0x80) {
       t += 0x300;
     } else if (t == 0x83 || t == 0x84) {
-      if (t == 0x83 || !serf->playing_sfx()) {
-        serf->start_playing_sfx();
+      if (t == 0x83 || !is_playing_sfx(serf)) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxDigging);
       }
       t += 0x380;
     } else {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0x380;
     }
     break;
@@ -1434,13 +1472,13 @@ Viewport::serf_get_body(Serf *serf) {
     if (t < 0x80) {
       t += 0x500;
     } else if ((t & 7) == 4 || (t & 7) == 5) {
-      if ((t & 7) == 4 || !serf->playing_sfx()) {
-        serf->start_playing_sfx();
+      if ((t & 7) == 4 || !is_playing_sfx(serf)) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxHammerBlow);
       }
       t += 0x580;
     } else {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0x580;
     }
     break;
@@ -1461,9 +1499,9 @@ Viewport::serf_get_body(Serf *serf) {
       } else {
         t += 0xb00;
       }
-    } else if ((t == 0x86 && !serf->playing_sfx()) ||
+    } else if ((t == 0x86 && !is_playing_sfx(serf)) ||
          t == 0x85) {
-      serf->start_playing_sfx();
+      start_playing_sfx(serf);
       play_sound(Audio::TypeSfxAxBlow);
       /* TODO Dangerous reference to unknown state vars.
          It is probably free walking. */
@@ -1473,7 +1511,7 @@ Viewport::serf_get_body(Serf *serf) {
       }
       t += 0xe80;
     } else if (t != 0x86) {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0xe80;
     }
     break;
@@ -1489,12 +1527,12 @@ Viewport::serf_get_body(Serf *serf) {
     } else {
       /* player_num += 4; ??? */
       if (t == 0xb3 || t == 0xbb || t == 0xc3 || t == 0xcb ||
-          (!serf->playing_sfx() && (t == 0xb7 || t == 0xbf ||
+          (!is_playing_sfx(serf) && (t == 0xb7 || t == 0xbf ||
                 t == 0xc7 || t == 0xcf))) {
-        serf->start_playing_sfx();
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxSawing);
       } else if (t != 0xb7 && t != 0xbf && t != 0xc7 && t != 0xcf) {
-        serf->stop_playing_sfx();
+        stop_playing_sfx(serf);
       }
       t += 0x1580;
     }
@@ -1510,24 +1548,24 @@ Viewport::serf_get_body(Serf *serf) {
       } else {
         t += 0xd00;
       }
-    } else if (t == 0x85 || (t == 0x86 && !serf->playing_sfx())) {
-      serf->start_playing_sfx();
+    } else if (t == 0x85 || (t == 0x86 && !is_playing_sfx(serf))) {
+      start_playing_sfx(serf);
       play_sound(Audio::TypeSfxPickBlow);
       t += 0x1280;
     } else if (t != 0x86) {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0x1280;
     }
     break;
   case Serf::TypeForester:
     if (t < 0x80) {
       t += 0xe00;
-    } else if (t == 0x86 || (t == 0x87 && !serf->playing_sfx())) {
-      serf->start_playing_sfx();
+    } else if (t == 0x86 || (t == 0x87 && !is_playing_sfx(serf))) {
+      start_playing_sfx(serf);
       play_sound(Audio::TypeSfxPlanting);
       t += 0x1080;
     } else if (t != 0x87) {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0x1080;
     }
     break;
@@ -1631,11 +1669,11 @@ Viewport::serf_get_body(Serf *serf) {
     } else {
       /* edi10 += 4; */
       if ((t == 0xb2 || t == 0xba || t == 0xc2 || t == 0xca) &&
-          !serf->playing_sfx()) {
-        serf->start_playing_sfx();
+          !is_playing_sfx(serf)) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxBackswordBlow);
       } else if (t != 0xb2 && t != 0xba && t != 0xc2 && t != 0xca) {
-        serf->stop_playing_sfx();
+        stop_playing_sfx(serf);
       }
       t += 0x3780;
     }
@@ -1653,12 +1691,12 @@ Viewport::serf_get_body(Serf *serf) {
       /* TODO access to state without state check */
       if (serf->get_free_walking_neg_dist1() == 0) {
         t += 0x3d80;
-      } else if (t == 0x83 || (t == 0x84 && !serf->playing_sfx())) {
-        serf->start_playing_sfx();
+      } else if (t == 0x83 || (t == 0x84 && !is_playing_sfx(serf))) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxMowing);
         t += 0x3e80;
       } else if (t != 0x83 && t != 0x84) {
-        serf->stop_playing_sfx();
+        stop_playing_sfx(serf);
         t += 0x3e80;
       }
     }
@@ -1701,13 +1739,13 @@ Viewport::serf_get_body(Serf *serf) {
         t += 0x4e00;
       }
     } else if (t == 0x84 || t == 0x85) {
-      if (t == 0x84 || !serf->playing_sfx()) {
-        serf->start_playing_sfx();
+      if (t == 0x84 || !is_playing_sfx(serf)) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxWoodHammering);
       }
       t += 0x4e80;
     } else {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0x4e80;
     }
     break;
@@ -1733,14 +1771,14 @@ Viewport::serf_get_body(Serf *serf) {
       }
     } else {
       /* edi10 += 4; */
-      if (t == 0x83 || (t == 0xb2 && !serf->playing_sfx())) {
-        serf->start_playing_sfx();
+      if (t == 0x83 || (t == 0xb2 && !is_playing_sfx(serf))) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxSawing);
-      } else if (t == 0x87 || (t == 0xb6 && !serf->playing_sfx())) {
-        serf->start_playing_sfx();
+      } else if (t == 0x87 || (t == 0xb6 && !is_playing_sfx(serf))) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxWoodHammering);
       } else if (t != 0xb2 && t != 0xb6) {
-        serf->stop_playing_sfx();
+        stop_playing_sfx(serf);
       }
       t += 0x5880;
     }
@@ -1760,11 +1798,11 @@ Viewport::serf_get_body(Serf *serf) {
       }
     } else {
       /* edi10 += 4; */
-      if (t == 0x83 || (t == 0x84 && !serf->playing_sfx())) {
-        serf->start_playing_sfx();
+      if (t == 0x83 || (t == 0x84 && !is_playing_sfx(serf))) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxMetalHammering);
       } else if (t != 0x84) {
-        serf->stop_playing_sfx();
+        stop_playing_sfx(serf);
       }
       t += 0x5280;
     }
@@ -1773,19 +1811,19 @@ Viewport::serf_get_body(Serf *serf) {
     if (t < 0x80) {
       t += 0x3900;
     } else if (t == 0x83 || t == 0x84 || t == 0x86) {
-      if (t == 0x83 || !serf->playing_sfx()) {
-        serf->start_playing_sfx();
+      if (t == 0x83 || !is_playing_sfx(serf)) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxGeologistSampling);
       }
       t += 0x4c80;
     } else if (t == 0x8c || t == 0x8d) {
-      if (t == 0x8c || !serf->playing_sfx()) {
-        serf->start_playing_sfx();
+      if (t == 0x8c || !is_playing_sfx(serf)) {
+        start_playing_sfx(serf);
         play_sound(Audio::TypeSfxResourceFound);
       }
       t += 0x4c80;
     } else {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
       t += 0x4c80;
     }
     break;
@@ -1802,9 +1840,9 @@ Viewport::serf_get_body(Serf *serf) {
       if (serf->get_state() == Serf::StateKnightAttacking ||
           serf->get_state() == Serf::StateKnightAttackingFree) {
         if (serf->get_counter() >= 24 || serf->get_counter() < 8) {
-          serf->stop_playing_sfx();
-        } else if (!serf->playing_sfx()) {
-          serf->start_playing_sfx();
+          stop_playing_sfx(serf);
+        } else if (!is_playing_sfx(serf)) {
+          start_playing_sfx(serf);
           if (serf->get_attacking_field_D() == 0 ||
               serf->get_attacking_field_D() == 4) {
             play_sound(Audio::TypeSfxFight01);
@@ -1824,13 +1862,13 @@ Viewport::serf_get_body(Serf *serf) {
   }
     break;
   case Serf::TypeDead:
-    if ((!serf->playing_sfx() &&
+    if ((!is_playing_sfx(serf) &&
          (t == 2 || t == 5)) ||
         (t == 1 || t == 4)) {
-      serf->start_playing_sfx();
+      start_playing_sfx(serf);
       play_sound(Audio::TypeSfxSerfDying);
     } else {
-      serf->stop_playing_sfx();
+      stop_playing_sfx(serf);
     }
     t += 0x8700;
     break;
@@ -2150,20 +2188,19 @@ Viewport::draw_map_cursor_possible_build() {
 
       /* Draw possible building */
       int sprite = -1;
-      if (game->can_build_castle(pos, interface->get_player())) {
-        sprite = 50;
-      } else if (game->can_player_build(pos, interface->get_player()) &&
-                 Map::map_space_from_obj[map->get_obj(pos)] == Map::SpaceOpen &&
-                 (game->can_build_flag(map->move_down_right(pos),
-                                       interface->get_player()) ||
-                 map->has_flag(map->move_down_right(pos)))) {
-        if (game->can_build_mine(pos)) {
-          sprite = 48;
-        } else if (game->can_build_large(pos)) {
+      switch (game->get_build_possibility(pos, interface->get_player())) {
+        case BuildCache::BuildCastle:
+        case BuildCache::BuildLarge:
           sprite = 50;
-        } else if (game->can_build_small(pos)) {
+          break;
+        case BuildCache::BuildMine:
+          sprite = 48;
+          break;
+        case BuildCache::BuildSmall:
           sprite = 49;
-        }
+          break;
+        default:
+          break;
       }
 
       if (sprite >= 0) {
@@ -2276,6 +2313,8 @@ Viewport::internal_draw() {
     return;
   }
 
+  map->dispatch_changes();
+
   if (layers & LayerLandscape) {
     draw_landscape();
   }
@@ -2389,9 +2428,11 @@ Viewport::handle_dbl_click(int lx, int ly, Event::Button button) {
         play_sound(Audio::TypeSfxNotAccepted);
       }
     } else {
-      bool r = interface->get_game()->build_flag(
-                                                interface->get_map_cursor_pos(),
-                                                 player);
+      bool r = false;
+      MapPos pos = interface->get_map_cursor_pos();
+      interface->run_player_command([pos, &r](Player *player_) {
+        r = player_->get_game()->build_flag(pos, player_);
+      });
       if (r) {
         interface->build_road();
       } else {
@@ -2404,43 +2445,48 @@ Viewport::handle_dbl_click(int lx, int ly, Event::Button button) {
       return false;
     }
 
+    unsigned int index = map->get_obj_index(clk_pos);
     if (map->get_obj(clk_pos) == Map::ObjectFlag) {
+      interface->run_player_command([index](Player *player_) {
+        player_->temp_index = index;
+      });
       if (map->get_owner(clk_pos) == player->get_index()) {
         interface->open_popup(PopupBox::TypeTransportInfo);
       }
-
-      player->temp_index = map->get_obj_index(clk_pos);
     } else { /* Building */
       Building *building = interface->get_game()->get_building_at_pos(clk_pos);
       if ((building == nullptr) || building->is_burning()) {
         return false;
       }
       if (map->get_owner(clk_pos) == player->get_index()) {
-        if (!building->is_done()) {
+        Building::Type type = building->get_type();
+        bool done = building->is_done();
+        bool active = building->is_active();
+        interface->run_player_command([index](Player *player_) {
+          player_->temp_index = index;
+        });
+        /* The view has moved on to a new snapshot. */
+        if (!done) {
           interface->open_popup(PopupBox::TypeOrderedBld);
-        } else if (building->get_type() == Building::TypeCastle) {
+        } else if (type == Building::TypeCastle) {
           interface->open_popup(PopupBox::TypeCastleRes);
-        } else if (building->get_type() == Building::TypeStock) {
-          if (!building->is_active()) return 0;
+        } else if (type == Building::TypeStock) {
+          if (!active) return 0;
           interface->open_popup(PopupBox::TypeCastleRes);
-        } else if (building->get_type() == Building::TypeHut ||
-                   building->get_type() == Building::TypeTower ||
-                   building->get_type() == Building::TypeFortress) {
+        } else if (type == Building::TypeHut ||
+                   type == Building::TypeTower ||
+                   type == Building::TypeFortress) {
           interface->open_popup(PopupBox::TypeDefenders);
-        } else if (building->get_type() == Building::TypeStoneMine ||
-                   building->get_type() == Building::TypeCoalMine ||
-                   building->get_type() == Building::TypeIronMine ||
-                   building->get_type() == Building::TypeGoldMine) {
+        } else if (type == Building::TypeStoneMine ||
+                   type == Building::TypeCoalMine ||
+                   type == Building::TypeIronMine ||
+                   type == Building::TypeGoldMine) {
           interface->open_popup(PopupBox::TypeMineOutput);
         } else {
           interface->open_popup(PopupBox::TypeBldStock);
         }
-
-        player->temp_index = map->get_obj_index(clk_pos);
       } else { /* Foreign building */
         /* TODO handle coop mode*/
-        player->building_attacked = building->get_index();
-
         if (building->is_done() &&
             building->is_military()) {
           if (!building->is_active() ||
@@ -2480,9 +2526,14 @@ Viewport::handle_dbl_click(int lx, int ly, Event::Button button) {
             default: NOT_REACHED(); break;
           }
 
-          int knights =
-                 player->knights_available_for_attack(building->get_position());
-          player->knights_attacking = std::min(knights, max_knights);
+          unsigned int attacked = building->get_index();
+          MapPos attacked_pos = building->get_position();
+          interface->run_player_command([attacked, attacked_pos,
+                                         max_knights](Player *player_) {
+            player_->building_attacked = attacked;
+            int knights = player_->knights_available_for_attack(attacked_pos);
+            player_->knights_attacking = std::min(knights, max_knights);
+          });
           interface->open_popup(PopupBox::TypeStartAttack);
         }
       }
@@ -2717,6 +2768,8 @@ Viewport::move_by_pixels(int lx, int ly) {
 /* Called periodically when the game progresses. */
 void
 Viewport::update() {
+  map->dispatch_changes();
+
   int tick_xor = interface->get_game()->get_tick() ^ last_tick;
   last_tick = interface->get_game()->get_tick();
 
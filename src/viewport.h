@@ -24,6 +24,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "src/gui.h"
 #include "src/map.h"
@@ -62,6 +63,11 @@ class Viewport : public GuiObject, public Map::Handler {
 
   PMap map;
 
+  /* Whether a sound effect has started for a serf or building, by index.
+     Kept here as the game being drawn is replaced by each new snapshot. */
+  std::vector<bool> serf_sfx;
+  std::vector<bool> building_sfx;
+
  public:
   Viewport(Interface *interface, PMap map);
   virtual ~Viewport();
@@ -121,6 +127,12 @@ class Viewport : public GuiObject, public Map::Handler {
   void draw_map_cursor();
   void draw_base_grid_overlay(const Color &color);
   void draw_height_grid_overlay(const Color &color);
+  bool is_playing_sfx(const Serf *serf) const;
+  void start_playing_sfx(const Serf *serf);
+  void stop_playing_sfx(const Serf *serf);
+  bool is_playing_sfx(const Building *building) const;
+  void start_playing_sfx(const Building *building);
+  void stop_playing_sfx(const Building *building);
   MapPos get_offset(int *x_off, int *y_off,
                     int *col = nullptr, int *row = nullptr);
 
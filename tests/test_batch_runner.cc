@@ -0,0 +1,61 @@
+/*
+ * test_batch_runner.cc - test for the batch runner
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "src/batch-runner.h"
+#include "src/mission.h"
+#include "src/random.h"
+
+static std::vector<BatchRunner::GameSummary>
+run_games(unsigned int threads, unsigned int first, unsigned int count) {
+  BatchRunner runner(300, threads);
+  for (unsigned int i = first; i < first + count; i++) {
+    PGameInfo game_info(new GameInfo(Random(static_cast<uint16_t>(i))));
+    game_info->set_map_size(3);
+    runner.add_game(game_info);
+  }
+  return runner.run();
+}
+
+TEST(BatchRunner, GamesDoNotDependOnThreads) {
+  std::vector<BatchRunner::GameSummary> serial = run_games(1, 1, 4);
+  std::vector<BatchRunner::GameSummary> parallel = run_games(4, 1, 4);
+  std::vector<BatchRunner::GameSummary> alone = run_games(1, 3, 1);
+
+  ASSERT_EQ(4u, serial.size());
+  ASSERT_EQ(4u, parallel.size());
+  for (size_t i = 0; i < serial.size(); i++) {
+    EXPECT_EQ(serial[i].name, parallel[i].name);
+    EXPECT_EQ(serial[i].state_hash, parallel[i].state_hash);
+    ASSERT_EQ(serial[i].players.size(), parallel[i].players.size());
+    for (size_t p = 0; p < serial[i].players.size(); p++) {
+      EXPECT_LT(0, serial[i].players[p].land_area);
+      EXPECT_EQ(serial[i].players[p].land_area,
+                parallel[i].players[p].land_area);
+      EXPECT_EQ(serial[i].players[p].serfs, parallel[i].players[p].serfs);
+    }
+  }
+  EXPECT_EQ(serial[2].state_hash, alone[0].state_hash);
+}
@@ -0,0 +1,152 @@
+/*
+ * test_flag.cc - test for flag resource scheduling
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "src/flag.h"
+#include "src/game.h"
+#include "src/map-geometry.h"
+
+class TestScheduleBatch : public ScheduleBatch {
+ public:
+  explicit TestScheduleBatch(Game *game) : ScheduleBatch(game) {}
+
+  std::vector<Direction> resolve() {
+    resolve_known_dests();
+    std::vector<Direction> results;
+    for (const Request &request : requests) {
+      results.push_back(request.result);
+    }
+    requests.clear();
+    return results;
+  }
+};
+
+/* The forward search each slot used to run on its own: breadth first from
+   the neighbours in the order given, never passing the source flag. */
+static Direction
+forward_search(Flag *source, unsigned int dest,
+               const std::vector<Direction> &dirs) {
+  std::map<Flag*, Direction> first;
+  std::vector<Flag*> queue;
+  first[source] = DirectionNone;
+  for (Direction dir : dirs) {
+    Flag *other = source->get_other_end_flag(dir);
+    if (first.insert(std::make_pair(other, dir)).second) {
+      queue.push_back(other);
+    }
+  }
+
+  for (size_t i = 0; i < queue.size(); i++) {
+    Flag *flag = queue[i];
+    if (flag->get_index() == dest) return first[flag];
+    for (Direction d : cycle_directions_ccw()) {
+      if (!flag->has_transporter(d)) continue;
+      Flag *other = flag->get_other_end_flag(d);
+      if (first.insert(std::make_pair(other, first[flag])).second) {
+        queue.push_back(other);
+      }
+    }
+  }
+
+  return DirectionNone;
+}
+
+static void
+link(Flag *flag, Direction dir, Flag *other, Direction other_dir) {
+  flag->link_with_flag(other, false, 4, other_dir, dir);
+  flag->complete_serf_request(dir);
+  other->complete_serf_request(other_dir);
+}
+
+TEST(Flag, BatchedSearchMatchesForwardSearch) {
+  std::unique_ptr<Game> game(new Game());
+
+  /* A loop of six flags with a chord across it and a spur that can only
+     be left through the flag it hangs off. */
+  std::vector<Flag*> flags;
+  for (int i = 0; i < 8; i++) flags.push_back(game->create_flag());
+  for (int i = 0; i < 6; i++) {
+    link(flags[i], DirectionRight, flags[(i + 1) % 6], DirectionLeft);
+  }
+  link(flags[0], DirectionDown, flags[3], DirectionUp);
+  link(flags[1], DirectionDownRight, flags[6], DirectionUpLeft);
+  link(flags[6], DirectionDown, flags[7], DirectionUp);
+
+  /* Idle paths pick up their transporters. */
+  TestScheduleBatch batch(game.get());
+  for (Flag *flag : flags) flag->update(&batch);
+  for (Flag *flag : flags) {
+    for (Flag *dest : flags) {
+      if (dest != flag) {
+        ASSERT_TRUE(flag->drop_resource(Resource::TypePlank,
+                                        dest->get_index()));
+      }
+    }
+  }
+
+  /* Every ordered subset of path directions of every slot, all in one
+     batch so that the requests are grouped like in a real update. */
+  struct Expected {
+    Flag *flag;
+    std::vector<Direction> dirs;
+    Direction result;
+  };
+  std::vector<Expected> expected;
+  for (size_t i = 0; i < flags.size(); i++) {
+    Flag *flag = flags[i];
+    std::vector<Direction> paths;
+    for (Direction d : cycle_directions_ccw()) {
+      if (flag->has_transporter(d)) paths.push_back(d);
+    }
+    ASSERT_FALSE(paths.empty());
+
+    /* The slots hold the other flags in order. */
+    for (int slot = 0; slot < 7; slot++) {
+      size_t other = (static_cast<size_t>(slot) < i) ? slot : slot + 1;
+      unsigned int dest = flags[other]->get_index();
+      for (unsigned int mask = 1; mask < (1u << paths.size()); mask++) {
+        std::vector<Direction> dirs;
+        for (size_t k = 0; k < paths.size(); k++) {
+          if (mask & (1u << k)) dirs.push_back(paths[k]);
+        }
+        batch.add_known_dest(flag, slot, dirs.data(),
+                             static_cast<int>(dirs.size()));
+        expected.push_back({flag, dirs, forward_search(flag, dest, dirs)});
+      }
+    }
+  }
+
+  std::vector<Direction> results = batch.resolve();
+  ASSERT_EQ(expected.size(), results.size());
+  size_t unreachable = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    EXPECT_EQ(expected[i].result, results[i])
+      << "flag " << expected[i].flag->get_index() << ", request " << i;
+    if (expected[i].result == DirectionNone) unreachable += 1;
+  }
+  /* The spur must have been cut off from the rest for some requests. */
+  EXPECT_LT(0u, unreachable);
+}
@@ -0,0 +1,261 @@
+/*
+ * test_game.cc - test for the game update
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "src/game.h"
+#include "src/map-generator.h"
+#include "src/mission.h"
+#include "src/pathfinder.h"
+#include "src/random.h"
+#include "src/thread-pool.h"
+
+static std::unique_ptr<Game>
+create_game(bool serfs_sleep) {
+  std::unique_ptr<Game> game(new Game());
+  game->init(3, Random("8667715887436237"));
+  game->set_random(Random("1111222233334444"));
+  game->set_serfs_sleep(serfs_sleep);
+  game->add_player(35, 30, 40);
+  Player *player = game->get_player(0);
+  game->build_castle(game->get_map()->pos(6, 6), player);
+  return game;
+}
+
+/* Castle knights swap types while they defend. A knight that has finished
+   training waits without updates, so the swap must wake it to let it
+   train again. */
+TEST(Game, SleepingSerfsMatchPolling) {
+  std::unique_ptr<Game> polled = create_game(false);
+  std::unique_ptr<Game> sleeping = create_game(true);
+
+  for (int i = 0; i < 500; i++) {
+    polled->update();
+    sleeping->update();
+  }
+
+  int knights = 0;
+  for (Game *game : {polled.get(), sleeping.get()}) {
+    knights = 0;
+    for (Serf *serf : game->get_player_serfs(game->get_player(0))) {
+      if (serf->get_state() == Serf::StateDefendingCastle) {
+        if (knights == 0) serf->set_type(Serf::TypeKnight4);
+        knights += 1;
+      }
+    }
+  }
+  ASSERT_LT(1, knights) << "Castle needs knights of different levels";
+
+  for (int i = 0; i < 20000; i++) {
+    polled->update();
+    sleeping->update();
+    ASSERT_EQ(polled->state_hash(), sleeping->state_hash())
+      << "after " << i << " updates";
+  }
+}
+
+/* Build the next building of a small economy around the castle of the
+   first player, connected to the castle flag by road, so that serfs
+   walk along roads and walk freely. */
+static void
+grow_economy(Game *game, unsigned int step) {
+  static const Building::Type types[] = {
+    Building::TypeLumberjack, Building::TypeForester,
+    Building::TypeStonecutter, Building::TypeSawmill,
+    Building::TypeLumberjack, Building::TypeFisher,
+    Building::TypeForester, Building::TypeHut
+  };
+  PMap map = game->get_map();
+  Player *player = game->get_player(0);
+  MapPos castle = map->pos(6, 6);
+  Building::Type type = types[step % (sizeof(types) / sizeof(types[0]))];
+  for (unsigned int i = 7; i < 295; i++) {
+    MapPos pos = map->pos_add_spirally(castle, i);
+    if (!game->can_build_building(pos, type, player) ||
+        !game->build_building(pos, type, player)) {
+      continue;
+    }
+    Road road = pathfinder_map(map.get(), map->move_down_right(pos),
+                               map->move_down_right(castle));
+    if (road.get_length() > 0 && game->build_road(road, player)) {
+      return;
+    }
+    game->demolish_building(pos, player);
+  }
+}
+
+/* Planning the serf updates in parallel changes nothing but the speed. */
+TEST(Game, PlannedSerfsMatchSequential) {
+  ThreadPool pool(2);
+  std::unique_ptr<Game> sequential = create_game(true);
+  std::unique_ptr<Game> planned = create_game(true);
+  sequential->set_serf_parallel_min(UINT_MAX);
+  planned->set_thread_pool(&pool);
+  planned->set_serf_parallel_min(1);
+
+  for (unsigned int i = 0; i < 20000; i++) {
+    if (i % 500 == 10) {
+      grow_economy(sequential.get(), i / 500);
+      grow_economy(planned.get(), i / 500);
+    }
+    sequential->update();
+    planned->update();
+    ASSERT_EQ(sequential->state_hash(), planned->state_hash())
+      << "after " << i << " updates";
+  }
+
+  EXPECT_EQ(0u, sequential->get_committed_serf_plans());
+  EXPECT_LT(1000u, planned->get_committed_serf_plans());
+  EXPECT_LT(1, sequential->get_player_buildings(
+                  sequential->get_player(0)).size());
+}
+
+class ChangedTiles : public Map::Handler {
+ public:
+  std::vector<MapPos> changed;
+
+  virtual void on_height_changed(MapPos pos) {}
+  virtual void on_object_changed(MapPos pos) {}
+  virtual void on_tile_changed(MapPos pos) { changed.push_back(pos); }
+};
+
+/* A copy of a game goes on exactly as the game does, whether it is new or
+   a game that went its own way since it was last copied to. */
+TEST(Game, CopyGoesOnAlike) {
+  std::unique_ptr<Game> game = create_game(true);
+  Game copy;
+  copy.copy_state(*game);
+
+  for (unsigned int i = 0; i < 6000; i++) {
+    if (i % 500 == 10) {
+      grow_economy(game.get(), i / 500);
+    }
+    game->update();
+    copy.update();
+    if (i % 1000 == 999) {
+      copy.copy_state(*game);
+      ASSERT_EQ(game->state_hash(), copy.state_hash()) << "after " << i;
+    }
+  }
+
+  for (unsigned int i = 0; i < 10000; i++) {
+    if (i % 500 == 10) {
+      grow_economy(game.get(), i / 500 + 12);
+      grow_economy(&copy, i / 500 + 12);
+    }
+    game->update();
+    copy.update();
+    ASSERT_EQ(game->state_hash(), copy.state_hash())
+      << "after " << i << " updates";
+  }
+}
+
+/* The change handlers of a copy hear of the tiles that differ. */
+TEST(Game, CopyReportsChangedTiles) {
+  std::unique_ptr<Game> game = create_game(true);
+  Game view;
+  view.copy_state(*game);
+  ChangedTiles handler;
+  view.get_map()->add_change_handler(&handler);
+
+  MapPos pos = game->get_map()->pos(10, 6);
+  ASSERT_TRUE(game->build_flag(pos, game->get_player(0)));
+  for (unsigned int i = 0; i < 100; i++) game->update();
+
+  view.copy_state(*game);
+  view.get_map()->dispatch_changes();
+  EXPECT_NE(handler.changed.end(), std::find(handler.changed.begin(),
+                                             handler.changed.end(), pos));
+
+  handler.changed.clear();
+  view.copy_state(*game);
+  view.get_map()->dispatch_changes();
+  EXPECT_TRUE(handler.changed.empty());
+  view.get_map()->del_change_handler(&handler);
+}
+
+TEST(Game, ParallelMapFromGameInfo) {
+  PGameInfo game_info(new GameInfo(Random("8667715887436237")));
+  game_info->set_map_size(4);
+  game_info->set_parallel_map(true);
+  ThreadPool pool(2);
+  PGame game = game_info->instantiate(&pool);
+  ASSERT_TRUE(game);
+
+  ThreadPool serial(0);
+  Map expected(MapGeometry(4));
+  ParallelMapGenerator generator(expected, game_info->get_random_base(),
+                                 &serial);
+  generator.init(MapGenerator::HeightGeneratorMidpoints, true);
+  generator.generate();
+  expected.init_tiles(generator);
+  EXPECT_EQ(expected, *game->get_map());
+
+  game_info->set_parallel_map(false);
+  PGame classic = game_info->instantiate();
+  EXPECT_FALSE(expected == *classic->get_map());
+}
+
+/* The mine sites found from the mineral sums match a scan of the spiral
+   positions a miner digs at. */
+TEST(Game, MineSitesMatchScan) {
+  std::unique_ptr<Game> game = create_game(true);
+  PMap map = game->get_map();
+  for (int i = 0; i < 500; i++) game->update();
+
+  for (int m = Map::MineralsGold; m <= Map::MineralsStone; m++) {
+    Map::Minerals mineral = static_cast<Map::Minerals>(m);
+    std::vector<std::pair<int, MapPos>> scan;
+    for (MapPos pos : map->geom()) {
+      if (!game->can_build_mine(pos)) continue;
+      int amount = 0;
+      for (int i = 0; i < 32; i++) {
+        MapPos dest = map->pos_add_spirally(pos, i);
+        if ((map->get_obj(dest) == Map::ObjectNone ||
+             map->get_obj(dest) > Map::ObjectCastle) &&
+            map->get_res_type(dest) == mineral) {
+          amount += map->get_res_amount(dest);
+        }
+      }
+      if (amount > 0) scan.push_back(std::make_pair(-amount, pos));
+    }
+    std::sort(scan.begin(), scan.end());
+    ASSERT_LT(10u, scan.size()) << "mineral " << m;
+
+    std::vector<MapPos> sites = game->find_mine_sites(mineral, 10);
+    ASSERT_EQ(10u, sites.size());
+    for (size_t i = 0; i < sites.size(); i++) {
+      EXPECT_EQ(scan[i].second, sites[i]) << "mineral " << m << ", " << i;
+    }
+
+    sites = game->find_mine_sites(mineral, scan.size() + 5);
+    ASSERT_EQ(scan.size(), sites.size());
+    for (size_t i = 0; i < sites.size(); i++) {
+      EXPECT_EQ(scan[i].second, sites[i]) << "mineral " << m << ", " << i;
+    }
+  }
+}
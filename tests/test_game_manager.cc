@@ -0,0 +1,107 @@
+/*
+ * test_game_manager.cc - test for the simulation thread and its view
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "src/freeserf.h"
+#include "src/game-manager.h"
+#include "src/mission.h"
+#include "src/random.h"
+
+static GameManager &
+start_game() {
+  GameManager &manager = GameManager::get_instance();
+  PGameInfo game_info(new GameInfo(Random("8667715887436237")));
+  game_info->set_map_size(3);
+  EXPECT_TRUE(manager.start_game(game_info));
+  return manager;
+}
+
+/* The view is a copy of the game that follows it as it is simulated. */
+TEST(GameManager, ViewFollowsGame) {
+  GameManager &manager = start_game();
+  PGame view = manager.get_view();
+  ASSERT_TRUE(view);
+  EXPECT_NE(manager.get_current_game(), view);
+
+  unsigned int tick = view->get_tick();
+  for (int i = 0; i < 200 && view->get_tick() == tick; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(TICK_LENGTH));
+    manager.update_view();
+  }
+  EXPECT_LT(tick, view->get_tick());
+
+  manager.stop_simulation();
+  manager.update_view();
+  EXPECT_EQ(manager.get_current_game()->state_hash(), view->state_hash());
+}
+
+/* A command that is waited for shows in the view, along with the
+   commands posted before it. */
+TEST(GameManager, CommandsRunInOrder) {
+  GameManager &manager = start_game();
+  std::vector<int> order;
+  for (int i = 0; i < 3; i++) {
+    manager.post_command([i, &order](Game *game) {
+      order.push_back(i);
+      game->get_player(0)->set_serf_to_knight_rate(1000 + i);
+    });
+  }
+  manager.run_command([&order](Game *game) { order.push_back(3); });
+
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), order);
+  EXPECT_EQ(1002, manager.get_view()->get_player(0)->get_serf_to_knight_rate());
+  manager.stop_simulation();
+}
+
+/* Exceptions of a command are thrown to the one waiting for it. */
+TEST(GameManager, CommandErrorIsThrown) {
+  GameManager &manager = start_game();
+  EXPECT_THROW(manager.run_command([](Game *game) {
+    throw ExceptionFreeserf("Command failed.");
+  }), ExceptionFreeserf);
+
+  int runs = 0;
+  manager.run_command([&runs](Game *game) { runs += 1; });
+  EXPECT_EQ(1, runs);
+  manager.stop_simulation();
+}
+
+/* Commands still queued when the simulation stops are not lost, and run
+   right away while it is stopped. */
+TEST(GameManager, StoppingRunsQueuedCommands) {
+  GameManager &manager = start_game();
+  int runs = 0;
+  for (int i = 0; i < 10; i++) {
+    manager.post_command([&runs](Game *game) { runs += 1; });
+  }
+  manager.stop_simulation();
+  EXPECT_EQ(10, runs);
+
+  manager.run_command([](Game *game) {
+    game->get_player(0)->set_serf_to_knight_rate(2000);
+  });
+  EXPECT_EQ(2000, manager.get_view()->get_player(0)->get_serf_to_knight_rate());
+}
@@ -20,16 +20,22 @@
  */
 
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <iterator>
+#include <limits>
+#include <string>
 
 #include "src/map.h"
 #include "src/map-generator.h"
 #include "src/map-geometry.h"
 #include "src/random.h"
+#include "src/thread-pool.h"
 
 
 TEST(Map, ClassicMissionMapGenerator) {
@@ -126,3 +132,225 @@ TEST(Map, ClassicMissionMapGenerator) {
     }
   }
 }
+
+static unsigned int
+expected_free_dirs(const Map &map, MapPos pos, bool water) {
+  unsigned int dirs = 0;
+  for (Direction d : cycle_directions_cw()) {
+    MapPos other = map.move(pos, d);
+    bool passable = water ? (map.get_obj(other) == Map::ObjectNone) :
+      (!map.is_in_water(other) &&
+       Map::map_space_from_obj[map.get_obj(other)] <= Map::SpaceSemipassable);
+    if (passable && !map.has_serf(other)) dirs |= BIT(d);
+  }
+  return dirs;
+}
+
+TEST(Map, FreeDirsFollowTiles) {
+  const MapGeometry geom(3);
+  Map map(geom);
+
+  Random random = Random("8667715887436237");
+  ClassicMissionMapGenerator generator(map, random);
+  generator.init();
+  generator.generate();
+  map.init_tiles(generator);
+
+  // Change some objects and serfs around a position
+  MapPos center = map.pos(20, 20);
+  map.set_object(center, Map::ObjectStone0, -1);
+  map.set_object(map.move_right(center), Map::ObjectNone, -1);
+  map.set_serf_index(map.move_down(center), 7);
+  map.set_serf_index(map.move_left(center), 9);
+  map.set_serf_index(map.move_left(center), 0);
+
+  for (MapPos pos : geom) {
+    ASSERT_EQ(expected_free_dirs(map, pos, false),
+              map.get_free_dirs(pos, false)) << "Walking from " << pos;
+    ASSERT_EQ(expected_free_dirs(map, pos, true),
+              map.get_free_dirs(pos, true)) << "Sailing from " << pos;
+
+    unsigned int occupied = 0;
+    for (Direction d : cycle_directions_cw()) {
+      if (map.has_serf(map.move(pos, d))) occupied |= BIT(d);
+    }
+    ASSERT_EQ(occupied, map.get_occupied_dirs(pos)) << "Serfs around " << pos;
+  }
+}
+
+// Ground analysis samples in a spiral, weighted by distance
+static int
+expected_mineral_estimate(const Map &map, MapPos pos, Map::Minerals mineral) {
+  const int radius = 25;
+  int total = 0;
+  auto sample = [&](MapPos p, int weight) {
+    Map::Object obj = map.get_obj(p);
+    if ((obj == Map::ObjectNone || obj >= Map::ObjectTree0) &&
+        map.get_res_type(p) == mineral) {
+      total += weight * map.get_res_amount(p);
+    }
+  };
+
+  sample(pos, radius);
+  for (int i = 0; i < radius-1; i++) {
+    pos = map.move_right(pos);
+    for (Direction d : cycle_directions_cw(DirectionDown)) {
+      for (int j = 0; j < i+1; j++) {
+        sample(pos, radius-i);
+        pos = map.move(pos, d);
+      }
+    }
+  }
+
+  return total;
+}
+
+TEST(Map, MineralSumsFollowTiles) {
+  const MapGeometry geom(3);
+  Map map(geom);
+
+  Random random = Random("8667715887436237");
+  ClassicMissionMapGenerator generator(map, random);
+  generator.init();
+  generator.generate();
+  map.init_tiles(generator);
+
+  // Cover and dig some deposits
+  for (MapPos pos : geom) {
+    if (map.get_res_type(pos) == Map::MineralsNone) continue;
+    if (pos % 5 == 0) map.set_object(pos, Map::ObjectFlag, 1);
+    if (pos % 7 == 0) map.remove_ground_deposit(pos, 1);
+  }
+
+  for (MapPos pos : geom) {
+    for (int m = Map::MineralsGold; m <= Map::MineralsStone; m++) {
+      Map::Minerals mineral = static_cast<Map::Minerals>(m);
+      ASSERT_EQ(expected_mineral_estimate(map, pos, mineral),
+                map.get_mineral_estimate(pos, 25, mineral)) << "At " << pos;
+    }
+  }
+}
+
+TEST(Map, MineralSumsFitLargestMaps) {
+  // Saved deposits hold at most 31 units, so the moments of a row reach
+  // 31 times the sum of its column numbers. Size 20 is the largest map
+  // with 32-bit positions, wide builds go further.
+  const MapGeometry geom((sizeof(MapPos) == 4) ? 20 : 24);
+  double cols = geom.cols();
+  double moment = 31.0 * cols * (cols - 1) / 2;
+  EXPECT_LT(static_cast<double>(std::numeric_limits<int>::max()), moment);
+  EXPECT_GT(static_cast<double>(std::numeric_limits<Map::MineralSum>::max()),
+            moment);
+}
+
+TEST(Map, MappedTilesPersist) {
+  const MapGeometry geom(3);
+  Map map(geom);
+
+  Random random = Random("8667715887436237");
+  ClassicMissionMapGenerator generator(map, random);
+  generator.init();
+  generator.generate();
+  map.init_tiles(generator);
+
+  std::string path = ::testing::TempDir() + "freeserf-mapped-tiles";
+  ASSERT_TRUE(map.map_tiles(path));
+
+  // Changes after mapping go to the files
+  MapPos pos = map.pos(12, 7);
+  map.set_object(pos, Map::ObjectStone3, -1);
+  map.set_height(pos, 17);
+  ASSERT_TRUE(map.sync_tiles());
+
+  Map loaded(geom);
+  ASSERT_TRUE(loaded.load_mapped_tiles(path));
+  EXPECT_EQ(map, loaded);
+  EXPECT_EQ(map.get_state_hash(), loaded.get_state_hash());
+  EXPECT_EQ(Map::ObjectStone3, loaded.get_obj(pos));
+
+  std::remove((path + ".landscape").c_str());
+  std::remove((path + ".game").c_str());
+}
+
+TEST(Map, ParallelMapGeneratorIgnoresThreadCount) {
+  const MapGeometry geom(5);
+  Random random = Random("8667715887436237");
+
+  for (MapGenerator::HeightGenerator height :
+         { MapGenerator::HeightGeneratorMidpoints,
+           MapGenerator::HeightGeneratorDiamondSquare }) {
+    ThreadPool serial(0);
+    Map expected(geom);
+    ParallelMapGenerator generator(expected, random, &serial);
+    generator.init(height, false);
+    generator.generate();
+    expected.init_tiles(generator);
+
+    ThreadPool pool(4);
+    for (int i = 0; i < 3; i++) {
+      Map map(geom);
+      ParallelMapGenerator parallel(map, random, &pool);
+      parallel.init(height, false);
+      parallel.generate();
+      map.init_tiles(parallel);
+      EXPECT_EQ(expected, map);
+    }
+  }
+}
+
+TEST(Map, GeneratorStopsWithinStage) {
+  Map map(MapGeometry(5));
+  ClassicMapGenerator generator(map, Random("8667715887436237"));
+  generator.init(MapGenerator::HeightGeneratorMidpoints, true);
+
+  /* Decline the tenth row; nothing more is reported after that. */
+  std::vector<ClassicMapGenerator::Stage> stages;
+  generator.set_progress_handler([&stages](ClassicMapGenerator::Stage stage) {
+    stages.push_back(stage);
+    return stages.size() < 10;
+  });
+  generator.generate();
+
+  ASSERT_EQ(10u, stages.size());
+  for (ClassicMapGenerator::Stage stage : stages) {
+    EXPECT_EQ(ClassicMapGenerator::StageWorking, stage);
+  }
+}
+
+TEST(Map, FailedMappingKeepsTiles) {
+  const MapGeometry geom(3);
+  Map map(geom);
+
+  Random random = Random("8667715887436237");
+  ClassicMissionMapGenerator generator(map, random);
+  generator.init();
+  generator.generate();
+  map.init_tiles(generator);
+  uint64_t hash = map.get_state_hash();
+
+  // A directory in the way of the game tiles makes the second file fail
+  std::string path = ::testing::TempDir() + "freeserf-failed-tiles";
+  rmdir((path + ".game").c_str());
+  ASSERT_EQ(0, mkdir((path + ".game").c_str(), 0755));
+  EXPECT_FALSE(map.map_tiles(path));
+  EXPECT_FALSE(map.is_mapped());
+  EXPECT_NE(0, access((path + ".landscape").c_str(), F_OK));
+
+  // The tiles are back on the heap, unchanged
+  Map fresh(geom);
+  fresh.init_tiles(generator);
+  EXPECT_EQ(fresh, map);
+  EXPECT_EQ(hash, map.get_state_hash());
+
+  // Loading stops before touching the tiles when a file is missing
+  Map loaded(geom);
+  loaded.init_tiles(generator);
+  ASSERT_TRUE(map.map_tiles(path + "-ok"));
+  std::remove((path + "-ok.game").c_str());
+  EXPECT_FALSE(loaded.load_mapped_tiles(path + "-ok"));
+  EXPECT_FALSE(loaded.is_mapped());
+  EXPECT_EQ(hash, loaded.get_state_hash());
+
+  std::remove((path + "-ok.landscape").c_str());
+  rmdir((path + ".game").c_str());
+}
@@ -85,3 +85,31 @@ TEST(MapGeometry, LongerCCWDirectionCycle) {
 
   EXPECT_EQ(expected, dirs);
 }
+
+TEST(MapGeometry, SizeLimitFollowsPositionWidth) {
+  // Size 20 is the largest that fits in 32-bit positions
+  const MapGeometry geom(20);
+  MapPos pos = geom.pos(geom.cols() - 1, geom.rows() - 1);
+  EXPECT_EQ(static_cast<int>(geom.cols() - 1), geom.pos_col(pos));
+  EXPECT_EQ(static_cast<int>(geom.rows() - 1), geom.pos_row(pos));
+
+  if (sizeof(MapPos) == 4) {
+    EXPECT_THROW(MapGeometry(21), ExceptionFreeserf);
+  } else {
+    const MapGeometry wide(24);
+    MapPos last = wide.pos(wide.cols() - 1, wide.rows() - 1);
+    EXPECT_EQ(wide.tile_count() - 1, last);
+    EXPECT_EQ(wide.pos(0, 0), wide.move_down_right(last));
+
+    // Size 51 is the largest whose columns still fit in an int
+    const MapGeometry widest(51);
+    EXPECT_EQ(1u << 30, widest.cols());
+    EXPECT_EQ(1u << 30, widest.rows());
+    last = widest.pos(widest.cols() - 1, widest.rows() - 1);
+    EXPECT_EQ(widest.tile_count() - 1, last);
+    EXPECT_EQ(static_cast<int>(widest.cols() - 1), widest.pos_col(last));
+    EXPECT_EQ(static_cast<int>(widest.rows() - 1), widest.pos_row(last));
+    EXPECT_EQ(widest.pos(0, 0), widest.move_down_right(last));
+    EXPECT_THROW(MapGeometry(52), ExceptionFreeserf);
+  }
+}
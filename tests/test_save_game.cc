@@ -21,9 +21,13 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <memory>
+#include <string>
 
 #include "src/game.h"
 #include "src/random.h"
@@ -66,6 +70,8 @@ TEST(SaveGame, RandomMapSaveGame) {
 
   // Check map
   EXPECT_EQ(*game->get_map(), *loaded_game->get_map());
+  EXPECT_EQ(game->get_map()->get_state_hash(),
+            loaded_game->get_map()->get_state_hash());
 
   // Check gold deposit
   EXPECT_EQ(game->get_gold_total(), loaded_game->get_gold_total());
@@ -77,3 +83,83 @@ TEST(SaveGame, RandomMapSaveGame) {
   // Check player land area
   EXPECT_EQ(player_0->get_land_area(), loaded_player_0->get_land_area());
 }
+
+TEST(SaveGame, BackgroundSave) {
+  std::unique_ptr<Game> game(new Game());
+  game->init(3, Random("8667715887436237"));
+  game->add_player(35, 30, 40);
+  Player *player_0 = game->get_player(0);
+  ASSERT_TRUE(game->build_castle(game->get_map()->pos(6, 6), player_0));
+  for (int i = 0; i < 500; i++) game->update();
+
+  // Write a snapshot on the background writer
+  GameStore &store = GameStore::get_instance();
+  std::string path = ::testing::TempDir() + "freeserf-background.save";
+  store.save_in_background(path, store.snapshot(game.get()));
+  store.wait_for_saves();
+
+  // The file is complete and the temporary file is gone
+  EXPECT_FALSE(std::ifstream(path + ".tmp").good());
+  std::unique_ptr<Game> loaded_game(new Game());
+  ASSERT_TRUE(store.load(path, loaded_game.get()));
+  std::remove(path.c_str());
+
+  EXPECT_EQ(*game->get_map(), *loaded_game->get_map());
+  EXPECT_EQ(game->get_map()->get_state_hash(),
+            loaded_game->get_map()->get_state_hash());
+  EXPECT_EQ(game->get_gold_total(), loaded_game->get_gold_total());
+  Player *loaded_player_0 = loaded_game->get_player(0);
+  ASSERT_TRUE(loaded_player_0 != NULL);
+  EXPECT_EQ(player_0->get_land_area(), loaded_player_0->get_land_area());
+}
+
+TEST(SaveGame, MappedTilesSaveGame) {
+  GameStore &store = GameStore::get_instance();
+  store.set_mapped_tiles(true);
+  std::unique_ptr<Game> game(new Game());
+  game->init(3, Random("8667715887436237"));
+  bool mapped = store.map_tiles(game.get());
+  store.set_mapped_tiles(false);
+  ASSERT_TRUE(mapped);
+  ASSERT_TRUE(game->get_map()->is_mapped());
+  std::string tiles_path = game->get_map()->get_tiles_path();
+
+  game->add_player(35, 30, 40);
+  Player *player_0 = game->get_player(0);
+  ASSERT_TRUE(game->build_castle(game->get_map()->pos(6, 6), player_0));
+  for (int i = 0; i < 500; i++) game->update();
+
+  // The save refers to the tile files instead of holding the tiles
+  std::string path = ::testing::TempDir() + "freeserf-mapped.save";
+  ASSERT_TRUE(store.save(path, game.get()));
+  std::ifstream file(path);
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  EXPECT_EQ(std::string::npos, content.find("[map"));
+  EXPECT_NE(std::string::npos, content.find(tiles_path));
+
+  std::unique_ptr<Game> loaded_game(new Game());
+  ASSERT_TRUE(store.load(path, loaded_game.get()));
+  EXPECT_TRUE(loaded_game->get_map()->is_mapped());
+  EXPECT_EQ(*game->get_map(), *loaded_game->get_map());
+  EXPECT_EQ(game->get_map()->get_state_hash(),
+            loaded_game->get_map()->get_state_hash());
+  EXPECT_EQ(game->get_gold_total(), loaded_game->get_gold_total());
+  Player *loaded_player_0 = loaded_game->get_player(0);
+  ASSERT_TRUE(loaded_player_0 != NULL);
+  EXPECT_EQ(player_0->get_land_area(), loaded_player_0->get_land_area());
+  loaded_game.reset();
+
+  // Once the game changes its tiles the save can no longer be loaded
+  uint64_t saved_hash = game->get_map()->get_state_hash();
+  for (int i = 0; i < 500; i++) game->update();
+  ASSERT_NE(saved_hash, game->get_map()->get_state_hash());
+  loaded_game.reset(new Game());
+  EXPECT_FALSE(store.load(path, loaded_game.get()));
+
+  loaded_game.reset();
+  game.reset();
+  std::remove(path.c_str());
+  std::remove((tiles_path + ".landscape").c_str());
+  std::remove((tiles_path + ".game").c_str());
+}
@@ -0,0 +1,144 @@
+/*
+ * test_thread_pool.cc - test for the thread pool
+ *
+ * Copyright (C) 2026  FreeSerf Contributors
+ *
+ * This file is part of freeserf.
+ *
+ * freeserf is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * freeserf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with freeserf.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "src/thread-pool.h"
+#include "src/debug.h"
+
+class ThreadPoolTest : public ::testing::TestWithParam<unsigned int> {
+};
+
+TEST_P(ThreadPoolTest, ParallelForCoversRange) {
+  ThreadPool pool(GetParam());
+  std::vector<int> visits(1000, 0);
+  pool.parallel_for(0, visits.size(), 7, [&](size_t first, size_t last) {
+    EXPECT_LE(last - first, 7u);
+    for (size_t i = first; i < last; i++) {
+      visits[i]++;
+    }
+  });
+  for (int count : visits) {
+    ASSERT_EQ(1, count);
+  }
+}
+
+TEST_P(ThreadPoolTest, NestedParallelFor) {
+  ThreadPool pool(GetParam());
+  std::atomic<unsigned int> total(0);
+  pool.parallel_for(0, 16, 1, [&](size_t, size_t) {
+    pool.parallel_for(0, 100, 10, [&](size_t first, size_t last) {
+      total += static_cast<unsigned int>(last - first);
+    });
+  });
+  EXPECT_EQ(1600u, total);
+}
+
+TEST_P(ThreadPoolTest, ReduceIsDeterministic) {
+  ThreadPool pool(GetParam());
+  ThreadPool serial(0);
+  auto map = [](size_t first, size_t last) {
+    double sum = 0;
+    for (size_t i = first; i < last; i++) {
+      sum += 1.0 / static_cast<double>(i + 1);
+    }
+    return sum;
+  };
+  auto reduce = [](double a, double b) { return a + b; };
+  double expected = serial.parallel_reduce(0, 100000, 333, 0.0, map, reduce);
+  for (int i = 0; i < 10; i++) {
+    double sum = pool.parallel_reduce(0, 100000, 333, 0.0, map, reduce);
+    ASSERT_EQ(expected, sum);
+  }
+}
+
+TEST_P(ThreadPoolTest, GraphRespectsDependencies) {
+  ThreadPool pool(GetParam());
+  ThreadPool::Graph graph;
+  std::atomic<int> step(0);
+  int a = -1, b = -1, c = -1, d = -1;
+  ThreadPool::Graph::Node node_d = graph.add([&]() { d = step++; });
+  ThreadPool::Graph::Node node_b = graph.add([&]() { b = step++; });
+  ThreadPool::Graph::Node node_c = graph.add([&]() { c = step++; });
+  ThreadPool::Graph::Node node_a = graph.add([&]() { a = step++; });
+  graph.depends(node_b, node_a);
+  graph.depends(node_c, node_a);
+  graph.depends(node_d, node_b);
+  graph.depends(node_d, node_c);
+  graph.run(&pool);
+  EXPECT_EQ(4, step);
+  EXPECT_LT(a, b);
+  EXPECT_LT(a, c);
+  EXPECT_LT(b, d);
+  EXPECT_LT(c, d);
+}
+
+TEST_P(ThreadPoolTest, GraphCycleThrows) {
+  ThreadPool pool(GetParam());
+  ThreadPool::Graph graph;
+  ThreadPool::Graph::Node first = graph.add([]() {});
+  ThreadPool::Graph::Node second = graph.add([]() {});
+  graph.depends(first, second);
+  graph.depends(second, first);
+  EXPECT_THROW(graph.run(&pool), ExceptionFreeserf);
+}
+
+TEST_P(ThreadPoolTest, ExceptionReachesCaller) {
+  ThreadPool pool(GetParam());
+  std::atomic<unsigned int> done(0);
+  EXPECT_THROW(pool.parallel_for(0, 50, 1, [&](size_t first, size_t) {
+    done++;
+    if (first == 17) {
+      throw std::runtime_error("failed");
+    }
+  }), std::runtime_error);
+  EXPECT_EQ(50u, done);
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, ThreadPoolTest,
+                         ::testing::Values(0u, 1u, 4u));
+
+/* A thread waiting for a task that runs elsewhere sleeps rather than
+   spins. */
+TEST(ThreadPool, WaitSleepsWhileTaskRuns) {
+  ThreadPool pool(1);
+  ThreadPool::Batch batch(&pool);
+  std::atomic<bool> started(false);
+  batch.submit([&started]() {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+
+  std::clock_t cpu = std::clock();
+  batch.wait();
+  cpu = std::clock() - cpu;
+  EXPECT_LT(cpu, CLOCKS_PER_SEC / 10);
+}